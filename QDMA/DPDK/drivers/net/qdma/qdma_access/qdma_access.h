@@ -352,6 +352,25 @@ struct qdma_q_cmpt_cidx_reg_info {
 	uint32_t rsvd:3;
 };
 
+/**
+ * struct qdma_reg_poll_stats - busy polling of the indirect context
+ *	commands of one context type, see qdma_reg_poll_stats_get()
+ */
+struct qdma_reg_poll_stats {
+	/** @ops - # of commands */
+	uint64_t ops;
+	/** @spin_done - # of commands done before the first delay */
+	uint64_t spin_done;
+	/** @reads - # of busy register reads */
+	uint64_t reads;
+	/** @delay_us - total delay, in us */
+	uint64_t delay_us;
+	/** @max_delay_us - longest delay of a command, in us */
+	uint32_t max_delay_us;
+	/** @timeouts - # of commands timed out */
+	uint32_t timeouts;
+};
+
 struct qdma_hw_version_info {
 	/** @rtl_version - RTL Version */
 	enum qdma_rtl_version rtl_version;
@@ -1178,6 +1197,38 @@ int qdma_initiate_flr(void *dev_hndl, uint8_t is_vf);
  *****************************************************************************/
 int qdma_is_flr_done(void *dev_hndl, uint8_t is_vf, uint8_t *done);
 
+/*****************************************************************************/
+/**
+ * qdma_reg_poll_stats_get() - function to get the busy polling statistics
+ * of the indirect context commands, summed over all the devices
+ *
+ * @sel: context type, enum ind_ctxt_cmd_sel
+ * @stats: pointer to hold the statistics
+ *
+ * Return:   0   - success and < 0 - failure, past the last context type
+ *****************************************************************************/
+int qdma_reg_poll_stats_get(uint8_t sel,
+		struct qdma_reg_poll_stats *stats);
+
+/*****************************************************************************/
+/**
+ * qdma_reg_poll_stats_clear() - function to reset the busy polling
+ * statistics of all the context types
+ *
+ * Return: void
+ *****************************************************************************/
+void qdma_reg_poll_stats_clear(void);
+
+/*****************************************************************************/
+/**
+ * qdma_get_ctxt_sel_name() - function to get the name of a context type
+ *
+ * @sel: context type, enum ind_ctxt_cmd_sel
+ *
+ * Return: context type name, NULL past the last context type
+ *****************************************************************************/
+const char *qdma_get_ctxt_sel_name(uint8_t sel);
+
 #ifdef __cplusplus
 }
 #endif
@@ -86,6 +86,24 @@ void qdma_resource_lock_take(void);
  *****************************************************************************/
 void qdma_resource_lock_give(void);
 
+/*****************************************************************************/
+/**
+ * qdma_stats_lock_take() - take lock to access the statistics shared by all
+ * the devices, may be called with the register access lock held
+ *
+ * @return	None
+ *****************************************************************************/
+void qdma_stats_lock_take(void);
+
+/*****************************************************************************/
+/**
+ * qdma_stats_lock_give() - release lock after accessing the statistics
+ * shared by all the devices
+ *
+ * @return	None
+ *****************************************************************************/
+void qdma_stats_lock_give(void);
+
 /*****************************************************************************/
 /**
  * qdma_reg_write() - Register write API.
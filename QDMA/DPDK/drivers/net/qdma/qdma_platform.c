@@ -37,6 +37,7 @@
 #include <rte_spinlock.h>
 
 static rte_spinlock_t resource_lock = RTE_SPINLOCK_INITIALIZER;
+static rte_spinlock_t stats_lock = RTE_SPINLOCK_INITIALIZER;
 
 /*****************************************************************************/
 /**
@@ -88,6 +89,30 @@ void qdma_resource_lock_give(void)
 	rte_spinlock_unlock(&resource_lock);
 }
 
+/*****************************************************************************/
+/**
+ * qdma_stats_lock_take() - take lock to access the statistics shared by all
+ *                          the devices
+ *
+ * @return	None
+ *****************************************************************************/
+void qdma_stats_lock_take(void)
+{
+	rte_spinlock_lock(&stats_lock);
+}
+
+/*****************************************************************************/
+/**
+ * qdma_stats_lock_give() - release lock after accessing the statistics
+ *                          shared by all the devices
+ *
+ * @return	None
+ *****************************************************************************/
+void qdma_stats_lock_give(void)
+{
+	rte_spinlock_unlock(&stats_lock);
+}
+
 /*****************************************************************************/
 /**
  * qdma_reg_write() - Register write API.
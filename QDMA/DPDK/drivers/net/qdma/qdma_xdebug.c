@@ -31,6 +31,7 @@
  */
 
 #include <stdint.h>
+#include <inttypes.h>
 #include <sys/mman.h>
 #include <sys/fcntl.h>
 #include <rte_memzone.h>
@@ -197,6 +198,26 @@ static int qdma_csr_dump(void)
 	return 0;
 }
 
+static int qdma_reg_poll_dump(void)
+{
+	struct qdma_reg_poll_stats stats;
+	uint8_t sel;
+
+	xdebug_info(adap, "Context register polling\n--------------\n");
+	xdebug_info(adap, "%-10s %10s %10s %10s %12s %8s %8s\n",
+			"ctxt", "ops", "spin_done", "reads", "delay_us",
+			"max_us", "timeout");
+	for (sel = 0; !qdma_reg_poll_stats_get(sel, &stats); sel++)
+		xdebug_info(adap, "%-10s %10" PRIu64 " %10" PRIu64 " %10"
+				PRIu64 " %12" PRIu64 " %8u %8u\n",
+				qdma_get_ctxt_sel_name(sel), stats.ops,
+				stats.spin_done, stats.reads, stats.delay_us,
+				stats.max_delay_us, stats.timeouts);
+	qdma_reg_poll_stats_clear();
+
+	return 0;
+}
+
 static int qdma_context_dump(uint8_t port_id, uint16_t queue)
 {
 	struct rte_eth_dev *dev = &rte_eth_devices[port_id];
@@ -674,6 +695,14 @@ int rte_pmd_qdma_xdebug(uint8_t port_id, enum rte_pmd_qdma_xdebug_type type,
 		}
 		break;
 
+	case RTE_PMD_QDMA_XDEBUG_REG_POLL_STATS:
+		err = qdma_reg_poll_dump();
+		if (err) {
+			xdebug_info(adap, "Error dumping register polling\n");
+			return err;
+		}
+		break;
+
 	default:
 		xdebug_info(adap, "Unsupported type\n");
 		return err;
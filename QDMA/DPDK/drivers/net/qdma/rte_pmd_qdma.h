@@ -112,6 +112,7 @@ enum rte_pmd_qdma_xdebug_type {
 	RTE_PMD_QDMA_XDEBUG_QUEUE_CONTEXT,
 	RTE_PMD_QDMA_XDEBUG_QUEUE_STRUCT,
 	RTE_PMD_QDMA_XDEBUG_QUEUE_DESC_DUMP,
+	RTE_PMD_QDMA_XDEBUG_REG_POLL_STATS,
 	RTE_PMD_QDMA_XDEBUG_MAX,
 };
 
@@ -145,6 +146,8 @@ struct rte_pmd_qdma_xdebug_desc_param {
  *		specifying Queue Id
  *		RTE_PMD_QDMA_XDEBUG_QUEUE_DESC_DUMP : Pointer to variable of
  *		type struct rte_pmd_qdma_xdebug_desc_param
+ *		RTE_PMD_QDMA_XDEBUG_REG_POLL_STATS  : Not used, the context
+ *		register polling statistics are cleared once dumped
  *
  * @return	'0' on success and "< 0" on failure.
  *
@@ -36,9 +36,15 @@
 #include <linux/wait.h>
 #include <linux/kthread.h>
 #include <linux/version.h>
+#include <linux/vmalloc.h>
+#include <linux/dma-mapping.h>
 #if KERNEL_VERSION(3, 16, 0) <= LINUX_VERSION_CODE
 #include <linux/uio.h>
 #endif
+#if KERNEL_VERSION(4, 11, 0) <= LINUX_VERSION_CODE
+#include <linux/sched/mm.h>
+#include <linux/sched/signal.h>
+#endif
 
 #include "qdma_mod.h"
 
@@ -56,20 +62,50 @@ struct xlnx_phy_dev {
 static LIST_HEAD(xlnx_phy_dev_list);
 static DEFINE_MUTEX(xlnx_phy_dev_mutex);
 
+/** # of iovec segments of an aio request held in the caio itself */
+#define QDMA_CDEV_AIO_SEGS	16
+/** # of pages preallocated with a pooled qiocb */
+#define QDMA_CDEV_IO_PAGES	16
+/** max. # of pooled objects per queue cdev */
+#define QDMA_CDEV_POOL_MAX	256
+
 struct cdev_async_io {
 	ssize_t res2;
 	unsigned long req_count;
 	unsigned long cmpl_count;
 	unsigned long err_cnt;
-	struct qdma_io_cb *qiocb;
+	struct cdev_aio_pool *pool;
 	struct qdma_request **reqv;
 	struct kiocb *iocb;
 	struct work_struct wrk_itm;
+	struct qdma_request *reqv_inline[QDMA_CDEV_AIO_SEGS];
+};
+
+/*
+ * fixed size objects, a bit per object marks it busy: get and put are
+ * lock-free and never allocate
+ */
+struct cdev_obj_pool {
+	unsigned int size;
+	unsigned int obj_sz;
+	unsigned int hint;
+	unsigned long *busy;
+	char *objs;
+};
+
+struct cdev_aio_pool {
+	/** struct cdev_async_io */
+	struct cdev_obj_pool caio;
+	/** struct qdma_io_cb + QDMA_CDEV_IO_PAGES sgl entries and pages */
+	struct cdev_obj_pool qiocb;
 };
 
 enum qdma_cdev_ioctl_cmd {
 	QDMA_CDEV_IOCTL_NO_MEMCPY,
-	QDMA_CDEV_IOCTL_CMDS
+	/* 1: QDMA_C2H_RING_IOCTL_WAIT, see qdma_c2h_ring.h */
+	/* 2 - 4: QDMA_CDEV_IOCTL_BUF_*, see qdma_cdev_buf.h */
+	/* 5: QDMA_CDEV_IOCTL_STRIPE_SET, see qdma_cdev_stripe.h */
+	QDMA_CDEV_IOCTL_CMDS = QDMA_CDEV_IOCTL_STRIPE_SET + 1
 };
 
 struct class *qdma_class;
@@ -100,6 +136,201 @@ static inline void xlnx_phy_dev_list_add(struct xlnx_phy_dev *phy_dev)
 	mutex_unlock(&xlnx_phy_dev_mutex);
 }
 
+static int cdev_obj_pool_init(struct cdev_obj_pool *pool, unsigned int size,
+			unsigned int obj_sz)
+{
+	pool->busy = kcalloc(BITS_TO_LONGS(size), sizeof(unsigned long),
+				GFP_KERNEL);
+	if (!pool->busy)
+		return -ENOMEM;
+	pool->objs = vzalloc(size * obj_sz);
+	if (!pool->objs) {
+		kfree(pool->busy);
+		return -ENOMEM;
+	}
+	pool->size = size;
+	pool->obj_sz = obj_sz;
+
+	return 0;
+}
+
+static void cdev_obj_pool_cleanup(struct cdev_obj_pool *pool)
+{
+	vfree(pool->objs);
+	kfree(pool->busy);
+}
+
+static void *cdev_obj_get(struct cdev_obj_pool *pool)
+{
+	unsigned int i = find_next_zero_bit(pool->busy, pool->size,
+					READ_ONCE(pool->hint));
+	bool wrapped = false;
+
+	while (1) {
+		if (i >= pool->size) {
+			if (wrapped)
+				return NULL;
+			wrapped = true;
+			i = find_first_zero_bit(pool->busy, pool->size);
+			continue;
+		}
+		if (!test_and_set_bit_lock(i, pool->busy))
+			break;
+		i = find_next_zero_bit(pool->busy, pool->size, i + 1);
+	}
+	WRITE_ONCE(pool->hint, i + 1 < pool->size ? i + 1 : 0);
+
+	return pool->objs + i * pool->obj_sz;
+}
+
+/* false if obj was not taken from the pool */
+static bool cdev_obj_put(struct cdev_obj_pool *pool, void *obj)
+{
+	char *p = obj;
+
+	if (p < pool->objs || p >= pool->objs + pool->size * pool->obj_sz)
+		return false;
+	clear_bit_unlock((p - pool->objs) / pool->obj_sz, pool->busy);
+	return true;
+}
+
+static void cdev_aio_pool_destroy(struct cdev_aio_pool *pool)
+{
+	if (!pool)
+		return;
+	cdev_obj_pool_cleanup(&pool->caio);
+	cdev_obj_pool_cleanup(&pool->qiocb);
+	kfree(pool);
+}
+
+/*
+ * created on the first aio request, once the queue is started and its ring
+ * size is known: one qiocb per descriptor, up to QDMA_CDEV_POOL_MAX
+ */
+static struct cdev_aio_pool *cdev_aio_pool_get(struct qdma_cdev *xcdev,
+					unsigned long qhndl)
+{
+	struct cdev_aio_pool *pool = READ_ONCE(xcdev->aio_pool);
+	struct qdma_queue_conf *qconf;
+	unsigned int size;
+
+	if (pool)
+		return pool;
+
+	qconf = qdma_queue_get_config(xcdev->xcb->xpdev->dev_hndl, qhndl,
+					NULL, 0);
+	if (!qconf || !qconf->rngsz)
+		return NULL;
+	size = min_t(unsigned int, qconf->rngsz, QDMA_CDEV_POOL_MAX);
+
+	pool = kzalloc(sizeof(struct cdev_aio_pool), GFP_KERNEL);
+	if (!pool)
+		return NULL;
+	if (cdev_obj_pool_init(&pool->caio, size,
+				sizeof(struct cdev_async_io)) < 0) {
+		kfree(pool);
+		return NULL;
+	}
+	if (cdev_obj_pool_init(&pool->qiocb, size,
+			sizeof(struct qdma_io_cb) + QDMA_CDEV_IO_PAGES *
+			(sizeof(struct qdma_sw_sg) + sizeof(struct page *)))) {
+		cdev_obj_pool_cleanup(&pool->caio);
+		kfree(pool);
+		return NULL;
+	}
+
+	if (cmpxchg(&xcdev->aio_pool, NULL, pool)) {
+		cdev_aio_pool_destroy(pool);
+		pool = xcdev->aio_pool;
+	}
+
+	return pool;
+}
+
+/* pooled when possible, allocated otherwise */
+static struct cdev_async_io *cdev_caio_get(struct qdma_cdev *xcdev,
+					unsigned long qhndl, unsigned long count)
+{
+	struct cdev_aio_pool *pool = cdev_aio_pool_get(xcdev, qhndl);
+	struct cdev_async_io *caio = NULL;
+
+	if (pool)
+		caio = cdev_obj_get(&pool->caio);
+	if (!caio) {
+		caio = kmem_cache_alloc(cdev_cache, GFP_KERNEL);
+		if (!caio)
+			return NULL;
+	}
+	memset(caio, 0, sizeof(struct cdev_async_io));
+	caio->pool = pool;
+
+	if (count <= QDMA_CDEV_AIO_SEGS) {
+		caio->reqv = caio->reqv_inline;
+		return caio;
+	}
+
+	caio->reqv = kcalloc(count, sizeof(struct qdma_request *), GFP_KERNEL);
+	if (!caio->reqv) {
+		if (!pool || !cdev_obj_put(&pool->caio, caio))
+			kmem_cache_free(cdev_cache, caio);
+		return NULL;
+	}
+
+	return caio;
+}
+
+static void cdev_caio_put(struct cdev_async_io *caio)
+{
+	if (caio->reqv != caio->reqv_inline)
+		kfree(caio->reqv);
+	if (!caio->pool || !cdev_obj_put(&caio->pool->caio, caio))
+		kmem_cache_free(cdev_cache, caio);
+}
+
+static struct qdma_io_cb *cdev_qiocb_get(struct cdev_async_io *caio)
+{
+	struct qdma_io_cb *qiocb = NULL;
+
+	if (caio->pool)
+		qiocb = cdev_obj_get(&caio->pool->qiocb);
+	if (qiocb) {
+		memset(qiocb, 0, sizeof(struct qdma_io_cb));
+		qiocb->sgl_pool = (struct qdma_sw_sg *)(qiocb + 1);
+		qiocb->sgl_pool_nr = QDMA_CDEV_IO_PAGES;
+	} else {
+		qiocb = kzalloc(sizeof(struct qdma_io_cb), GFP_KERNEL);
+		if (!qiocb)
+			return NULL;
+	}
+	qiocb->private = caio;
+
+	return qiocb;
+}
+
+static void cdev_qiocb_put(struct cdev_async_io *caio,
+			struct qdma_io_cb *qiocb)
+{
+	if (!caio->pool || !cdev_obj_put(&caio->pool->qiocb, qiocb))
+		kfree(qiocb);
+}
+
+/* release a caio and the first cnt qiocbs of it, none of them submitted */
+static void cdev_caio_release(struct cdev_async_io *caio, unsigned long cnt,
+			bool write)
+{
+	unsigned long i;
+
+	for (i = 0; i < cnt; i++) {
+		struct qdma_io_cb *qiocb = container_of(caio->reqv[i],
+						struct qdma_io_cb, req);
+
+		unmap_user_buf(qiocb, write);
+		iocb_release(qiocb);
+		cdev_qiocb_put(caio, qiocb);
+	}
+	cdev_caio_put(caio);
+}
+
 static int qdma_req_completed(struct qdma_request *req,
 		       unsigned int bytes_done, int err)
 {
@@ -125,6 +356,7 @@ static int qdma_req_completed(struct qdma_request *req,
 
 	unmap_user_buf(qiocb, req->write);
 	iocb_release(qiocb);
+	cdev_qiocb_put(caio, qiocb);
 	caio->res2 |= (err < 0) ? err : 0;
 	if (caio->res2)
 		caio->err_cnt++;
@@ -137,15 +369,431 @@ static int qdma_req_completed(struct qdma_request *req,
 #else
 		aio_complete(caio->iocb, res, res2);
 #endif
-		kfree(caio->qiocb);
 		free_caio = true;
 	}
 	if (free_caio)
-		kmem_cache_free(cdev_cache, caio);
+		cdev_caio_put(caio);
 
 	return 0;
 }
 
+/*
+ * registered buffers, see qdma_cdev_buf.h
+ */
+struct qdma_cdev_buf {
+	/** file the buffer was registered on */
+	struct file *file;
+	/** buffer length */
+	unsigned long len;
+	/** # of transfers in progress */
+	unsigned int users;
+	/** # of pinned pages */
+	unsigned int pages_nr;
+	/** mm the pinned pages are charged to, NULL if not charged yet */
+	struct mm_struct *mm;
+	/** one dma mapped entry per page */
+	struct qdma_sw_sg *sgl;
+	/** pinned pages */
+	struct page **pages;
+};
+
+static inline struct device *cdev_dma_dev(struct qdma_cdev *xcdev)
+{
+	return &xcdev->xcb->xpdev->pdev->dev;
+}
+
+#if KERNEL_VERSION(4, 11, 0) > LINUX_VERSION_CODE
+#define mmgrab(mm)	atomic_inc(&(mm)->mm_count)
+#endif
+
+/* charge the pinned pages to the locked_vm of mm, see RLIMIT_MEMLOCK */
+#if KERNEL_VERSION(5, 2, 0) <= LINUX_VERSION_CODE
+#define cdev_buf_account(mm, pages, inc)	account_locked_vm(mm, pages, inc)
+#else
+static int cdev_buf_account(struct mm_struct *mm, unsigned long pages,
+			bool inc)
+{
+	unsigned long limit = rlimit(RLIMIT_MEMLOCK) >> PAGE_SHIFT;
+	int rv = 0;
+
+	down_write(&mm->mmap_sem);
+	if (!inc)
+		mm->locked_vm -= min(pages, mm->locked_vm);
+	else if (mm->locked_vm + pages > limit && !capable(CAP_IPC_LOCK))
+		rv = -ENOMEM;
+	else
+		mm->locked_vm += pages;
+	up_write(&mm->mmap_sem);
+
+	return rv;
+}
+#endif
+
+static void cdev_buf_free(struct qdma_cdev *xcdev, struct qdma_cdev_buf *cbuf)
+{
+	struct device *dev = cdev_dma_dev(xcdev);
+	struct qdma_sw_sg *sg = cbuf->sgl;
+	unsigned int i;
+
+	for (i = 0; i < cbuf->pages_nr; i++, sg++) {
+		if (sg->dma_addr)
+			dma_unmap_page(dev, sg->dma_addr - sg->offset,
+					PAGE_SIZE, DMA_BIDIRECTIONAL);
+		set_page_dirty_lock(cbuf->pages[i]);
+		put_page(cbuf->pages[i]);
+	}
+
+	if (cbuf->mm) {
+		cdev_buf_account(cbuf->mm, cbuf->pages_nr, false);
+		mmdrop(cbuf->mm);
+	}
+	vfree(cbuf);
+}
+
+static long cdev_buf_reg(struct file *file, struct qdma_cdev *xcdev,
+			struct qdma_cdev_buf_reg __user *ureg)
+{
+	struct device *dev = cdev_dma_dev(xcdev);
+	struct qdma_cdev_buf_reg reg;
+	struct qdma_cdev_buf *cbuf;
+	struct qdma_sw_sg *sg;
+	unsigned long addr, len, npages;
+	unsigned int pages_nr;
+	int i, rv;
+
+	if (copy_from_user(&reg, ureg, sizeof(reg)))
+		return -EFAULT;
+
+	if (!reg.len || reg.len > QDMA_CDEV_BUF_LEN_MAX ||
+	    reg.addr + reg.len < reg.addr)
+		return -EINVAL;
+	addr = (unsigned long)reg.addr;
+	len = (unsigned long)reg.len;
+	npages = (offset_in_page(addr) + len + PAGE_SIZE - 1) >> PAGE_SHIFT;
+	if (npages > UINT_MAX)
+		return -EINVAL;
+	pages_nr = npages;
+
+	cbuf = vzalloc(sizeof(*cbuf) + pages_nr *
+			(sizeof(struct qdma_sw_sg) + sizeof(struct page *)));
+	if (!cbuf)
+		return -ENOMEM;
+	cbuf->file = file;
+	cbuf->len = len;
+	cbuf->sgl = (struct qdma_sw_sg *)(cbuf + 1);
+	cbuf->pages = (struct page **)(cbuf->sgl + pages_nr);
+
+	rv = get_user_pages_fast(addr, pages_nr, 1/* write */, cbuf->pages);
+	if (rv < 0) {
+		pr_err("%s unable to pin down %u user pages, %d.\n",
+			xcdev->name, pages_nr, rv);
+		vfree(cbuf);
+		return rv;
+	}
+	cbuf->pages_nr = rv;
+	if (rv != pages_nr) {
+		pr_err("%s unable to pin down all %u user pages, %d.\n",
+			xcdev->name, pages_nr, rv);
+		rv = -EFAULT;
+		goto err_out;
+	}
+
+	rv = cdev_buf_account(current->mm, pages_nr, true);
+	if (rv < 0) {
+		pr_info("%s, %u pages over RLIMIT_MEMLOCK.\n",
+			xcdev->name, pages_nr);
+		goto err_out;
+	}
+	mmgrab(current->mm);
+	cbuf->mm = current->mm;
+
+	/* map every page once, for both directions */
+	sg = cbuf->sgl;
+	for (i = 0; i < pages_nr; i++, sg++) {
+		unsigned int offset = offset_in_page(addr);
+		dma_addr_t dma_addr;
+
+		flush_dcache_page(cbuf->pages[i]);
+		dma_addr = dma_map_page(dev, cbuf->pages[i], 0, PAGE_SIZE,
+					DMA_BIDIRECTIONAL);
+		if (unlikely(dma_mapping_error(dev, dma_addr))) {
+			pr_err("%s map page %d/%u failed.\n",
+				xcdev->name, i, pages_nr);
+			rv = -EIO;
+			goto err_out;
+		}
+
+		sg->pg = cbuf->pages[i];
+		sg->offset = offset;
+		sg->len = min_t(unsigned long, PAGE_SIZE - offset, len);
+		sg->dma_addr = dma_addr + offset;
+
+		addr += sg->len;
+		len -= sg->len;
+	}
+
+	spin_lock(&xcdev->buf_lock);
+	for (i = 0; i < QDMA_CDEV_BUF_MAX; i++)
+		if (!xcdev->bufs[i])
+			break;
+	if (i < QDMA_CDEV_BUF_MAX)
+		xcdev->bufs[i] = cbuf;
+	spin_unlock(&xcdev->buf_lock);
+
+	if (i == QDMA_CDEV_BUF_MAX) {
+		pr_info("%s, all %d buffers registered.\n",
+			xcdev->name, QDMA_CDEV_BUF_MAX);
+		rv = -ENOSPC;
+		goto err_out;
+	}
+
+	if (put_user(i, &ureg->index)) {
+		spin_lock(&xcdev->buf_lock);
+		xcdev->bufs[i] = NULL;
+		spin_unlock(&xcdev->buf_lock);
+		rv = -EFAULT;
+		goto err_out;
+	}
+
+	pr_debug("%s, buf %d: 0x%llx,%llu, %u pages.\n",
+		xcdev->name, i, reg.addr, reg.len, pages_nr);
+
+	return 0;
+
+err_out:
+	cdev_buf_free(xcdev, cbuf);
+	return rv;
+}
+
+static long cdev_buf_unreg(struct file *file, struct qdma_cdev *xcdev,
+			unsigned long index)
+{
+	struct qdma_cdev_buf *cbuf;
+	long rv = 0;
+
+	if (index >= QDMA_CDEV_BUF_MAX)
+		return -EINVAL;
+
+	spin_lock(&xcdev->buf_lock);
+	cbuf = xcdev->bufs[index];
+	if (!cbuf || cbuf->file != file)
+		rv = -EINVAL;
+	else if (cbuf->users)
+		rv = -EBUSY;
+	else
+		xcdev->bufs[index] = NULL;
+	spin_unlock(&xcdev->buf_lock);
+
+	if (!rv)
+		cdev_buf_free(xcdev, cbuf);
+
+	return rv;
+}
+
+/* release all the buffers registered on a file being closed */
+static void cdev_buf_release(struct file *file, struct qdma_cdev *xcdev)
+{
+	struct qdma_cdev_buf *cbuf;
+	int i;
+
+	for (i = 0; i < QDMA_CDEV_BUF_MAX; i++) {
+		spin_lock(&xcdev->buf_lock);
+		cbuf = xcdev->bufs[i];
+		if (cbuf && cbuf->file == file)
+			xcdev->bufs[i] = NULL;
+		else
+			cbuf = NULL;
+		spin_unlock(&xcdev->buf_lock);
+
+		if (cbuf)
+			cdev_buf_free(xcdev, cbuf);
+	}
+}
+
+/* the pages are mapped DMA_BIDIRECTIONAL, sync them the same way */
+static void cdev_buf_sync(struct qdma_cdev *xcdev, struct qdma_sw_sg *sgl,
+			unsigned int sgcnt, bool for_cpu)
+{
+	struct device *dev = cdev_dma_dev(xcdev);
+	unsigned int i;
+
+	for (i = 0; i < sgcnt; i++, sgl++) {
+		if (for_cpu)
+			dma_sync_single_for_cpu(dev, sgl->dma_addr, sgl->len,
+						DMA_BIDIRECTIONAL);
+		else
+			dma_sync_single_for_device(dev, sgl->dma_addr,
+						sgl->len, DMA_BIDIRECTIONAL);
+	}
+}
+
+/*
+ * transfer a registered buffer range: the request sgl is a copy of the
+ * registered entries covering the range, no page is pinned or mapped
+ */
+static long cdev_buf_rw(struct file *file, struct qdma_cdev *xcdev,
+			struct qdma_cdev_buf_io __user *uio)
+{
+	struct qdma_cdev_buf_io bio;
+	struct qdma_cdev_buf *cbuf;
+	struct qdma_io_cb iocb;
+	struct qdma_request *req = &iocb.req;
+	struct qdma_queue_conf *qconf;
+	struct qdma_sw_sg *sg;
+	unsigned long qhndl, pos, left;
+	unsigned int first, sgcnt, i;
+	bool write, cpu_copy;
+	long res;
+
+	if (copy_from_user(&bio, uio, sizeof(bio)))
+		return -EFAULT;
+
+	write = bio.write ? true : false;
+	if (!(xcdev->dir_init & (1 << (write ? 0 : 1))) || !xcdev->fp_rw)
+		return -EINVAL;
+	if (bio.index >= QDMA_CDEV_BUF_MAX || !bio.len || bio.len > UINT_MAX)
+		return -EINVAL;
+
+	spin_lock(&xcdev->buf_lock);
+	cbuf = xcdev->bufs[bio.index];
+	if (!cbuf || cbuf->file != file || bio.offset >= cbuf->len ||
+	    bio.len > cbuf->len - bio.offset)
+		cbuf = NULL;
+	else
+		cbuf->users++;
+	spin_unlock(&xcdev->buf_lock);
+	if (!cbuf)
+		return -EINVAL;
+
+	qhndl = write ? xcdev->h2c_qhndl : xcdev->c2h_qhndl;
+
+	/* entries covering [offset, offset + len) */
+	pos = cbuf->sgl[0].offset + bio.offset;
+	first = pos >> PAGE_SHIFT;
+	sgcnt = ((pos + bio.len + PAGE_SIZE - 1) >> PAGE_SHIFT) - first;
+
+	memset(&iocb, 0, sizeof(struct qdma_io_cb));
+	iocb.sgl = kmalloc_array(sgcnt, sizeof(struct qdma_sw_sg), GFP_KERNEL);
+	if (!iocb.sgl) {
+		res = -ENOMEM;
+		goto out;
+	}
+	memcpy(iocb.sgl, cbuf->sgl + first, sgcnt * sizeof(struct qdma_sw_sg));
+
+	sg = iocb.sgl;
+	left = bio.len;
+	for (i = 0; i < sgcnt; i++, sg++) {
+		if (!i) {
+			unsigned int delta = offset_in_page(pos) - sg->offset;
+
+			sg->offset += delta;
+			sg->dma_addr += delta;
+			sg->len -= delta;
+		}
+		sg->len = min_t(unsigned long, sg->len, left);
+		sg->next = sg + 1;
+		left -= sg->len;
+	}
+	iocb.sgl[sgcnt - 1].next = NULL;
+
+	/* the ST C2H copy path fills the pages with the cpu */
+	qconf = qdma_queue_get_config(xcdev->xcb->xpdev->dev_hndl, qhndl,
+					NULL, 0);
+	cpu_copy = qconf && qconf->st && qconf->c2h && !qconf->c2h_zerocopy;
+
+	cdev_buf_sync(xcdev, iocb.sgl, sgcnt, false);
+
+	req->sgcnt = sgcnt;
+	req->sgl = iocb.sgl;
+	req->write = write ? 1 : 0;
+	req->dma_mapped = 1;
+	req->udd_len = 0;
+	req->ep_addr = bio.ep_addr;
+	req->count = bio.len;
+	req->timeout_ms = 10 * 1000;	/* 10 seconds */
+	req->fp_done = NULL;		/* blocking */
+	req->h2c_eot = 1;		/* set to 1 for STM tests */
+
+	res = xcdev->fp_rw(xcdev->xcb->xpdev->dev_hndl, qhndl, req);
+
+	if (!write && !cpu_copy)
+		cdev_buf_sync(xcdev, iocb.sgl, sgcnt, true);
+
+	kfree(iocb.sgl);
+out:
+	spin_lock(&xcdev->buf_lock);
+	cbuf->users--;
+	spin_unlock(&xcdev->buf_lock);
+
+	return res;
+}
+
+/*
+ * striped MM read/write, see qdma_cdev_stripe.h
+ */
+static long cdev_stripe_set(struct qdma_cdev *xcdev,
+			struct qdma_cdev_stripe __user *ustripe)
+{
+	struct xlnx_pci_dev *xpdev = xcdev->xcb->xpdev;
+	struct qdma_cdev_stripe stripe;
+	unsigned long h2c[QDMA_CDEV_STRIPE_MAX + 1];
+	unsigned long c2h[QDMA_CDEV_STRIPE_MAX + 1];
+	unsigned int i;
+
+	if (copy_from_user(&stripe, ustripe, sizeof(stripe)))
+		return -EFAULT;
+	if (stripe.qcnt > QDMA_CDEV_STRIPE_MAX)
+		return -EINVAL;
+
+	h2c[0] = xcdev->h2c_qhndl;
+	c2h[0] = xcdev->c2h_qhndl;
+	for (i = 0; i < stripe.qcnt; i++) {
+		struct xlnx_qdata *qdata;
+
+		if (xcdev->dir_init & (1 << 0)) {
+			qdata = xpdev_queue_get(xpdev, stripe.qidx[i], 0, 1,
+						NULL, 0);
+			if (!qdata || !qdata->qhndl)
+				return -EINVAL;
+			h2c[i + 1] = qdata->qhndl;
+		}
+		if (xcdev->dir_init & (1 << 1)) {
+			qdata = xpdev_queue_get(xpdev, stripe.qidx[i], 1, 1,
+						NULL, 0);
+			if (!qdata || !qdata->qhndl)
+				return -EINVAL;
+			c2h[i + 1] = qdata->qhndl;
+		}
+	}
+
+	spin_lock(&xcdev->buf_lock);
+	memcpy(xcdev->stripe_h2c, h2c, sizeof(h2c));
+	memcpy(xcdev->stripe_c2h, c2h, sizeof(c2h));
+	xcdev->stripe_cnt = stripe.qcnt ? stripe.qcnt + 1 : 0;
+	spin_unlock(&xcdev->buf_lock);
+
+	pr_debug("%s, striping over %u queues.\n", xcdev->name,
+		xcdev->stripe_cnt);
+
+	return 0;
+}
+
+/* queue handles to stripe the request over, 0 if not striped */
+static unsigned int cdev_stripe_get(struct qdma_cdev *xcdev, bool write,
+				unsigned long *qhndls)
+{
+	unsigned int cnt;
+
+	spin_lock(&xcdev->buf_lock);
+	cnt = xcdev->stripe_cnt;
+	if (cnt)
+		memcpy(qhndls, write ? xcdev->stripe_h2c : xcdev->stripe_c2h,
+			cnt * sizeof(unsigned long));
+	spin_unlock(&xcdev->buf_lock);
+
+	return cnt;
+}
+
 /*
  * character device file operations
  */
@@ -165,6 +813,9 @@ static int cdev_gen_close(struct inode *inode, struct file *file)
 {
 	struct qdma_cdev *xcdev = (struct qdma_cdev *)file->private_data;
 
+	if (xcdev)
+		cdev_buf_release(file, xcdev);
+
 	if (xcdev && xcdev->fp_close_extra)
 		return xcdev->fp_close_extra(xcdev);
 
@@ -208,6 +859,27 @@ static long cdev_gen_ioctl(struct file *file, unsigned int cmd,
 	case QDMA_CDEV_IOCTL_NO_MEMCPY:
 		get_user(xcdev->no_memcpy, (unsigned char *)arg);
 		return 0;
+	case QDMA_C2H_RING_IOCTL_WAIT: {
+		unsigned int timeout_ms;
+
+		if (!(xcdev->dir_init & (1 << 1)))
+			return -EINVAL;
+		if (get_user(timeout_ms, (unsigned int __user *)arg))
+			return -EFAULT;
+		return qdma_queue_c2h_ring_wait(xcdev->xcb->xpdev->dev_hndl,
+					xcdev->c2h_qhndl, timeout_ms);
+	}
+	case QDMA_CDEV_IOCTL_BUF_REG:
+		return cdev_buf_reg(file, xcdev,
+				(struct qdma_cdev_buf_reg __user *)arg);
+	case QDMA_CDEV_IOCTL_BUF_UNREG:
+		return cdev_buf_unreg(file, xcdev, arg);
+	case QDMA_CDEV_IOCTL_BUF_RW:
+		return cdev_buf_rw(file, xcdev,
+				(struct qdma_cdev_buf_io __user *)arg);
+	case QDMA_CDEV_IOCTL_STRIPE_SET:
+		return cdev_stripe_set(xcdev,
+				(struct qdma_cdev_stripe __user *)arg);
 	case 0x5401:
 		// Why does python always call this one???
 		// Apparently because of https://bugs.python.org/issue34070
@@ -223,6 +895,31 @@ static long cdev_gen_ioctl(struct file *file, unsigned int cmd,
 	return -EINVAL;
 }
 
+/*
+ * ST C2H free list ring, see qdma_c2h_ring.h
+ */
+static int cdev_gen_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct qdma_cdev *xcdev = (struct qdma_cdev *)file->private_data;
+
+	if (!(xcdev->dir_init & (1 << 1))) {
+		pr_info("%s, mmap NOT supported, no C2H queue.\n",
+			xcdev->name);
+		return -EINVAL;
+	}
+	if (!(vma->vm_flags & VM_SHARED))
+		return -EINVAL;
+
+#if KERNEL_VERSION(6, 3, 0) <= LINUX_VERSION_CODE
+	vm_flags_set(vma, VM_DONTEXPAND | VM_DONTDUMP);
+#else
+	vma->vm_flags |= VM_DONTEXPAND | VM_DONTDUMP;
+#endif
+
+	return qdma_queue_c2h_ring_mmap(xcdev->xcb->xpdev->dev_hndl,
+				xcdev->c2h_qhndl, vma);
+}
+
 /*
  * cdev r/w
  */
@@ -230,7 +927,8 @@ static inline void iocb_release(struct qdma_io_cb *iocb)
 {
 	if (iocb->pages)
 		iocb->pages = NULL;
-	kfree(iocb->sgl);
+	if (iocb->sgl != iocb->sgl_pool)
+		kfree(iocb->sgl);
 	iocb->sgl = NULL;
 	iocb->buf = NULL;
 }
@@ -273,17 +971,23 @@ static int map_user_buf_to_sgl(struct qdma_io_cb *iocb, bool write)
 		return -EINVAL;
 
 	iocb->pages_nr = 0;
-	sg = kmalloc(pages_nr * (sizeof(struct qdma_sw_sg) +
-			sizeof(struct page *)), GFP_KERNEL);
-	if (!sg) {
-		pr_err("sgl allocation failed for %u pages", pages_nr);
-		return -ENOMEM;
+	if (pages_nr <= iocb->sgl_pool_nr) {
+		/* preallocated, the page array follows sgl_pool_nr entries */
+		sg = iocb->sgl_pool;
+		iocb->pages = (struct page **)(sg + iocb->sgl_pool_nr);
+	} else {
+		sg = kmalloc(pages_nr * (sizeof(struct qdma_sw_sg) +
+				sizeof(struct page *)), GFP_KERNEL);
+		if (!sg) {
+			pr_err("sgl allocation failed for %u pages", pages_nr);
+			return -ENOMEM;
+		}
+		iocb->pages = (struct page **)(sg + pages_nr);
 	}
-	memset(sg, 0, pages_nr * (sizeof(struct qdma_sw_sg) +
-			sizeof(struct page *)));
+	memset(sg, 0, pages_nr * sizeof(struct qdma_sw_sg));
+	memset(iocb->pages, 0, pages_nr * sizeof(struct page *));
 	iocb->sgl = sg;
 
-	iocb->pages = (struct page **)(sg + pages_nr);
 	rv = get_user_pages_fast((unsigned long)buf, pages_nr, 1/* write */,
 				iocb->pages);
 	/* No pages were pinned */
@@ -347,6 +1051,8 @@ static ssize_t cdev_gen_read_write(struct file *file, char __user *buf,
 	struct qdma_cdev *xcdev = (struct qdma_cdev *)file->private_data;
 	struct qdma_io_cb iocb;
 	struct qdma_request *req = &iocb.req;
+	unsigned long stripe[QDMA_CDEV_STRIPE_MAX + 1];
+	unsigned int stripe_cnt;
 	ssize_t res = 0;
 	int rv;
 	unsigned long qhndl;
@@ -387,7 +1093,12 @@ static ssize_t cdev_gen_read_write(struct file *file, char __user *buf,
 	req->fp_done = NULL;		/* blocking */
 	req->h2c_eot = 1;		/* set to 1 for STM tests */
 
-	res = xcdev->fp_rw(xcdev->xcb->xpdev->dev_hndl, qhndl, req);
+	stripe_cnt = cdev_stripe_get(xcdev, write, stripe);
+	if (stripe_cnt)
+		res = qdma_request_submit_striped(xcdev->xcb->xpdev->dev_hndl,
+					stripe_cnt, stripe, req);
+	else
+		res = xcdev->fp_rw(xcdev->xcb->xpdev->dev_hndl, qhndl, req);
 
 	unmap_user_buf(&iocb, write);
 	iocb_release(&iocb);
@@ -428,31 +1139,30 @@ static ssize_t cdev_aio_write(struct kiocb *iocb, const struct iovec *io,
 		return -EINVAL;
 	}
 
-	caio = kmem_cache_alloc(cdev_cache, GFP_KERNEL);
+	caio = cdev_caio_get(xcdev, xcdev->h2c_qhndl, count);
 	if (!caio) {
-		pr_info("OOM");
+		pr_err("failed to allocate caio");
 		return -ENOMEM;
 	}
-	memset(caio, 0, sizeof(struct cdev_async_io));
-	caio->qiocb = kzalloc(count * (sizeof(struct qdma_io_cb) +
-			sizeof(struct qdma_request *)), GFP_KERNEL);
-	if (!caio->qiocb) {
-		pr_err("failed to allocate qiocb");
-		return -ENOMEM;
-	}
-	caio->reqv = (struct qdma_request **)(caio->qiocb + count);
 	for (i = 0; i < count; i++) {
-		caio->qiocb[i].private = caio;
-		caio->reqv[i] = &(caio->qiocb[i].req);
-		caio->qiocb[i].buf = io[i].iov_base;
-		caio->qiocb[i].len = io[i].iov_len;
-		rv = map_user_buf_to_sgl(&(caio->qiocb[i]), true);
-		if (rv < 0)
+		struct qdma_io_cb *qiocb = cdev_qiocb_get(caio);
+
+		if (!qiocb) {
+			rv = -ENOMEM;
+			break;
+		}
+		caio->reqv[i] = &qiocb->req;
+		qiocb->buf = io[i].iov_base;
+		qiocb->len = io[i].iov_len;
+		rv = map_user_buf_to_sgl(qiocb, true);
+		if (rv < 0) {
+			cdev_qiocb_put(caio, qiocb);
 			break;
+		}
 
 		caio->reqv[i]->write = 1;
-		caio->reqv[i]->sgcnt = caio->qiocb[i].pages_nr;
-		caio->reqv[i]->sgl = caio->qiocb[i].sgl;
+		caio->reqv[i]->sgcnt = qiocb->pages_nr;
+		caio->reqv[i]->sgl = qiocb->sgl;
 		caio->reqv[i]->dma_mapped = false;
 		caio->reqv[i]->udd_len = 0;
 		caio->reqv[i]->ep_addr = (u64)pos;
@@ -462,22 +1172,25 @@ static ssize_t cdev_aio_write(struct kiocb *iocb, const struct iovec *io,
 		caio->reqv[i]->fp_done = qdma_req_completed;
 		pos += io[i].iov_len;
 	}
-	if (i > 0) {
-		iocb->private = caio;
-		caio->iocb = iocb;
-		caio->req_count = i;
-		qhndl = xcdev->h2c_qhndl;
-		rv = xcdev->fp_aiorw(xcdev->xcb->xpdev->dev_hndl, qhndl,
-				     caio->req_count, caio->reqv);
-		if (rv >= 0)
-			rv = -EIOCBQUEUED;
-	} else {
-		pr_err("failed with %d for %lu reqs", rv, caio->req_count);
-		kfree(caio->qiocb);
-		kmem_cache_free(cdev_cache, caio);
+	if (rv < 0 || !i) {
+		pr_err("failed with %d for %lu/%lu reqs", rv, i, count);
+		cdev_caio_release(caio, i, true);
+		return rv;
 	}
 
-	return rv;
+	iocb->private = caio;
+	caio->iocb = iocb;
+	caio->req_count = i;
+	qhndl = xcdev->h2c_qhndl;
+	rv = xcdev->fp_aiorw(xcdev->xcb->xpdev->dev_hndl, qhndl,
+			     caio->req_count, caio->reqv);
+	if (rv < 0) {
+		/* none of the requests was taken */
+		cdev_caio_release(caio, caio->req_count, true);
+		return rv;
+	}
+
+	return -EIOCBQUEUED;
 }
 
 static ssize_t cdev_aio_read(struct kiocb *iocb, const struct iovec *io,
@@ -501,31 +1214,30 @@ static ssize_t cdev_aio_read(struct kiocb *iocb, const struct iovec *io,
 		return -EINVAL;
 	}
 
-	caio = kmem_cache_alloc(cdev_cache, GFP_KERNEL);
+	caio = cdev_caio_get(xcdev, xcdev->c2h_qhndl, count);
 	if (!caio) {
-		pr_err("failed to allocate qiocb");
+		pr_err("failed to allocate caio");
 		return -ENOMEM;
 	}
-	memset(caio, 0, sizeof(struct cdev_async_io));
-	caio->qiocb = kzalloc(count * (sizeof(struct qdma_io_cb) +
-			sizeof(struct qdma_request *)), GFP_KERNEL);
-	if (!caio->qiocb) {
-		pr_err("failed to allocate qiocb");
-		return -ENOMEM;
-	}
-	caio->reqv = (struct qdma_request **)(caio->qiocb + count);
 	for (i = 0; i < count; i++) {
-		caio->qiocb[i].private = caio;
-		caio->reqv[i] = &(caio->qiocb[i].req);
-		caio->qiocb[i].buf = io[i].iov_base;
-		caio->qiocb[i].len = io[i].iov_len;
-		rv = map_user_buf_to_sgl(&(caio->qiocb[i]), false);
-		if (rv < 0)
+		struct qdma_io_cb *qiocb = cdev_qiocb_get(caio);
+
+		if (!qiocb) {
+			rv = -ENOMEM;
 			break;
+		}
+		caio->reqv[i] = &qiocb->req;
+		qiocb->buf = io[i].iov_base;
+		qiocb->len = io[i].iov_len;
+		rv = map_user_buf_to_sgl(qiocb, false);
+		if (rv < 0) {
+			cdev_qiocb_put(caio, qiocb);
+			break;
+		}
 
 		caio->reqv[i]->write = 0;
-		caio->reqv[i]->sgcnt = caio->qiocb[i].pages_nr;
-		caio->reqv[i]->sgl = caio->qiocb[i].sgl;
+		caio->reqv[i]->sgcnt = qiocb->pages_nr;
+		caio->reqv[i]->sgl = qiocb->sgl;
 		caio->reqv[i]->dma_mapped = false;
 		caio->reqv[i]->udd_len = 0;
 		caio->reqv[i]->ep_addr = (u64)pos;
@@ -535,22 +1247,25 @@ static ssize_t cdev_aio_read(struct kiocb *iocb, const struct iovec *io,
 		caio->reqv[i]->fp_done = qdma_req_completed;
 		pos += io[i].iov_len;
 	}
-	if (i > 0) {
-		iocb->private = caio;
-		caio->iocb = iocb;
-		caio->req_count = i;
-		qhndl = xcdev->c2h_qhndl;
-		rv = xcdev->fp_aiorw(xcdev->xcb->xpdev->dev_hndl, qhndl,
-				     caio->req_count, caio->reqv);
-		if (rv >= 0)
-			rv = -EIOCBQUEUED;
-	} else {
-		pr_err("failed with %d for %lu reqs", rv, caio->req_count);
-		kfree(caio->qiocb);
-		kmem_cache_free(cdev_cache, caio);
+	if (rv < 0 || !i) {
+		pr_err("failed with %d for %lu/%lu reqs", rv, i, count);
+		cdev_caio_release(caio, i, false);
+		return rv;
 	}
 
-	return rv;
+	iocb->private = caio;
+	caio->iocb = iocb;
+	caio->req_count = i;
+	qhndl = xcdev->c2h_qhndl;
+	rv = xcdev->fp_aiorw(xcdev->xcb->xpdev->dev_hndl, qhndl,
+			     caio->req_count, caio->reqv);
+	if (rv < 0) {
+		/* none of the requests was taken */
+		cdev_caio_release(caio, caio->req_count, false);
+		return rv;
+	}
+
+	return -EIOCBQUEUED;
 }
 
 #if KERNEL_VERSION(3, 16, 0) <= LINUX_VERSION_CODE
@@ -582,6 +1297,7 @@ static const struct file_operations cdev_gen_fops = {
 	.aio_read = cdev_aio_read,
 #endif
 	.unlocked_ioctl = cdev_gen_ioctl,
+	.mmap = cdev_gen_mmap,
 	.llseek = cdev_gen_llseek,
 };
 
@@ -609,6 +1325,8 @@ void qdma_cdev_destroy(struct qdma_cdev *xcdev)
 
 	cdev_del(&xcdev->cdev);
 
+	cdev_aio_pool_destroy(xcdev->aio_pool);
+
 	kfree(xcdev);
 }
 
@@ -634,6 +1352,7 @@ int qdma_cdev_create(struct qdma_cdev_cb *xcb, struct pci_dev *pdev,
 
 	xcdev->cdev.owner = THIS_MODULE;
 	xcdev->xcb = xcb;
+	spin_lock_init(&xcdev->buf_lock);
 	priv_data = qconf->c2h ? &xcdev->c2h_qhndl : &xcdev->h2c_qhndl;
 	*priv_data = qhndl;
 	xcdev->dir_init = (1 << qconf->c2h);
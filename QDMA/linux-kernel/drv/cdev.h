@@ -30,6 +30,9 @@
 
 #include "libqdma/libqdma_export.h"
 #include <linux/workqueue.h>
+#include "qdma_c2h_ring.h"
+#include "qdma_cdev_buf.h"
+#include "qdma_cdev_stripe.h"
 
 /** QDMA character device class name */
 #define QDMA_CDEV_CLASS_NAME  DRV_MODULE_NAME
@@ -52,6 +55,11 @@ struct qdma_cdev_cb {
 	int cdev_minor_cnt;
 };
 
+/** registered user buffer, see qdma_cdev_buf.h */
+struct qdma_cdev_buf;
+/** preallocated aio request objects */
+struct cdev_aio_pool;
+
 /**
  * @struct - qdma_cdev
  * @brief	QDMA character device book keeping parameters
@@ -77,6 +85,18 @@ struct qdma_cdev {
 	unsigned short dir_init;
 	/* flag to indicate if memcpy is required */
 	unsigned char no_memcpy;
+	/** registered buffer table and striping queues lock */
+	spinlock_t buf_lock;
+	/** registered buffers, indexed by the QDMA_CDEV_IOCTL_BUF_REG index */
+	struct qdma_cdev_buf *bufs[QDMA_CDEV_BUF_MAX];
+	/** aio request objects, sized from the ring size on the first aio */
+	struct cdev_aio_pool *aio_pool;
+	/** # of striping queues, this cdev queue included, 0: no striping */
+	unsigned int stripe_cnt;
+	/** h2c striping queue handles */
+	unsigned long stripe_h2c[QDMA_CDEV_STRIPE_MAX + 1];
+	/** c2h striping queue handles */
+	unsigned long stripe_c2h[QDMA_CDEV_STRIPE_MAX + 1];
 	/** call back function for open a device */
 	int (*fp_open_extra)(struct qdma_cdev *xcdev);
 	/** call back function for close a device */
@@ -109,6 +129,10 @@ struct qdma_io_cb {
 	struct qdma_sw_sg *sgl;
 	/** pages allocated to accommodate the scatter gather list */
 	struct page **pages;
+	/** preallocated scatter gather list, followed by its page array */
+	struct qdma_sw_sg *sgl_pool;
+	/** # of preallocated scatter gather list entries */
+	unsigned int sgl_pool_nr;
 	/** qdma request */
 	struct qdma_request req;
 };
@@ -83,6 +83,9 @@ static struct nla_policy xnl_policy[XNL_ATTR_MAX] = {
 
 	[XNL_ATTR_DEV_STM_BAR] =	{ .type = NLA_U32 },
 	[XNL_ATTR_Q_STATE]   =		{ .type = NLA_U32 },
+	[XNL_ATTR_Q_BATCH] =		{ .type = NLA_BINARY,
+					  .len = XNL_Q_BATCH_OPS_MAX *
+						sizeof(struct xnl_q_batch_op) },
 #ifdef ERR_DEBUG
 	[XNL_ATTR_QPARAM_ERR_INFO] =    { .type = NLA_U32 },
 #endif
@@ -109,6 +112,7 @@ static int xnl_register_read(struct sk_buff *, struct genl_info *);
 static int xnl_register_write(struct sk_buff *, struct genl_info *);
 static int xnl_get_global_csr(struct sk_buff *skb2, struct genl_info *info);
 static int xnl_get_queue_state(struct sk_buff *, struct genl_info *);
+static int xnl_q_batch(struct sk_buff *, struct genl_info *);
 
 #ifdef ERR_DEBUG
 static int xnl_err_induce(struct sk_buff *skb2, struct genl_info *info);
@@ -220,6 +224,11 @@ struct genl_ops xnl_ops[] = {
 		.policy = xnl_policy,
 		.doit = xnl_get_queue_state,
 	},
+	{
+		.cmd = XNL_CMD_Q_BATCH,
+		.policy = xnl_policy,
+		.doit = xnl_q_batch,
+	},
 #ifdef ERR_DEBUG
 	{
 		.cmd = XNL_CMD_Q_ERR_INDUCE,
@@ -365,6 +374,9 @@ static int xnl_dump_attrs(struct genl_info *info)
 					pr_info("attr %d, %s, str NULL.\n",
 						i, xnl_attr_str[i]);
 
+			} else if (xnl_policy[i].type == NLA_BINARY) {
+				pr_info("attr %s, binary len %d.\n",
+					xnl_attr_str[i], nla_len(na));
 			} else {
 				u32 v = nla_get_u32(na);
 
@@ -474,22 +486,12 @@ respond_error:
 	return NULL;
 }
 
-static int qconf_get(struct qdma_queue_conf *qconf, struct genl_info *info,
+static int qconf_from_qflag(struct qdma_queue_conf *qconf, u32 f, u32 qidx,
 			char *err, int errlen, unsigned char *is_qp)
 {
-	u32 f = 0;
-
-	if (!qconf || !info)
-		return -EINVAL;
-
-	if (!info->attrs[XNL_ATTR_QFLAG]) {
-		snprintf(err, errlen, "Missing attribute 'XNL_ATTR_QFLAG'\n");
-		goto respond_error;
-	}
-	f = nla_get_u32(info->attrs[XNL_ATTR_QFLAG]);
 	if ((f & XNL_F_QMODE_ST) && (f & XNL_F_QMODE_MM)) {
 		snprintf(err, errlen, "ERR! Both ST and MM mode set.\n");
-		goto respond_error;
+		return -EINVAL;
 	} else if (!(f & XNL_F_QMODE_ST) && !(f & XNL_F_QMODE_MM)) {
 		/* default to MM */
 		f |= XNL_F_QMODE_MM;
@@ -505,13 +507,32 @@ static int qconf_get(struct qdma_queue_conf *qconf, struct genl_info *info,
 	qconf->c2h = (f & XNL_F_QDIR_C2H) ? 1 : 0;
 	*is_qp = ((f & XNL_F_QDIR_BOTH) == XNL_F_QDIR_BOTH) ? 1 : 0;
 
+	qconf->qidx = qidx;
+	if (qconf->qidx == XNL_QIDX_INVALID)
+		qconf->qidx = QDMA_QUEUE_IDX_INVALID;
+
+	return 0;
+}
+
+static int qconf_get(struct qdma_queue_conf *qconf, struct genl_info *info,
+			char *err, int errlen, unsigned char *is_qp)
+{
+	if (!qconf || !info)
+		return -EINVAL;
+
+	if (!info->attrs[XNL_ATTR_QFLAG]) {
+		snprintf(err, errlen, "Missing attribute 'XNL_ATTR_QFLAG'\n");
+		goto respond_error;
+	}
 	if (!info->attrs[XNL_ATTR_QIDX]) {
 		snprintf(err, errlen, "Missing attribute 'XNL_ATTR_QIDX'");
 		goto respond_error;
 	}
-	qconf->qidx = nla_get_u32(info->attrs[XNL_ATTR_QIDX]);
-	if (qconf->qidx == XNL_QIDX_INVALID)
-		qconf->qidx = QDMA_QUEUE_IDX_INVALID;
+
+	if (qconf_from_qflag(qconf, nla_get_u32(info->attrs[XNL_ATTR_QFLAG]),
+			     nla_get_u32(info->attrs[XNL_ATTR_QIDX]), err,
+			     errlen, is_qp) < 0)
+		goto respond_error;
 
 	return 0;
 
@@ -557,11 +578,9 @@ static int xnl_chk_attr(enum xnl_attr_t xnl_attr, struct genl_info *info,
 	return rv;
 }
 
-static void xnl_extract_extra_config_attr(struct genl_info *info,
+static void xnl_extract_extra_config_qflag(u32 f,
 					struct qdma_queue_conf *qconf)
 {
-	u32 f = nla_get_u32(info->attrs[XNL_ATTR_QFLAG]);
-
 	qconf->desc_bypass = (f & XNL_F_DESC_BYPASS_EN) ? 1 : 0;
 	qconf->pfetch_bypass = (f & XNL_F_PFETCH_BYPASS_EN) ? 1 : 0;
 	qconf->pfetch_en = (f & XNL_F_PFETCH_EN) ? 1 : 0;
@@ -574,9 +593,19 @@ static void xnl_extract_extra_config_attr(struct genl_info *info,
 	qconf->cmpl_udd_en = (f & XNL_F_CMPL_UDD_EN) ? 1 : 0;
 	qconf->cmpl_ovf_chk_dis = (f & XNL_F_CMPT_OVF_CHK_DIS) ? 1 : 0;
 	qconf->en_mm_cmpt = (f & XNL_F_EN_MM_CMPL) ? 1 : 0;
+	qconf->c2h_zerocopy = (f & XNL_F_C2H_ZEROCOPY) ? 1 : 0;
+	qconf->adaptive_cmpl = (f & XNL_F_C2H_ADAPTIVE_CMPL) ? 1 : 0;
+	qconf->cmpl_poll = (f & XNL_F_CMPL_POLL) ? 1 : 0;
 
 	if (qconf->en_mm_cmpt)
 		qconf->cmpl_udd_en = 1;
+}
+
+static void xnl_extract_extra_config_attr(struct genl_info *info,
+					struct qdma_queue_conf *qconf)
+{
+	xnl_extract_extra_config_qflag(
+			nla_get_u32(info->attrs[XNL_ATTR_QFLAG]), qconf);
 
 	if (xnl_chk_attr(XNL_ATTR_QRNGSZ_IDX, info, qconf->qidx, NULL, 0) == 0)
 		qconf->desc_rng_sz_idx = qconf->cmpl_rng_sz_idx =
@@ -1098,6 +1127,37 @@ free_buf:
 	return rv;
 }
 
+static int xnl_q_range_add(struct xlnx_pci_dev *xpdev,
+			struct qdma_queue_conf *qconf, unsigned char is_qp,
+			unsigned int num_q, char *buf, int buflen)
+{
+	char *cur = buf, *end = buf + buflen;
+	unsigned short qidx = qconf->qidx;
+	unsigned char is_c2h = qconf->c2h;
+	unsigned int i;
+	int rv;
+
+	for (i = 0; i < num_q; i++) {
+		qconf->c2h = is_c2h;
+add_q:
+		if (qidx != QDMA_QUEUE_IDX_INVALID)
+			qconf->qidx = qidx + i;
+		rv = xpdev_queue_add(xpdev, qconf, cur, end - cur);
+		if (rv < 0) {
+			pr_err("xpdev_queue_add() failed: %d\n", rv);
+			return rv;
+		}
+		cur = buf + strlen(buf);
+		if (is_qp && (is_c2h == qconf->c2h)) {
+			qconf->c2h = ~qconf->c2h;
+			goto add_q;
+		}
+	}
+	snprintf(cur, end - cur, "Added %d Queues.\n", i);
+
+	return 0;
+}
+
 static int xnl_q_add(struct sk_buff *skb2, struct genl_info *info)
 {
 	struct xlnx_pci_dev *xpdev = NULL;
@@ -1107,9 +1167,7 @@ static int xnl_q_add(struct sk_buff *skb2, struct genl_info *info)
 	int rv2 = 0;
 	unsigned char is_qp;
 	unsigned int num_q;
-	unsigned int i;
 	unsigned short qidx;
-	unsigned char is_c2h;
 	int buf_len = XNL_RESP_BUFLEN_MAX;
 
 	if (info == NULL)
@@ -1149,24 +1207,7 @@ static int xnl_q_add(struct sk_buff *skb2, struct genl_info *info)
 		goto send_resp;
 	num_q = nla_get_u32(info->attrs[XNL_ATTR_NUM_Q]);
 
-	is_c2h = qconf.c2h;
-	for (i = 0; i < num_q; i++) {
-		qconf.c2h = is_c2h;
-add_q:
-		if (qidx != QDMA_QUEUE_IDX_INVALID)
-			qconf.qidx = qidx + i;
-		rv = xpdev_queue_add(xpdev, &qconf, cur, end - cur);
-		if (rv < 0) {
-			pr_err("xpdev_queue_add() failed: %d\n", rv);
-			goto send_resp;
-		}
-		cur = buf + strlen(buf);
-		if (is_qp && (is_c2h == qconf.c2h)) {
-			qconf.c2h = ~qconf.c2h;
-			goto add_q;
-		}
-	}
-	cur += snprintf(cur, end - cur, "Added %d Queues.\n", i);
+	rv = xnl_q_range_add(xpdev, &qconf, is_qp, num_q, cur, end - cur);
 
 send_resp:
 	// check attr might add to the buffer, add to the buffer.
@@ -1196,19 +1237,57 @@ static int xnl_q_buf_idx_get(struct xlnx_pci_dev *xpdev)
 	return 0;
 }
 
+static int xnl_q_range_config(struct xlnx_pci_dev *xpdev,
+			struct qdma_queue_conf *qconf, unsigned char is_qp,
+			unsigned int num_q, unsigned char is_bufsz_idx,
+			char *buf, int buflen)
+{
+	struct qdma_queue_conf *qconf_old;
+	struct xlnx_qdata *qdata;
+	unsigned short qidx = qconf->qidx;
+	unsigned char is_c2h = qconf->c2h;
+	unsigned int i;
+	int rv;
+
+	for (i = qidx; i < (qidx + num_q); i++) {
+		qconf->c2h = is_c2h;
+reconfig:
+		qconf->qidx = i;
+		qdata = xpdev_queue_get(xpdev, i, qconf->c2h, 1, buf, buflen);
+		if (!qdata) {
+			snprintf(buf, buflen, "ERR! qidx %u invalid.\n", i);
+			return -EINVAL;
+		}
+		qconf_old = qdma_queue_get_config(xpdev->dev_hndl, qdata->qhndl,
+						  buf, buflen);
+		if (qconf_old->st && qconf_old->c2h && !is_bufsz_idx)
+			qconf->c2h_buf_sz_idx = xnl_q_buf_idx_get(xpdev);
+		rv = qdma_queue_config(xpdev->dev_hndl, qdata->qhndl, qconf,
+						buf, buflen);
+		if (rv < 0) {
+			pr_err("qdma_queue_config failed: %d", rv);
+			return rv;
+		}
+		if (is_qp && (is_c2h == qconf->c2h)) {
+			qconf->c2h = ~qconf->c2h;
+			goto reconfig;
+		}
+	}
+	qconf->qidx = qidx;
+	qconf->c2h = is_c2h;
+
+	return 0;
+}
+
 static int xnl_q_start(struct sk_buff *skb2, struct genl_info *info)
 {
 	struct xlnx_pci_dev *xpdev;
 	struct qdma_queue_conf qconf;
-	struct qdma_queue_conf *qconf_old;
 	char buf[XNL_RESP_BUFLEN_MIN];
-	struct xlnx_qdata *qdata;
 	int rv = 0;
 	unsigned char is_qp;
 	unsigned short num_q;
-	unsigned int i;
 	unsigned short qidx;
-	unsigned char is_c2h;
 	unsigned char is_bufsz_idx = 1;
 
 	if (info == NULL)
@@ -1245,38 +1324,13 @@ static int xnl_q_start(struct sk_buff *skb2, struct genl_info *info)
 	if (!info->attrs[XNL_ATTR_C2H_BUFSZ_IDX])
 		is_bufsz_idx = 0;
 
-	is_c2h = qconf.c2h;
-
-	for (i = qidx; i < (qidx + num_q); i++) {
-		qconf.c2h = is_c2h;
-reconfig:
-		qconf.qidx = i;
-		qdata = xnl_rcv_check_qidx(info, xpdev, &qconf, buf,
-					XNL_RESP_BUFLEN_MIN);
-		if (!qdata)
-			goto send_resp;
-		qconf_old = qdma_queue_get_config(xpdev->dev_hndl, qdata->qhndl,
-						  buf, XNL_RESP_BUFLEN_MIN);
-		if (qconf_old->st && qconf_old->c2h && !is_bufsz_idx)
-			qconf.c2h_buf_sz_idx = xnl_q_buf_idx_get(xpdev);
-		rv = qdma_queue_config(xpdev->dev_hndl, qdata->qhndl, &qconf,
-						buf, XNL_RESP_BUFLEN_MIN);
-		if (rv < 0) {
-			pr_err("qdma_queue_config failed: %d", rv);
-			goto send_resp;
-		}
-		if (is_qp && (is_c2h == qconf.c2h)) {
-			qconf.c2h = ~qconf.c2h;
-			goto reconfig;
-		}
-	}
-
-	rv = xpdev_nl_queue_start(xpdev, info, is_qp, is_c2h, qidx, num_q);
-	if (rv < 0) {
-		snprintf(buf, XNL_RESP_BUFLEN_MIN, "qdma%05x OOM.\n",
-			xpdev->idx);
+	rv = xnl_q_range_config(xpdev, &qconf, is_qp, num_q, is_bufsz_idx,
+				buf, XNL_RESP_BUFLEN_MIN);
+	if (rv < 0)
 		goto send_resp;
-	}
+
+	/* responds with the start result */
+	xpdev_nl_queue_start(xpdev, info, is_qp, qconf.c2h, qidx, num_q);
 
 	return 0;
 
@@ -1286,18 +1340,46 @@ send_resp:
 	return rv;
 }
 
+static int xnl_q_range_stop(struct xlnx_pci_dev *xpdev, unsigned short qidx,
+			unsigned int num_q, unsigned char is_qp,
+			unsigned char is_c2h, char *buf, int buflen)
+{
+	struct qdma_queue_bulk_stats stats;
+	unsigned long *qhndls;
+	unsigned int nr;
+	int rv;
+
+	qhndls = xpdev_queue_hndls_get(xpdev, qidx, num_q, is_qp, is_c2h,
+				&nr, buf, buflen);
+	if (!qhndls)
+		return -EINVAL;
+
+	/** all the queues stop taking requests, then drain together */
+	rv = qdma_queue_stop_bulk(xpdev->dev_hndl, nr, qhndls, &stats,
+				  buf, buflen);
+	kfree(qhndls);
+	if (rv < 0) {
+		pr_err("qdma_queue_stop_bulk() failed: %d", rv);
+		return rv;
+	}
+	snprintf(buf, buflen,
+		 "Stopped Queues %d -> %d, drain %llu us, ctxt %llu us, free %llu us.\n",
+		 qidx, qidx + num_q - 1,
+		 div_u64(stats.drain_ns, NSEC_PER_USEC),
+		 div_u64(stats.clear_ns, NSEC_PER_USEC),
+		 div_u64(stats.free_ns, NSEC_PER_USEC));
+
+	return 0;
+}
+
 static int xnl_q_stop(struct sk_buff *skb2, struct genl_info *info)
 {
 	struct xlnx_pci_dev *xpdev;
 	struct qdma_queue_conf qconf;
 	char buf[XNL_RESP_BUFLEN_MIN];
-	struct xlnx_qdata *qdata;
 	int rv = 0;
 	unsigned char is_qp;
 	unsigned short num_q;
-	unsigned int i;
-	unsigned short qidx;
-	unsigned char is_c2h;
 	buf[0] = '\0';
 
 	if (info == NULL)
@@ -1323,33 +1405,37 @@ static int xnl_q_stop(struct sk_buff *skb2, struct genl_info *info)
 	}
 	num_q = nla_get_u32(info->attrs[XNL_ATTR_NUM_Q]);
 
-	qidx = qconf.qidx;
-	is_c2h = qconf.c2h;
+	xnl_q_range_stop(xpdev, qconf.qidx, num_q, is_qp, qconf.c2h,
+			 buf, XNL_RESP_BUFLEN_MIN);
+send_resp:
+	rv = xnl_respond_buffer(info, buf, XNL_RESP_BUFLEN_MIN);
+	return rv;
+}
+
+static int xnl_q_range_del(struct xlnx_pci_dev *xpdev, unsigned short qidx,
+			unsigned int num_q, unsigned char is_qp,
+			unsigned char is_c2h, char *buf, int buflen)
+{
+	unsigned char c2h;
+	unsigned int i;
+	int rv;
+
 	for (i = qidx; i < (qidx + num_q); i++) {
-		qconf.c2h = is_c2h;
-stop_q:
-		qconf.qidx = i;
-		// I don't think anything is written here
-		qdata = xnl_rcv_check_qidx(info, xpdev, &qconf, buf,
-					XNL_RESP_BUFLEN_MIN);
-		if (!qdata)
-			goto send_resp;
-		rv = qdma_queue_stop(xpdev->dev_hndl, qdata->qhndl,
-				     buf, XNL_RESP_BUFLEN_MIN);
+		c2h = is_c2h;
+del_q:
+		rv = xpdev_queue_delete(xpdev, i, c2h, buf, buflen);
 		if (rv < 0) {
-			pr_err("qdma_queue_stop() failed: %d", rv);
-			goto send_resp;
+			pr_err("xpdev_queue_delete() failed: %d", rv);
+			return rv;
 		}
-		if (is_qp && (is_c2h == qconf.c2h)) {
-			qconf.c2h = ~qconf.c2h;
-			goto stop_q;
+		if (is_qp && (is_c2h == c2h)) {
+			c2h = !c2h;
+			goto del_q;
 		}
 	}
-	snprintf(buf + rv, XNL_RESP_BUFLEN_MIN - rv,
-		 "Stopped Queues %d -> %d.\n", qidx, i - 1);
-send_resp:
-	rv = xnl_respond_buffer(info, buf, XNL_RESP_BUFLEN_MIN);
-	return rv;
+	snprintf(buf, buflen, "Deleted Queues %d -> %d.\n", qidx, i - 1);
+
+	return 0;
 }
 
 static int xnl_q_del(struct sk_buff *skb2, struct genl_info *info)
@@ -1360,9 +1446,6 @@ static int xnl_q_del(struct sk_buff *skb2, struct genl_info *info)
 	int rv = 0;
 	unsigned char is_qp;
 	unsigned short num_q;
-	unsigned int i;
-	unsigned short qidx;
-	unsigned char is_c2h;
 
 	if (info == NULL)
 		return 0;
@@ -1387,27 +1470,168 @@ static int xnl_q_del(struct sk_buff *skb2, struct genl_info *info)
 	}
 	num_q = nla_get_u32(info->attrs[XNL_ATTR_NUM_Q]);
 
-	qidx = qconf.qidx;
-	is_c2h = qconf.c2h;
-	for (i = qidx; i < (qidx + num_q); i++) {
-		qconf.c2h = is_c2h;
-del_q:
-		qconf.qidx = i;
-		rv = xpdev_queue_delete(xpdev, qconf.qidx, qconf.c2h,
-					buf, XNL_RESP_BUFLEN_MIN);
-		if (rv < 0) {
-			pr_err("xpdev_queue_delete() failed: %d", rv);
-			goto send_resp;
-		}
-		if (is_qp && (is_c2h == qconf.c2h)) {
-			qconf.c2h = ~qconf.c2h;
-			goto del_q;
+	xnl_q_range_del(xpdev, qconf.qidx, num_q, is_qp, qconf.c2h,
+			buf, XNL_RESP_BUFLEN_MIN);
+send_resp:
+	rv = xnl_respond_buffer(info, buf, XNL_RESP_BUFLEN_MIN);
+	return rv;
+}
+
+static void xnl_q_batch_start_config(struct xnl_q_batch_op *op,
+					struct qdma_queue_conf *qconf)
+{
+	xnl_extract_extra_config_qflag(op->qflag, qconf);
+
+	if (op->sflags & XNL_Q_BATCH_S_RNGSZ_IDX)
+		qconf->desc_rng_sz_idx = qconf->cmpl_rng_sz_idx =
+				op->qrngsz_idx;
+	if (op->sflags & XNL_Q_BATCH_S_C2H_BUFSZ_IDX)
+		qconf->c2h_buf_sz_idx = op->c2h_bufsz_idx;
+	if (op->sflags & XNL_Q_BATCH_S_CMPT_TMR_IDX)
+		qconf->cmpl_timer_idx = op->cmpt_tmr_idx;
+	if (op->sflags & XNL_Q_BATCH_S_CMPT_CNTR_IDX)
+		qconf->cmpl_cnt_th_idx = op->cmpt_cntr_idx;
+	if (op->sflags & XNL_Q_BATCH_S_CMPT_DESC_SIZE)
+		qconf->cmpl_desc_sz = op->cmpt_desc_sz;
+	if (op->sflags & XNL_Q_BATCH_S_SW_DESC_SIZE)
+		qconf->sw_desc_sz = op->sw_desc_sz;
+	if (op->sflags & XNL_Q_BATCH_S_CMPT_TRIG_MODE)
+		qconf->cmpl_trig_mode = op->cmpt_trig_mode;
+	else
+		qconf->cmpl_trig_mode = 1;
+}
+
+/*
+ * One message, one reply: the operations run back to back under the single
+ * genl_lock() hold of the message, the queue starts reuse the bulk start.
+ */
+static int xnl_q_batch(struct sk_buff *skb2, struct genl_info *info)
+{
+	struct xlnx_pci_dev *xpdev;
+	struct qdma_queue_conf qconf;
+	struct xnl_q_batch_op *ops;
+	struct sk_buff *skb;
+	void *hdr;
+	char *buf, *cur, *end;
+	unsigned char is_qp;
+	unsigned int nr = 0;
+	unsigned int done = 0;
+	unsigned int i;
+	int buf_len = XNL_RESP_BUFLEN_MAX;
+	int len;
+	int rv = 0;
+
+	if (info == NULL)
+		return -EINVAL;
+
+	xnl_dump_attrs(info);
+
+	xpdev = xnl_rcv_check_xpdev(info);
+	if (!xpdev)
+		return -EINVAL;
+
+	if (info->attrs[XNL_ATTR_RSP_BUF_LEN])
+		buf_len =  nla_get_u32(info->attrs[XNL_ATTR_RSP_BUF_LEN]);
+
+	buf = xnl_mem_alloc(buf_len, info);
+	if (!buf)
+		return -ENOMEM;
+	cur = buf;
+	end = buf + buf_len;
+
+	if (unlikely(!qdma_get_qmax(xpdev->dev_hndl))) {
+		snprintf(cur, end - cur, "Zero Qs");
+		goto send_resp;
+	}
+	if (xnl_chk_attr(XNL_ATTR_Q_BATCH, info, 0, cur, end - cur) < 0)
+		goto send_resp;
+	len = nla_len(info->attrs[XNL_ATTR_Q_BATCH]);
+	nr = len / sizeof(struct xnl_q_batch_op);
+	if (!nr || nr * sizeof(struct xnl_q_batch_op) != len) {
+		snprintf(cur, end - cur, "ERR! batch length %d invalid.\n",
+			 len);
+		goto send_resp;
+	}
+	ops = nla_data(info->attrs[XNL_ATTR_Q_BATCH]);
+
+	for (i = 0; i < nr; i++) {
+		struct xnl_q_batch_op *op = ops + i;
+
+		rv = qconf_from_qflag(&qconf, op->qflag, op->qidx, cur,
+				      end - cur, &is_qp);
+		if (rv < 0)
+			break;
+
+		switch (op->op) {
+		case XNL_CMD_Q_ADD:
+			rv = xnl_q_range_add(xpdev, &qconf, is_qp, op->num_q,
+					     cur, end - cur);
+			break;
+		case XNL_CMD_Q_START:
+			xnl_q_batch_start_config(op, &qconf);
+			if (qconf.st && qconf.en_mm_cmpt) {
+				snprintf(cur, end - cur,
+					 "MM CMPL is valid only for MM Mode\n");
+				rv = -EINVAL;
+				break;
+			}
+			rv = xnl_q_range_config(xpdev, &qconf, is_qp, op->num_q,
+				!!(op->sflags & XNL_Q_BATCH_S_C2H_BUFSZ_IDX),
+				cur, end - cur);
+			if (rv < 0)
+				break;
+			rv = xpdev_queue_start_range(xpdev, is_qp, qconf.c2h,
+						qconf.qidx, op->num_q, cur,
+						end - cur);
+			break;
+		case XNL_CMD_Q_STOP:
+			rv = xnl_q_range_stop(xpdev, qconf.qidx, op->num_q,
+					      is_qp, qconf.c2h, cur, end - cur);
+			break;
+		case XNL_CMD_Q_DEL:
+			rv = xnl_q_range_del(xpdev, qconf.qidx, op->num_q,
+					     is_qp, qconf.c2h, cur, end - cur);
+			break;
+		default:
+			snprintf(cur, end - cur, "ERR! op %u not supported.\n",
+				 op->op);
+			rv = -EINVAL;
+			break;
 		}
+		cur += strlen(cur);
+		if (rv < 0)
+			break;
 	}
-	snprintf(buf + rv, XNL_RESP_BUFLEN_MIN - rv,
-		"Deleted Queues %d -> %d.\n", qidx, i - 1);
+	done = i;
+
+	if (rv < 0) {
+		pr_info("%s, batch op %u/%u failed %d.\n",
+			dev_name(&xpdev->pdev->dev), i + 1, nr, rv);
+		snprintf(cur, end - cur,
+			 "\nERR! batch op %u/%u, qidx %u, failed %d.\n",
+			 i + 1, nr, ops[i].qidx, rv);
+	} else {
+		snprintf(cur, end - cur, "Batch of %u ops done.\n", nr);
+	}
+
 send_resp:
-	rv = xnl_respond_buffer(info, buf, XNL_RESP_BUFLEN_MIN);
+	skb = xnl_msg_alloc(XNL_CMD_Q_BATCH, strlen(buf) + XNL_RESP_BUFLEN_MIN,
+			    &hdr, info);
+	if (!skb) {
+		rv = -ENOMEM;
+		goto free_buf;
+	}
+	rv = xnl_msg_add_attr_str(skb, XNL_ATTR_GENMSG, buf);
+	if (!rv)
+		rv = xnl_msg_add_attr_uint(skb, XNL_ATTR_Q_BATCH, done);
+	if (rv) {
+		nlmsg_free(skb);
+		goto free_buf;
+	}
+	rv = xnl_msg_send(skb, hdr, info);
+
+free_buf:
+	kfree(buf);
 	return rv;
 }
 
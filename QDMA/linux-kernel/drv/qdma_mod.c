@@ -76,6 +76,16 @@ module_param(num_threads, uint, 0644);
 MODULE_PARM_DESC(num_threads,
 "Number of threads to be created each for request and writeback processing");
 
+static unsigned int rebal_interval_ms = 1000;
+module_param(rebal_interval_ms, uint, 0444);
+MODULE_PARM_DESC(rebal_interval_ms,
+	"Interval of the queue rebalancing across the completion threads/cpus in ms, 0 to disable, dflt 1000");
+
+static char *thread_cpus;
+module_param(thread_cpus, charp, 0444);
+MODULE_PARM_DESC(thread_cpus,
+	"Cpu list the completion threads are bound to, ex. 0-3,8, dflt all online cpus");
+
 static unsigned int tm_mode_en;
 module_param(tm_mode_en, uint, 0644);
 MODULE_PARM_DESC(tm_mode_en,
@@ -86,6 +96,21 @@ module_param(tm_one_cdh_en, uint, 0644);
 MODULE_PARM_DESC(tm_one_cdh_en,
 		"Enable 1 CDH for Traffic Manager mode. Default is Zero CDH");
 
+static unsigned short pidx_coal_desc;
+module_param(pidx_coal_desc, ushort, 0644);
+MODULE_PARM_DESC(pidx_coal_desc,
+	"MM/ST H2C: # of descriptors pending before the pidx doorbell is written, dflt 0 (no coalescing)");
+
+static unsigned short pidx_coal_us = 10;
+module_param(pidx_coal_us, ushort, 0644);
+MODULE_PARM_DESC(pidx_coal_us,
+	"MM/ST H2C: max. time the pidx doorbell is deferred in us, dflt 10");
+
+static unsigned short cmpl_poll_us = 50;
+module_param(cmpl_poll_us, ushort, 0644);
+MODULE_PARM_DESC(cmpl_poll_us,
+	"polled completion: max. time a blocking request spins before it sleeps in us, dflt 50");
+
 #include "pci_ids.h"
 
 /*
@@ -1262,78 +1287,108 @@ int xpdev_queue_add(struct xlnx_pci_dev *xpdev, struct qdma_queue_conf *qconf,
 	return rv;
 }
 
-static void nl_work_handler_q_start(struct work_struct *work)
+unsigned long *xpdev_queue_hndls_get(struct xlnx_pci_dev *xpdev,
+			unsigned int qidx, unsigned int qcnt, u8 is_qp,
+			u8 is_c2h, unsigned int *nr, char *ebuf, int ebuflen)
 {
-	struct xlnx_nl_work *nl_work = container_of(work, struct xlnx_nl_work,
-						work);
-	struct xlnx_pci_dev *xpdev = nl_work->xpdev;
-	struct xlnx_nl_work_q_ctrl *qctrl = &nl_work->qctrl;
-	unsigned int qidx = qctrl->qidx;
-	u8 is_qp = qctrl->is_qp;
-	u8 c2h = qctrl->is_c2h;
-	int i;
-	char *ebuf = nl_work->buf;
-	int rv = 0;
+	unsigned int n = is_qp ? qcnt << 1 : qcnt;
+	unsigned long *qhndls = kmalloc_array(n, sizeof(unsigned long),
+					GFP_KERNEL);
+	unsigned int i, k = 0;
+
+	if (!qhndls) {
+		snprintf(ebuf, ebuflen, "qdma%05x OOM.\n", xpdev->idx);
+		return NULL;
+	}
 
-	for (i = 0; i < qctrl->qcnt; i++, qidx++) {
+	for (i = 0; i < qcnt; i++, qidx++) {
+		u8 c2h = is_c2h;
 		struct xlnx_qdata *qdata;
 
-q_start:
-		qdata = xpdev_queue_get(xpdev, qidx, c2h, 1, ebuf,
-					nl_work->buflen);
+q_get:
+		qdata = xpdev_queue_get(xpdev, qidx, c2h, 1, ebuf, ebuflen);
 		if (!qdata) {
 			pr_info("%s, idx %u, c2h %u, get failed.\n",
 				dev_name(&xpdev->pdev->dev), qidx, c2h);
-			snprintf(ebuf, nl_work->buflen,
+			snprintf(ebuf, ebuflen,
 				"Q idx %u, c2h %u, get failed.\n", qidx, c2h);
-			goto send_resp;
+			kfree(qhndls);
+			return NULL;
 		}
+		qhndls[k++] = qdata->qhndl;
 
-		rv = qdma_queue_start(xpdev->dev_hndl, qdata->qhndl, ebuf,
-				      nl_work->buflen);
-		if (rv < 0) {
-			pr_info("%s, idx %u, c2h %u, start failed %d.\n",
-				dev_name(&xpdev->pdev->dev), qidx, c2h, rv);
-			snprintf(ebuf, nl_work->buflen,
-				"Q idx %u, c2h %u, start failed %d.\n",
-				qidx, c2h, rv);
-			goto send_resp;
+		if (is_qp && c2h == is_c2h) {
+			c2h = !is_c2h;
+			goto q_get;
 		}
+	}
+	*nr = k;
+
+	return qhndls;
+}
+
+static void nl_work_handler_q_start(struct work_struct *work)
+{
+	struct xlnx_nl_work *nl_work = container_of(work, struct xlnx_nl_work,
+						work);
+	struct xlnx_pci_dev *xpdev = nl_work->xpdev;
+	struct xlnx_nl_work_q_ctrl *qctrl = &nl_work->qctrl;
+	struct qdma_queue_bulk_stats stats;
+	unsigned long *qhndls;
+	unsigned int nr = 0;
+	char *ebuf = nl_work->buf;
+	int rv = 0;
+
+	qhndls = xpdev_queue_hndls_get(xpdev, qctrl->qidx, qctrl->qcnt,
+				qctrl->is_qp, qctrl->is_c2h, &nr, ebuf,
+				nl_work->buflen);
+	if (!qhndls) {
+		rv = -EINVAL;
+		goto send_resp;
+	}
+
+	/** all the rings first, then all the contexts */
+	rv = qdma_queue_start_bulk(xpdev->dev_hndl, nr, qhndls, &stats, ebuf,
+				nl_work->buflen);
+	if (rv < 0) {
+		pr_info("%s, idx %u ~ %u, start failed %d.\n",
+			dev_name(&xpdev->pdev->dev), qctrl->qidx,
+			qctrl->qidx + qctrl->qcnt - 1, rv);
+		goto free_qhndls;
+	}
 
 #ifndef __QDMA_VF__
-		{
-			struct xlnx_dma_dev *xdev =
-				(struct xlnx_dma_dev *)(xpdev->dev_hndl);
-
-			if (xdev->stm_en) {
-				rv = qdma_queue_prog_stm(xpdev->dev_hndl,
-							 qdata->qhndl,
-							 ebuf, nl_work->buflen);
-				if (rv < 0) {
-					pr_info("%s, idx %u, c2h %u, prog stm failed %d.\n",
-						dev_name(&xpdev->pdev->dev),
-						qidx, c2h, rv);
-					snprintf(ebuf, nl_work->buflen,
-						 "Q idx %u, c2h %u, prog stm failed %d.\n",
-						 qidx, c2h, rv);
-					goto send_resp;
-				}
+	{
+		struct xlnx_dma_dev *xdev =
+			(struct xlnx_dma_dev *)(xpdev->dev_hndl);
+		unsigned int i;
+
+		for (i = 0; xdev->stm_en && i < nr; i++) {
+			rv = qdma_queue_prog_stm(xpdev->dev_hndl, qhndls[i],
+						 ebuf, nl_work->buflen);
+			if (rv < 0) {
+				pr_info("%s, qhndl %lu, prog stm failed %d.\n",
+					dev_name(&xpdev->pdev->dev),
+					qhndls[i], rv);
+				snprintf(ebuf, nl_work->buflen,
+					 "Q hndl %lu, prog stm failed %d.\n",
+					 qhndls[i], rv);
+				goto free_qhndls;
 			}
 		}
-#endif
-
-		if (is_qp && c2h == qctrl->is_c2h) {
-			c2h = !qctrl->is_c2h;
-			goto q_start;
-		}
-
-		c2h = qctrl->is_c2h;
 	}
+#endif
 
 	snprintf(ebuf, nl_work->buflen,
-		 "%u Queues started, idx %u ~ %u.\n",
-		qctrl->qcnt, qctrl->qidx, qidx - 1);
-
+		 "%u Queues started, idx %u ~ %u, %u rings reused, config %llu us, alloc %llu us, ctxt %llu us, online %llu us.\n",
+		qctrl->qcnt, qctrl->qidx, qctrl->qidx + qctrl->qcnt - 1,
+		stats.rings_reused, div_u64(stats.config_ns, NSEC_PER_USEC),
+		div_u64(stats.alloc_ns, NSEC_PER_USEC),
+		div_u64(stats.prog_ns, NSEC_PER_USEC),
+		div_u64(stats.online_ns, NSEC_PER_USEC));
+
+free_qhndls:
+	kfree(qhndls);
 send_resp:
 	nl_work->q_start_handled = 1;
 	nl_work->ret = rv;
@@ -1357,17 +1412,18 @@ static struct xlnx_nl_work *xpdev_nl_work_alloc(struct xlnx_pci_dev *xpdev)
 	return nl_work;
 }
 
-int xpdev_nl_queue_start(struct xlnx_pci_dev *xpdev, void *nl_info, u8 is_qp,
-			u8 is_c2h, unsigned short qidx, unsigned short qcnt)
+int xpdev_queue_start_range(struct xlnx_pci_dev *xpdev, u8 is_qp, u8 is_c2h,
+			unsigned short qidx, unsigned short qcnt, char *buf,
+			int buflen)
 {
 	struct xlnx_nl_work *nl_work = xpdev_nl_work_alloc(xpdev);
 	struct xlnx_nl_work_q_ctrl *qctrl;
-	char ebuf[XNL_EBUFLEN];
 	int rv = 0;
-	ebuf[0] = '\0';
 
-	if (!nl_work)
+	if (!nl_work) {
+		snprintf(buf, buflen, "qdma%05x OOM.\n", xpdev->idx);
 		return -ENOMEM;
+	}
 
 	qctrl = &nl_work->qctrl;
 	qctrl->is_qp = is_qp;
@@ -1378,12 +1434,25 @@ int xpdev_nl_queue_start(struct xlnx_pci_dev *xpdev, void *nl_info, u8 is_qp,
 	INIT_WORK(&nl_work->work, nl_work_handler_q_start);
 	init_waitqueue_head(&nl_work->wq);
 	nl_work->q_start_handled = 0;
-	nl_work->buf = ebuf;
-	nl_work->buflen = XNL_EBUFLEN;
+	nl_work->buf = buf;
+	nl_work->buflen = buflen;
 	queue_work(xpdev->nl_task_wq, &nl_work->work);
 	wait_event_interruptible(nl_work->wq, nl_work->q_start_handled);
 	rv = nl_work->ret;
 	kfree(nl_work);
+
+	return rv;
+}
+
+int xpdev_nl_queue_start(struct xlnx_pci_dev *xpdev, void *nl_info, u8 is_qp,
+			u8 is_c2h, unsigned short qidx, unsigned short qcnt)
+{
+	char ebuf[XNL_EBUFLEN];
+	int rv;
+	ebuf[0] = '\0';
+
+	rv = xpdev_queue_start_range(xpdev, is_qp, is_c2h, qidx, qcnt, ebuf,
+				     XNL_EBUFLEN);
 	xnl_respond_buffer(nl_info, ebuf, strlen(ebuf));
 
 	return rv;
@@ -1643,6 +1712,9 @@ static int probe_one(struct pci_dev *pdev, const struct pci_device_id *id)
 	conf.intr_rngsz = QDMA_INTR_COAL_RING_SIZE;
 	conf.tm_mode_en = tm_mode_en;
 	conf.tm_one_cdh_en = tm_one_cdh_en;
+	conf.pidx_coal_desc = pidx_coal_desc;
+	conf.pidx_coal_us = pidx_coal_us;
+	conf.cmpl_poll_us = cmpl_poll_us;
 	conf.pdev = pdev;
 
 	/* initialize all the bar numbers with -1 */
@@ -1921,9 +1993,10 @@ static int __init qdma_mod_init(void)
 
 	pr_info("%s", version);
 
-	rv = libqdma_init(num_threads);
+	rv = libqdma_init(num_threads, thread_cpus);
 	if (rv < 0)
 		return rv;
+	libqdma_rebalance_interval(rebal_interval_ms);
 
 	rv = xlnx_nl_init();
 	if (rv < 0)
@@ -141,6 +141,27 @@ struct xlnx_qdata *xpdev_queue_get(struct xlnx_pci_dev *xpdev,
 			unsigned int qidx, bool c2h, bool check_qhndl,
 			char *ebuf, int ebuflen);
 
+/*****************************************************************************/
+/**
+ * xpdev_queue_hndls_get() - qdma pcie kernel module api to get the handles
+ *	of a range of queues, in the netlink command order
+ *
+ * @param[in]	xpdev:		pointer to xlnx_pci_dev
+ * @param[in]	qidx:		first queue index
+ * @param[in]	qcnt:		# of queue indexes
+ * @param[in]	is_qp:		both directions of each index
+ * @param[in]	is_c2h:		direction, the first one with is_qp
+ * @param[out]	nr:		# of handles
+ * @param[out]	ebuf:		error message buffer
+ * @param[in]	ebuflen:	error message buffer length
+ *
+ * @return	handle array to kfree()
+ * @return	NULL: failure
+ *****************************************************************************/
+unsigned long *xpdev_queue_hndls_get(struct xlnx_pci_dev *xpdev,
+			unsigned int qidx, unsigned int qcnt, u8 is_qp,
+			u8 is_c2h, unsigned int *nr, char *ebuf, int ebuflen);
+
 /*****************************************************************************/
 /**
  * xpdev_queue_add() - qdma pcie kernel module api to add a queue
@@ -174,6 +195,26 @@ int xpdev_queue_add(struct xlnx_pci_dev *xpdev, struct qdma_queue_conf *qconf,
 int xpdev_queue_delete(struct xlnx_pci_dev *xpdev, unsigned int qidx, bool c2h,
 			char *ebuf, int ebuflen);
 
+/*****************************************************************************/
+/**
+ * xpdev_queue_start_range() - qdma pcie kernel module api to start a range
+ *	of configured queues from the netlink work queue
+ *
+ * @param[in]	xpdev:		pointer to xlnx_pci_dev
+ * @param[in]	is_qp:		both directions of each index
+ * @param[in]	is_c2h:		direction, the first one with is_qp
+ * @param[in]	qidx:		first queue index
+ * @param[in]	qcnt:		# of queue indexes
+ * @param[out]	buf:		result/error message buffer
+ * @param[in]	buflen:		buffer length
+ *
+ * @return	0: success
+ * @return	<0: failure
+ *****************************************************************************/
+int xpdev_queue_start_range(struct xlnx_pci_dev *xpdev, u8 is_qp, u8 is_c2h,
+			unsigned short qidx, unsigned short qcnt, char *buf,
+			int buflen);
+
 int xpdev_nl_queue_start(struct xlnx_pci_dev *xpdev, void *nl_info, u8 is_qp,
 			u8 is_c2h, unsigned short qidx, unsigned short qcnt);
 
@@ -0,0 +1,85 @@
+/*
+ * This file is part of the Xilinx DMA IP Core driver for Linux
+ *
+ * Copyright (c) 2017-present,  Xilinx, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#ifndef __QDMA_C2H_RING_H__
+#define __QDMA_C2H_RING_H__
+/**
+ * @file
+ * @brief This file contains the layout of the ST C2H free list ring shared
+ *	with the user space through mmap() on the queue character device
+ *
+ * mmap() of the ST C2H queue cdev maps, from offset 0:
+ *	- struct qdma_c2h_ring_ctrl
+ *	- ctrl.size struct qdma_c2h_ring_entry, one per free list buffer
+ *	- ctrl.size free list buffers, buffer i at
+ *	  ctrl.buf_offset + i * ctrl.buf_stride
+ *
+ * The driver fills the entries [cons, prod) as the packets are received;
+ * a packet spanning several buffers has SOP set on its first entry and EOP
+ * on its last one. The consumer reads the data in place, then returns the
+ * buffers by advancing cons, the buffers are recycled to the hardware on
+ * the next QDMA_C2H_RING_IOCTL_WAIT or completion processing.
+ * Both indexes wrap at ctrl.size.
+ *
+ * The mapping is valid until the queue is stopped.
+ */
+#include <linux/types.h>
+
+/** ioctl on the queue cdev: return the consumed buffers and wait up to
+ *  *(unsigned int *)arg ms for a received packet, returns the number of
+ *  entries available to the consumer.
+ */
+#define QDMA_C2H_RING_IOCTL_WAIT	1
+
+/** entry flag: first buffer of a packet */
+#define QDMA_C2H_RING_F_SOP		0x1
+/** entry flag: last buffer of a packet */
+#define QDMA_C2H_RING_F_EOP		0x2
+
+/**
+ * struct qdma_c2h_ring_ctrl - ring header, prod and cons are kept on
+ *			separate cache lines
+ */
+struct qdma_c2h_ring_ctrl {
+	/** @size: # of buffers and entries, RO */
+	__u32 size;
+	/** @buf_len: c2h buffer size, max. data length of a buffer, RO */
+	__u32 buf_len;
+	/** @buf_stride: mmap distance between two buffers, RO */
+	__u32 buf_stride;
+	/** @buf_offset: mmap offset of the first buffer, RO */
+	__u32 buf_offset;
+	/** @prod: next entry the driver fills, written by the driver */
+	__u32 prod;
+	/** @rsvd0: reserved */
+	__u32 rsvd0[11];
+	/** @cons: next entry to be consumed, written by the user */
+	__u32 cons;
+	/** @rsvd1: reserved */
+	__u32 rsvd1[15];
+};
+
+/**
+ * struct qdma_c2h_ring_entry - one received buffer
+ */
+struct qdma_c2h_ring_entry {
+	/** @offset: offset of the data in the buffer */
+	__u32 offset;
+	/** @len: # of data bytes in the buffer */
+	__u32 len;
+	/** @flags: QDMA_C2H_RING_F_XXX */
+	__u32 flags;
+	/** @rsvd: reserved */
+	__u32 rsvd;
+};
+
+#endif /* ifndef __QDMA_C2H_RING_H__ */
@@ -0,0 +1,81 @@
+/*
+ * This file is part of the Xilinx DMA IP Core driver for Linux
+ *
+ * Copyright (c) 2017-present,  Xilinx, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#ifndef __QDMA_CDEV_BUF_H__
+#define __QDMA_CDEV_BUF_H__
+/**
+ * @file
+ * @brief This file contains the ioctl interface of the registered buffers
+ *	of the queue character devices
+ *
+ * A user buffer registered with QDMA_CDEV_IOCTL_BUF_REG is pinned and dma
+ * mapped once. QDMA_CDEV_IOCTL_BUF_RW then transfers any range of it without
+ * the per request page pinning and mapping of read()/write().
+ *
+ * The registered buffers belong to the file they were registered on and are
+ * released when it is closed.
+ */
+#include <linux/types.h>
+
+/** ioctl on the queue cdev: register a buffer, arg is a
+ *  struct qdma_cdev_buf_reg *, returns 0 or <0 on error.
+ *  The pinned pages count against RLIMIT_MEMLOCK.
+ */
+#define QDMA_CDEV_IOCTL_BUF_REG		2
+/** ioctl on the queue cdev: unregister the buffer of index arg, returns
+ *  -EBUSY while it is in use by a transfer
+ */
+#define QDMA_CDEV_IOCTL_BUF_UNREG	3
+/** ioctl on the queue cdev: transfer a registered buffer range, arg is a
+ *  struct qdma_cdev_buf_io *, returns the # of bytes transferred or <0 on
+ *  error.
+ */
+#define QDMA_CDEV_IOCTL_BUF_RW		4
+
+/** max. # of registered buffers per queue cdev */
+#define QDMA_CDEV_BUF_MAX		64
+/** max. length of a registered buffer */
+#define QDMA_CDEV_BUF_LEN_MAX		(1ULL << 30)
+
+/**
+ * struct qdma_cdev_buf_reg - buffer registration
+ */
+struct qdma_cdev_buf_reg {
+	/** @addr: user address of the buffer */
+	__u64 addr;
+	/** @len: buffer length */
+	__u64 len;
+	/** @index: registered buffer index, set by the driver */
+	__u32 index;
+	/** @rsvd: reserved */
+	__u32 rsvd;
+};
+
+/**
+ * struct qdma_cdev_buf_io - transfer of a registered buffer range
+ */
+struct qdma_cdev_buf_io {
+	/** @index: registered buffer index */
+	__u32 index;
+	/** @write: 1 for H2C, 0 for C2H */
+	__u32 write;
+	/** @offset: start of the range in the buffer */
+	__u64 offset;
+	/** @len: length of the range */
+	__u64 len;
+	/** @ep_addr: end point address, MM only, same as the file position
+	 *  of read()/write()
+	 */
+	__u64 ep_addr;
+};
+
+#endif /* ifndef __QDMA_CDEV_BUF_H__ */
@@ -0,0 +1,46 @@
+/*
+ * This file is part of the Xilinx DMA IP Core driver for Linux
+ *
+ * Copyright (c) 2017-present,  Xilinx, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#ifndef __QDMA_CDEV_STRIPE_H__
+#define __QDMA_CDEV_STRIPE_H__
+/**
+ * @file
+ * @brief This file contains the ioctl interface of the striped transfers
+ *	of the MM queue character devices
+ *
+ * Once QDMA_CDEV_IOCTL_STRIPE_SET lists extra queues on a MM queue cdev,
+ * every read()/write() on it is split across the queue of the cdev and the
+ * listed queues, see qdma_request_submit_striped().
+ */
+#include <linux/types.h>
+
+/** ioctl on the queue cdev: set the striping queues, arg is a
+ *  struct qdma_cdev_stripe *, qcnt 0 turns the striping off.
+ */
+#define QDMA_CDEV_IOCTL_STRIPE_SET	5
+
+/** max. # of extra striping queues */
+#define QDMA_CDEV_STRIPE_MAX		15
+
+/**
+ * struct qdma_cdev_stripe - striping queues
+ */
+struct qdma_cdev_stripe {
+	/** @qcnt: # of entries in qidx */
+	__u32 qcnt;
+	/** @rsvd: reserved */
+	__u32 rsvd;
+	/** @qidx: MM queue indexes, with the same direction(s) as the cdev */
+	__u32 qidx[QDMA_CDEV_STRIPE_MAX];
+};
+
+#endif /* ifndef __QDMA_CDEV_STRIPE_H__ */
@@ -24,6 +24,8 @@
  * @brief This file contains the declarations for qdma netlink interfaces
  *
  */
+#include <linux/types.h>
+
 /** physical function name (no more than 15 characters) */
 #define XNL_NAME_PF		"xnl_pf"
 /** virtual function name */
@@ -76,9 +78,15 @@
 #define XNL_F_CMPT_OVF_CHK_DIS	0x00004000
 /** Q parameter: MM completion required? */
 #define XNL_F_EN_MM_CMPL         0x00008000
+/** Q parameter: ST C2H receive directly into the read request pages */
+#define XNL_F_C2H_ZEROCOPY       0x00010000
+/** Q parameter: ST C2H adaptive completion moderation */
+#define XNL_F_C2H_ADAPTIVE_CMPL  0x00020000
+/** Q parameter: blocking requests poll for their completion */
+#define XNL_F_CMPL_POLL          0x00040000
 
 /** maximum number of queue flags to control queue configuration*/
-#define MAX_QFLAGS 17
+#define MAX_QFLAGS 19
 
 /** maximum number of interrupt ring entries*/
 #define QDMA_MAX_INT_RING_ENTRIES 512
@@ -155,6 +163,9 @@ enum xnl_attr_t {
 	XNL_ATTR_PIPE_TDEST,            /**< pipe tdest */
 	XNL_ATTR_DEV_STM_BAR,	/**< device STM bar number */
 	XNL_ATTR_Q_STATE,
+	XNL_ATTR_Q_BATCH,	/**< array of struct xnl_q_batch_op,
+				 *   # of operations done in the reply
+				 */
 #ifdef ERR_DEBUG
 	XNL_ATTR_QPARAM_ERR_INFO,		/**< queue param info */
 #endif
@@ -241,6 +252,7 @@ static const char *xnl_attr_str[XNL_ATTR_MAX + 1] = {
 	"PIPE_TDEST",           /**< pipe tdest */
 	"DEV_STM_BAR",	        /**< device STM bar number */
 	"Q_STATE",				/**< XNL_ATTR_Q_STATE*/
+	"Q_BATCH",				/**< XNL_ATTR_Q_BATCH*/
 #ifdef ERR_DEBUG
 	"QPARAM_ERR_INFO",      /**< queue param info */
 #endif
@@ -282,6 +294,7 @@ enum xnl_op_t {
 	XNL_CMD_GLOBAL_CSR,	/**< get all global csr register values */
 	XNL_CMD_DEV_CAP,	/**< list h/w capabilities , hw and sw version */
 	XNL_CMD_GET_Q_STATE,	/**< get the queue state */
+	XNL_CMD_Q_BATCH,	/**< add/start/stop/delete queues in one message */
 	XNL_CMD_MAX,		/**< max number of XNL commands*/
 };
 
@@ -308,10 +321,72 @@ static const char *xnl_op_str[XNL_CMD_MAX] = {
 	"Q_CMPT",	/** XNL_CMD_Q_CMPT */
 	"Q_RX_PKT",	/** XNL_CMD_Q_RX_PKT */
 	"Q_CMPT_READ",	/** XNL_CMD_Q_CMPT_READ */
-	"INTR_RING_DUMP", /** XNL_CMD_INTR_RING_DUMP */
 #ifdef ERR_DEBUG
-	"Q_ERR_INDUCE"  /** XNL_CMD_Q_ERR_INDUCE */
+	"Q_ERR_INDUCE",	/** XNL_CMD_Q_ERR_INDUCE */
 #endif
+	"INTR_RING_DUMP", /** XNL_CMD_INTR_RING_DUMP */
+	"Q_UDD",	/** XNL_CMD_Q_UDD */
+	"GLOBAL_CSR",	/** XNL_CMD_GLOBAL_CSR */
+	"DEV_CAP",	/** XNL_CMD_DEV_CAP */
+	"GET_Q_STATE",	/** XNL_CMD_GET_Q_STATE */
+	"Q_BATCH",	/** XNL_CMD_Q_BATCH */
+};
+
+/** max. # of operations in a XNL_CMD_Q_BATCH message */
+#define XNL_Q_BATCH_OPS_MAX	512
+
+/** batch q start parameter set: qrngsz_idx */
+#define XNL_Q_BATCH_S_RNGSZ_IDX		0x01
+/** batch q start parameter set: c2h_bufsz_idx */
+#define XNL_Q_BATCH_S_C2H_BUFSZ_IDX	0x02
+/** batch q start parameter set: cmpt_tmr_idx */
+#define XNL_Q_BATCH_S_CMPT_TMR_IDX	0x04
+/** batch q start parameter set: cmpt_cntr_idx */
+#define XNL_Q_BATCH_S_CMPT_CNTR_IDX	0x08
+/** batch q start parameter set: cmpt_trig_mode */
+#define XNL_Q_BATCH_S_CMPT_TRIG_MODE	0x10
+/** batch q start parameter set: cmpt_desc_sz */
+#define XNL_Q_BATCH_S_CMPT_DESC_SIZE	0x20
+/** batch q start parameter set: sw_desc_sz */
+#define XNL_Q_BATCH_S_SW_DESC_SIZE	0x40
+
+/**
+ * struct xnl_q_batch_op - one queue operation of a XNL_CMD_Q_BATCH message
+ *
+ * The operations are carried in the XNL_ATTR_Q_BATCH attribute and run in
+ * order until the first failure. The q start parameters not set in sflags
+ * take the defaults of XNL_CMD_Q_START without the matching attribute, the
+ * pipe parameters are not supported.
+ */
+struct xnl_q_batch_op {
+	/** @op: XNL_CMD_Q_ADD, XNL_CMD_Q_START, XNL_CMD_Q_STOP or
+	 *  XNL_CMD_Q_DEL
+	 */
+	__u32 op;
+	/** @qflag: XNL_F_XXX, as XNL_ATTR_QFLAG */
+	__u32 qflag;
+	/** @qidx: first queue index, as XNL_ATTR_QIDX */
+	__u32 qidx;
+	/** @num_q: # of queues, as XNL_ATTR_NUM_Q */
+	__u32 num_q;
+	/** @sflags: XNL_Q_BATCH_S_XXX, q start parameters set */
+	__u32 sflags;
+	/** @qrngsz_idx: as XNL_ATTR_QRNGSZ_IDX */
+	__u8 qrngsz_idx;
+	/** @c2h_bufsz_idx: as XNL_ATTR_C2H_BUFSZ_IDX */
+	__u8 c2h_bufsz_idx;
+	/** @cmpt_tmr_idx: as XNL_ATTR_CMPT_TIMER_IDX */
+	__u8 cmpt_tmr_idx;
+	/** @cmpt_cntr_idx: as XNL_ATTR_CMPT_CNTR_IDX */
+	__u8 cmpt_cntr_idx;
+	/** @cmpt_trig_mode: as XNL_ATTR_CMPT_TRIG_MODE */
+	__u8 cmpt_trig_mode;
+	/** @cmpt_desc_sz: as XNL_ATTR_CMPT_DESC_SIZE */
+	__u8 cmpt_desc_sz;
+	/** @sw_desc_sz: as XNL_ATTR_SW_DESC_SIZE */
+	__u8 sw_desc_sz;
+	/** @rsvd: reserved */
+	__u8 rsvd;
 };
 
 enum qdma_queue_state {
@@ -26,6 +26,9 @@
 
 #include "libqdma_export.h"
 
+#include <linux/completion.h>
+#include <linux/ktime.h>
+
 #include "qdma_descq.h"
 #include "qdma_device.h"
 #include "qdma_thread.h"
@@ -351,6 +354,41 @@ int qdma_parse_ctxt_to_buf(enum qdma_q_cntxt cntxt, char *buf, int buflen)
 	return len;
 }
 
+/*****************************************************************************/
+/**
+ * qdma_request_poll_cmpl() - static function to spin on the completion
+ *	status in the submitter's context, for up to cmpl_poll_us
+ *
+ * The completions found are processed as the interrupt work or the
+ * completion thread would, the spin ends early if the cpu is wanted.
+ *
+ * @param[in]	xdev:	pointer to xlnx_dma_dev structure
+ * @param[in]	descq:	pointer to qdma_descq structure
+ * @param[in]	cb:	request cb
+ *
+ * @return	true if the request completed while polling
+ *****************************************************************************/
+static bool qdma_request_poll_cmpl(struct xlnx_dma_dev *xdev,
+			struct qdma_descq *descq, struct qdma_sgt_req_cb *cb)
+{
+	ktime_t end = ktime_add_us(ktime_get(), xdev->conf.cmpl_poll_us);
+
+	do {
+		if (qdma_descq_cmpl_pending(descq))
+			qdma_descq_service_cmpl_update(descq, 0, 1);
+		if (READ_ONCE(cb->done)) {
+			descq->cmpl_poll_hit++;
+			return true;
+		}
+		if (need_resched())
+			break;
+		cpu_relax();
+	} while (ktime_compare(ktime_get(), end) < 0);
+
+	descq->cmpl_poll_miss++;
+	return false;
+}
+
 /*****************************************************************************/
 /**
  * qdma_request_wait_for_cmpl() - static function to monitor the
@@ -367,24 +405,43 @@ static int qdma_request_wait_for_cmpl(struct xlnx_dma_dev *xdev,
 			struct qdma_descq *descq, struct qdma_request *req)
 {
 	struct qdma_sgt_req_cb *cb = qdma_req_cb_get(req);
+	bool done = false;
+
+	/** polled completion: spin first, sleep only if the request
+	 *  did not complete within the poll budget
+	 */
+	if ((req->poll || descq->conf.cmpl_poll) &&
+			!descq->conf.adaptive_cmpl && xdev->conf.cmpl_poll_us)
+		done = qdma_request_poll_cmpl(xdev, descq, cb);
 
 	/** if timeout is mentioned in the request,
 	 *  wait until the timeout occurs or wait until the
 	 *  call back is completed
 	 */
-
-	if (req->timeout_ms)
+	if (!done && req->timeout_ms)
 		qdma_waitq_wait_event_timeout(cb->wq, cb->done,
 			msecs_to_jiffies(req->timeout_ms));
-	else
+	else if (!done)
 		qdma_waitq_wait_event(cb->wq, cb->done);
 
 	lock_descq(descq);
+	/** zero-copy st c2h: the request pages already posted to the
+	 *  hardware cannot be taken back, wait for the data to arrive
+	 *  or for the queue to be stopped
+	 */
+	if (!cb->done && cb->desc_nr && descq->conf.c2h_zerocopy) {
+		unlock_descq(descq);
+		qdma_waitq_wait_event_uninterruptible(cb->wq, cb->done);
+		lock_descq(descq);
+	}
+
 	/** if the call back is not done, request timed out
-	 *  delete the request list
+	 *  delete the request list, it might still be on the submit list
 	 */
-	if (!cb->done)
+	if (!cb->done) {
+		qdma_descq_submit_drain(descq);
 		list_del(&cb->list);
+	}
 
 	/** if the call back is not done but the status is updated
 	 *  return i/o error
@@ -410,6 +467,55 @@ static int qdma_request_wait_for_cmpl(struct xlnx_dma_dev *xdev,
 	return 0;
 }
 
+/*****************************************************************************/
+/**
+ * qdma_request_st_c2h_zc_map() - static function to validate and map the
+ *				pages of a zero-copy st c2h request
+ *
+ * @param[in]	xdev:	pointer to xlnx_dma_dev structure
+ * @param[in]	descq:	pointer to qdma_descq structure
+ * @param[in]	req:	qdma request
+ *
+ * @return	0: success
+ * @return	<0: error
+ *****************************************************************************/
+static int qdma_request_st_c2h_zc_map(struct xlnx_dma_dev *xdev,
+			struct qdma_descq *descq, struct qdma_request *req)
+{
+	struct qdma_sgt_req_cb *cb = qdma_req_cb_get(req);
+	unsigned int mask = descq->conf.c2h_bufsz - 1;
+	struct qdma_sw_sg *sg = req->sgl;
+	unsigned int left = req->count;
+	int rv;
+
+	/** every descriptor takes a full c2h_bufsz chunk of one page */
+	for ( ; sg && left; sg = sg->next) {
+		unsigned int len = min_t(unsigned int, sg->len, left);
+
+		if ((len & mask) || (sg->offset & mask))
+			break;
+		left -= len;
+	}
+	if (left || (req->count & mask)) {
+		pr_info("%s: zero-copy, len %u/sg not aligned to bufsz %u.\n",
+			descq->conf.name, req->count, descq->conf.c2h_bufsz);
+		return -EINVAL;
+	}
+
+	if (!req->dma_mapped) {
+		rv = sgl_map(xdev->conf.pdev, req->sgl, req->sgcnt,
+				DMA_FROM_DEVICE);
+		if (rv < 0) {
+			pr_info("%s map sgl %u failed, %u.\n",
+				descq->conf.name, req->sgcnt, req->count);
+			return rv;
+		}
+		cb->unmap_needed = 1;
+	}
+
+	return 0;
+}
+
 /*****************************************************************************/
 /**
  * qdma_request_submit_st_c2h() - static function to handle the
@@ -444,10 +550,24 @@ static ssize_t qdma_request_submit_st_c2h(struct xlnx_dma_dev *xdev,
 	/** get the request count */
 	cb->left = req->count;
 
+	if (descq->conf.c2h_zerocopy) {
+		rv = qdma_request_st_c2h_zc_map(xdev, descq, req);
+		if (rv < 0)
+			return rv;
+	}
+
 	lock_descq(descq);
 	if (descq->q_stop_wait) {
 		unlock_descq(descq);
-		return 0;
+		goto unmap_sgl;
+	}
+	/** the buffers are handed to the user space through mmap */
+	if (descq_st_c2h_ring_mapped(descq)) {
+		unlock_descq(descq);
+		pr_info("%s: ring mmap'ed, read NOT supported.\n",
+			descq->conf.name);
+		rv = -EBUSY;
+		goto unmap_sgl;
 	}
 	if ((descq->q_state == Q_STATE_ONLINE) &&
 			!descq->q_stop_wait) {
@@ -455,12 +575,19 @@ static ssize_t qdma_request_submit_st_c2h(struct xlnx_dma_dev *xdev,
 		 *  cause an interrupt and may miss processing of writeback
 		 */
 		list_add_tail(&cb->list, &descq->pend_list);
-		/* any rcv'ed packet not yet read ? */
-		/** read the data from the device */
-		descq_st_c2h_read(descq, req, 1, 1);
-		if (!cb->left) {
+		if (descq->conf.c2h_zerocopy) {
+			/** hand the request pages to the device */
+			rv = descq_st_c2h_zc_post(descq);
+		} else {
+			/* any rcv'ed packet not yet read ? */
+			/** read the data from the device */
+			descq_st_c2h_read(descq, req, 1, 1);
+		}
+		if (!cb->left || rv < 0) {
 			list_del(&cb->list);
 			unlock_descq(descq);
+			if (rv < 0)
+				goto unmap_sgl;
 			return req->count;
 		}
 		descq->pend_list_empty = 0;
@@ -469,7 +596,8 @@ static ssize_t qdma_request_submit_st_c2h(struct xlnx_dma_dev *xdev,
 		unlock_descq(descq);
 		pr_info("%s descq %s NOT online.\n",
 			xdev->conf.name, descq->conf.name);
-		return -EINVAL;
+		rv = -EINVAL;
+		goto unmap_sgl;
 	}
 
 	/** if there is a completion thread associated,
@@ -495,9 +623,20 @@ static ssize_t qdma_request_submit_st_c2h(struct xlnx_dma_dev *xdev,
 	}
 
 	/** Once the request completion received,
-	 *  return with the number of processed requests
+	 *  return with the number of processed requests,
+	 *  zero-copy counts the packet bytes in the posted buffers
 	 */
+	if (descq->conf.c2h_zerocopy)
+		return cb->offset;
 	return req->count - cb->left;
+
+unmap_sgl:
+	if (cb->unmap_needed) {
+		sgl_unmap(xdev->conf.pdev, req->sgl, req->sgcnt,
+			DMA_FROM_DEVICE);
+		cb->unmap_needed = 0;
+	}
+	return rv;
 }
 
 /* ********************* public function definitions ************************ */
@@ -900,6 +1039,8 @@ int qdma_queue_remove(unsigned long dev_hndl, unsigned long id, char *buf,
 	descq->q_state = Q_STATE_DISABLED;
 	unlock_descq(descq);
 
+	qdma_descq_free_ring_cache(descq);
+
 	spin_lock(&qdev->lock);
 	if (descq->conf.c2h)
 		qdev->c2h_qcnt--;
@@ -1321,31 +1462,14 @@ rewind_qcnt:
 	return rv;
 }
 
-/*****************************************************************************/
-/**
- * qdma_queue_start() - start a queue (i.e, online, ready for dma)
- *
- * @param[in]	dev_hndl:	dev_hndl returned from qdma_device_open()
- * @param[in]	id:		queue index
- * @param[in]	buflen:		length of the input buffer
- * @param[out]	buf:		message buffer
- *
- * @return	0: success
- * @return	<0: error
- *****************************************************************************/
-int qdma_queue_start(unsigned long dev_hndl, unsigned long id,
-		     char *buf, int buflen)
+/*
+ * qdma_queue_start() phases, run queue by queue or phase by phase over a
+ * range of queues by qdma_queue_start_bulk()
+ */
+static int descq_start_check(struct qdma_descq *descq, char *buf, int buflen)
 {
-	struct qdma_descq *descq = qdma_device_get_descq_by_id(
-					(struct xlnx_dma_dev *)dev_hndl,
-					 id, buf, buflen, 1);
 	int rv;
 
-	/** make sure that descq is not NULL, else return error*/
-	if (!descq)
-		return QDMA_ERR_INVALID_QIDX;
-
-
 	lock_descq(descq);
 	/** if the descq is not enabled,
 	 *  it is in invalid state, return error
@@ -1373,19 +1497,32 @@ int qdma_queue_start(unsigned long dev_hndl, unsigned long id,
 		}
 		return QDMA_ERR_DESCQ_SETUP_FAILED;
 	}
+
+	return 0;
+}
+
+static int descq_start_alloc(struct qdma_descq *descq, char *buf, int buflen)
+{
 	/** allocate the queue resources*/
-	rv = qdma_descq_alloc_resource(descq);
+	int rv = qdma_descq_alloc_resource(descq);
+
 	if (rv < 0) {
 		if (buf && buflen) {
 			snprintf(buf, buflen,
 				"%s alloc resource failed.\n",
 				descq->conf.name);
 		}
-		goto free_resource;
+		qdma_descq_free_resource(descq);
 	}
 
+	return rv;
+}
+
+static int descq_start_prog(struct qdma_descq *descq, char *buf, int buflen)
+{
 	/** program the hw contexts*/
-	rv = qdma_descq_prog_hw(descq);
+	int rv = qdma_descq_prog_hw(descq);
+
 	if (rv < 0) {
 		pr_err("%s 0x%x setup failed.\n",
 			descq->conf.name, descq->qidx_hw);
@@ -1394,9 +1531,18 @@ int qdma_queue_start(unsigned long dev_hndl, unsigned long id,
 				"%s prog. context failed.\n",
 				descq->conf.name);
 		}
-		goto clear_context;
+		qdma_descq_context_clear(descq->xdev, descq->qidx_hw,
+					descq->conf.st, descq->conf.c2h,
+					descq->mm_cmpt_ring_crtd, 1);
+		qdma_descq_free_resource(descq);
 	}
 
+	return rv;
+}
+
+static void descq_start_online(struct qdma_descq *descq, char *buf,
+				int buflen)
+{
 	/** Interrupt mode */
 	if (descq->xdev->num_vecs) {
 		unsigned long flags;
@@ -1419,16 +1565,158 @@ int qdma_queue_start(unsigned long dev_hndl, unsigned long id,
 	lock_descq(descq);
 	descq->q_state = Q_STATE_ONLINE;
 	unlock_descq(descq);
+}
+
+/*****************************************************************************/
+/**
+ * qdma_queue_start() - start a queue (i.e, online, ready for dma)
+ *
+ * @param[in]	dev_hndl:	dev_hndl returned from qdma_device_open()
+ * @param[in]	id:		queue index
+ * @param[in]	buflen:		length of the input buffer
+ * @param[out]	buf:		message buffer
+ *
+ * @return	0: success
+ * @return	<0: error
+ *****************************************************************************/
+int qdma_queue_start(unsigned long dev_hndl, unsigned long id,
+		     char *buf, int buflen)
+{
+	struct qdma_descq *descq = qdma_device_get_descq_by_id(
+					(struct xlnx_dma_dev *)dev_hndl,
+					 id, buf, buflen, 1);
+	int rv;
+
+	/** make sure that descq is not NULL, else return error*/
+	if (!descq)
+		return QDMA_ERR_INVALID_QIDX;
+
+	rv = descq_start_check(descq, buf, buflen);
+	if (rv < 0)
+		return rv;
+	rv = descq_start_alloc(descq, buf, buflen);
+	if (rv < 0)
+		return rv;
+	rv = descq_start_prog(descq, buf, buflen);
+	if (rv < 0)
+		return rv;
+	descq_start_online(descq, buf, buflen);
+
+	return QDMA_OPERATION_SUCCESSFUL;
+}
+
+static inline u64 bulk_elapsed_ns(ktime_t t0)
+{
+	return ktime_to_ns(ktime_sub(ktime_get(), t0));
+}
+
+/*****************************************************************************/
+/**
+ * qdma_queue_start_bulk() - start a range of queues
+ *
+ * @param[in]	dev_hndl:	dev_hndl returned from qdma_device_open()
+ * @param[in]	qcnt:		# of queues
+ * @param[in]	qhndls:		queue handles
+ * @param[out]	stats:		per phase timing, can be NULL
+ * @param[in]	buflen:		length of the input buffer
+ * @param[out]	buf:		message buffer
+ *
+ * @return	0: success
+ * @return	<0: error, none of the queues is started
+ *****************************************************************************/
+int qdma_queue_start_bulk(unsigned long dev_hndl, unsigned int qcnt,
+			unsigned long *qhndls,
+			struct qdma_queue_bulk_stats *stats,
+			char *buf, int buflen)
+{
+	struct xlnx_dma_dev *xdev = (struct xlnx_dma_dev *)dev_hndl;
+	struct qdma_queue_bulk_stats lstats;
+	struct qdma_descq *descq;
+	unsigned int i, n;
+	ktime_t t0;
+	int rv = 0;
+
+	if (!stats)
+		stats = &lstats;
+	memset(stats, 0, sizeof(*stats));
+
+	/** check all the queues before allocating anything */
+	t0 = ktime_get();
+	for (i = 0; i < qcnt; i++) {
+		descq = qdma_device_get_descq_by_id(xdev, qhndls[i], buf,
+						buflen, 1);
+		if (!descq)
+			return QDMA_ERR_INVALID_QIDX;
+		rv = descq_start_check(descq, buf, buflen);
+		if (rv < 0)
+			return rv;
+	}
+	stats->config_ns = bulk_elapsed_ns(t0);
+
+	t0 = ktime_get();
+	for (n = 0; n < qcnt; n++) {
+		descq = qdma_device_get_descq_by_id(xdev, qhndls[n], NULL,
+						0, 1);
+		/** listed twice */
+		if (descq->desc) {
+			if (buf && buflen)
+				snprintf(buf, buflen, "%s listed twice.\n",
+					descq->conf.name);
+			rv = QDMA_ERR_INVALID_INPUT_PARAM;
+			goto free_resource;
+		}
+		rv = descq_start_alloc(descq, buf, buflen);
+		if (rv < 0)
+			goto free_resource;
+		stats->rings_reused += descq->rings_reused;
+	}
+	stats->alloc_ns = bulk_elapsed_ns(t0);
+
+	t0 = ktime_get();
+	for (i = 0; i < qcnt; i++) {
+		descq = qdma_device_get_descq_by_id(xdev, qhndls[i], NULL,
+						0, 1);
+		rv = descq_start_prog(descq, buf, buflen);
+		if (rv < 0)
+			goto clear_context;
+	}
+	stats->prog_ns = bulk_elapsed_ns(t0);
+
+	t0 = ktime_get();
+	for (i = 0; i < qcnt; i++) {
+		descq = qdma_device_get_descq_by_id(xdev, qhndls[i], NULL,
+						0, 1);
+		descq_start_online(descq, NULL, 0);
+	}
+	stats->online_ns = bulk_elapsed_ns(t0);
+	stats->qcnt = qcnt;
+
+	if (buf && buflen)
+		snprintf(buf, buflen, "%u queues started.\n", qcnt);
 
 	return QDMA_OPERATION_SUCCESSFUL;
 
 clear_context:
-	qdma_descq_context_clear(descq->xdev, descq->qidx_hw,
+	/** queue i cleaned up after itself */
+	for (n = 0; n < qcnt; n++) {
+		if (n == i)
+			continue;
+		descq = qdma_device_get_descq_by_id(xdev, qhndls[n], NULL,
+						0, 1);
+		if (n < i)
+			qdma_descq_context_clear(xdev, descq->qidx_hw,
 					descq->conf.st, descq->conf.c2h,
 					descq->mm_cmpt_ring_crtd, 1);
-free_resource:
-	qdma_descq_free_resource(descq);
+		qdma_descq_free_resource(descq);
+	}
+	return rv;
 
+free_resource:
+	for (i = 0; i < n; i++) {
+		descq = qdma_device_get_descq_by_id(xdev, qhndls[i], NULL,
+						0, 1);
+		qdma_descq_free_resource(descq);
+	}
 	return rv;
 }
 
@@ -1550,32 +1838,12 @@ int qdma_get_queue_state(unsigned long dev_hndl, unsigned long id,
 
 
 
-/*****************************************************************************/
-/**
- * qdma_queue_stop() - stop a queue (i.e., offline, NOT ready for dma)
- *
- * @param[in]	dev_hndl:	dev_hndl returned from qdma_device_open()
- * @param[in]	id:		queue index
- * @param[in]	buflen:		length of the input buffer
- * @param[out]	buf:		message buffer
- *
- * @return	0: success
- * @return	<0: error
- *****************************************************************************/
-int qdma_queue_stop(unsigned long dev_hndl, unsigned long id, char *buf,
-			int buflen)
+/*
+ * qdma_queue_stop() phases, run queue by queue or phase by phase over a
+ * range of queues by qdma_queue_stop_bulk()
+ */
+static int descq_stop_begin(struct qdma_descq *descq, char *buf, int buflen)
 {
-	struct qdma_descq *descq = qdma_device_get_descq_by_id(
-					(struct xlnx_dma_dev *)dev_hndl,
-					id, buf, buflen, 1);
-	struct qdma_sgt_req_cb *cb, *tmp;
-	struct qdma_request *req;
-	unsigned int pend_list_empty = 0;
-
-	/** make sure that descq is not NULL, else return error */
-	if (!descq)
-		return QDMA_ERR_INVALID_QIDX;
-
 	lock_descq(descq);
 		/** if the descq not online donot proceed */
 	if (descq->q_state != Q_STATE_ONLINE) {
@@ -1589,15 +1857,25 @@ int qdma_queue_stop(unsigned long dev_hndl, unsigned long id, char *buf,
 		}
 		return QDMA_ERR_INVALID_DESCQ_STATE;
 	}
-	pend_list_empty = descq->pend_list_empty;
 
 	descq->q_stop_wait = 1;
+	/** the pending requests complete only once the hw saw them */
+	if (!(descq->conf.st && descq->conf.c2h))
+		qdma_descq_pidx_flush(descq);
 	unlock_descq(descq);
-	if (!pend_list_empty) {
-		qdma_waitq_wait_event_timeout(descq->pend_list_wq,
+	hrtimer_cancel(&descq->pidx_timer);
+
+	return 0;
+}
+
+static void descq_stop_drain(struct qdma_descq *descq)
+{
+	struct qdma_sgt_req_cb *cb, *tmp;
+	struct qdma_request *req;
+
+	qdma_waitq_wait_event_timeout(descq->pend_list_wq,
 			descq->pend_list_empty,
 			msecs_to_jiffies(QDMA_Q_PEND_LIST_COMPLETION_TIMEOUT));
-	}
 	lock_descq(descq);
 	/** free the descq by updating the state */
 	descq->q_state = Q_STATE_ENABLED;
@@ -1609,26 +1887,25 @@ int qdma_queue_stop(unsigned long dev_hndl, unsigned long id, char *buf,
 		cb->status = -ENXIO;
 		if (req->fp_done) {
 			list_del(&cb->list);
+			if (cb->unmap_needed) {
+				sgl_unmap(descq->xdev->conf.pdev, req->sgl,
+					req->sgcnt, descq->conf.c2h ?
+					DMA_FROM_DEVICE : DMA_TO_DEVICE);
+				cb->unmap_needed = 0;
+			}
 			req->fp_done(req, 0, -ENXIO);
 		} else
 			qdma_waitq_wakeup(&cb->wq);
 	}
-	list_for_each_entry_safe(cb, tmp, &descq->work_list, list) {
-		req = (struct qdma_request *)cb;
-		cb->req_state = QDMA_REQ_COMPLETE;
-		cb->done = 1;
-		cb->status = -ENXIO;
-		if (req->fp_done) {
-			list_del(&cb->list);
-			req->fp_done(req, 0, -ENXIO);
-		} else
-			qdma_waitq_wakeup(&cb->wq);
-	}
+	qdma_descq_cancel_work(descq);
 	unlock_descq(descq);
 
 	/** remove the work thread associated with the current queue */
 	qdma_thread_remove_work(descq);
+}
 
+static void descq_stop_clear(struct qdma_descq *descq)
+{
 	/** clear the queue context */
 	qdma_descq_context_clear(descq->xdev, descq->qidx_hw,
 					descq->conf.st, descq->conf.c2h,
@@ -1653,8 +1930,11 @@ int qdma_queue_stop(unsigned long dev_hndl, unsigned long id, char *buf,
 	if (descq->xdev->stm_en)
 		qdma_descq_prog_stm(descq, true);
 #endif
+}
 
-	/** free the queue resources */
+static void descq_stop_free(struct qdma_descq *descq, char *buf, int buflen)
+{
+	/** free the queue resources, the rings are kept for the next start */
 	qdma_descq_free_resource(descq);
 	/** free the descq by updating the state */
 	descq->total_cmpl_descs = 0;
@@ -1664,6 +1944,117 @@ int qdma_queue_stop(unsigned long dev_hndl, unsigned long id, char *buf,
 		snprintf(buf, buflen, "queue %s, idx %u stopped.\n",
 				descq->conf.name, descq->conf.qidx);
 	}
+}
+
+/*****************************************************************************/
+/**
+ * qdma_queue_stop() - stop a queue (i.e., offline, NOT ready for dma)
+ *
+ * @param[in]	dev_hndl:	dev_hndl returned from qdma_device_open()
+ * @param[in]	id:		queue index
+ * @param[in]	buflen:		length of the input buffer
+ * @param[out]	buf:		message buffer
+ *
+ * @return	0: success
+ * @return	<0: error
+ *****************************************************************************/
+int qdma_queue_stop(unsigned long dev_hndl, unsigned long id, char *buf,
+			int buflen)
+{
+	struct qdma_descq *descq = qdma_device_get_descq_by_id(
+					(struct xlnx_dma_dev *)dev_hndl,
+					id, buf, buflen, 1);
+	int rv;
+
+	/** make sure that descq is not NULL, else return error */
+	if (!descq)
+		return QDMA_ERR_INVALID_QIDX;
+
+	rv = descq_stop_begin(descq, buf, buflen);
+	if (rv < 0)
+		return rv;
+	descq_stop_drain(descq);
+	descq_stop_clear(descq);
+	descq_stop_free(descq, buf, buflen);
+
+	return QDMA_OPERATION_SUCCESSFUL;
+}
+
+/*****************************************************************************/
+/**
+ * qdma_queue_stop_bulk() - stop a range of queues
+ *
+ * All the queues stop accepting requests first, then their outstanding
+ * requests are waited for, so the drain timeouts do not add up.
+ *
+ * @param[in]	dev_hndl:	dev_hndl returned from qdma_device_open()
+ * @param[in]	qcnt:		# of queues
+ * @param[in]	qhndls:		queue handles
+ * @param[out]	stats:		per phase timing, can be NULL
+ * @param[in]	buflen:		length of the input buffer
+ * @param[out]	buf:		message buffer
+ *
+ * @return	0: success
+ * @return	<0: error, the queues before the failing one are stopped
+ *****************************************************************************/
+int qdma_queue_stop_bulk(unsigned long dev_hndl, unsigned int qcnt,
+			unsigned long *qhndls,
+			struct qdma_queue_bulk_stats *stats,
+			char *buf, int buflen)
+{
+	struct xlnx_dma_dev *xdev = (struct xlnx_dma_dev *)dev_hndl;
+	struct qdma_queue_bulk_stats lstats;
+	struct qdma_descq *descq;
+	unsigned int i, n;
+	ktime_t t0;
+	int rv = 0;
+
+	if (!stats)
+		stats = &lstats;
+	memset(stats, 0, sizeof(*stats));
+
+	t0 = ktime_get();
+	for (n = 0; n < qcnt; n++) {
+		descq = qdma_device_get_descq_by_id(xdev, qhndls[n], buf,
+						buflen, 1);
+		if (!descq) {
+			rv = QDMA_ERR_INVALID_QIDX;
+			break;
+		}
+		rv = descq_stop_begin(descq, buf, buflen);
+		if (rv < 0)
+			break;
+	}
+	for (i = 0; i < n; i++) {
+		descq = qdma_device_get_descq_by_id(xdev, qhndls[i], NULL,
+						0, 1);
+		descq_stop_drain(descq);
+	}
+	stats->drain_ns = bulk_elapsed_ns(t0);
+
+	t0 = ktime_get();
+	for (i = 0; i < n; i++) {
+		descq = qdma_device_get_descq_by_id(xdev, qhndls[i], NULL,
+						0, 1);
+		descq_stop_clear(descq);
+	}
+	stats->clear_ns = bulk_elapsed_ns(t0);
+
+	t0 = ktime_get();
+	for (i = 0; i < n; i++) {
+		descq = qdma_device_get_descq_by_id(xdev, qhndls[i], NULL,
+						0, 1);
+		descq_stop_free(descq, NULL, 0);
+	}
+	stats->free_ns = bulk_elapsed_ns(t0);
+	stats->qcnt = n;
+
+	if (rv < 0)
+		return rv;
+
+	if (buf && buflen)
+		snprintf(buf, buflen, "%u queues stopped.\n", qcnt);
+
 	return QDMA_OPERATION_SUCCESSFUL;
 }
 
@@ -1760,6 +2151,13 @@ int qdma_intr_ring_dump(unsigned long dev_hndl, unsigned int vector_idx,
 		return -1;
 	}
 
+	if (buf && buflen)
+		len = snprintf(buf, buflen,
+			"vector %u: %lu passes, %lu entries, %lu duplicates, %lu budget exhausted\n",
+			vector_idx, coal_entry->pass_cnt,
+			coal_entry->entry_cnt, coal_entry->dup_cnt,
+			coal_entry->budget_cnt);
+
 	/** read the ring entries based on the range given and
 	 * update the input buffer with details
 	 */
@@ -1841,6 +2239,25 @@ int qdma_vf_qconf(unsigned long dev_hndl, int qmax)
 }
 #endif
 
+/* max. # of pages in a sgl_map() run, what swiotlb can bounce at once */
+#define QDMA_SGL_MAP_RUN_MAX	((256 * 1024) >> PAGE_SHIFT)
+
+/*
+ * # of entries from sg on whose pages are physically contiguous. They are
+ * mapped as one run, so that their dma addresses stay contiguous behind an
+ * iommu too and the descriptors can cover them at once.
+ */
+static unsigned int sgl_map_run(struct qdma_sw_sg *sg, unsigned int sgcnt)
+{
+	unsigned int n = 1;
+
+	while (n < sgcnt && n < QDMA_SGL_MAP_RUN_MAX && sg[n].pg &&
+		page_to_pfn(sg[n].pg) == page_to_pfn(sg[n - 1].pg) + 1)
+		n++;
+
+	return n;
+}
+
 /*****************************************************************************/
 /**
  * sgl_unmap() - unmap the sg list from host pages
@@ -1858,16 +2275,20 @@ int qdma_vf_qconf(unsigned long dev_hndl, int qmax)
 void sgl_unmap(struct pci_dev *pdev, struct qdma_sw_sg *sg, unsigned int sgcnt,
 		 enum dma_data_direction dir)
 {
-	int i;
+	unsigned int i, j, n;
 
-	/** unmap the sg list and set the dma_addr to 0 all sg entries */
-	for (i = 0; i < sgcnt; i++, sg++) {
+	/** unmap the sg list and set the dma_addr to 0 all sg entries,
+	 *  in the same runs as sgl_map() mapped them
+	 */
+	for (i = 0; i < sgcnt; i += n, sg += n) {
 		if (!sg->pg)
 			break;
+		n = sgl_map_run(sg, sgcnt - i);
 		if (sg->dma_addr) {
 			pci_unmap_page(pdev, sg->dma_addr - sg->offset,
-							PAGE_SIZE, dir);
-			sg->dma_addr = 0UL;
+							n * PAGE_SIZE, dir);
+			for (j = 0; j < n; j++)
+				sg[j].dma_addr = 0UL;
 		}
 	}
 }
@@ -1889,22 +2310,27 @@ void sgl_unmap(struct pci_dev *pdev, struct qdma_sw_sg *sg, unsigned int sgcnt,
 int sgl_map(struct pci_dev *pdev, struct qdma_sw_sg *sgl, unsigned int sgcnt,
 		enum dma_data_direction dir)
 {
-	int i;
+	unsigned int i, j, n;
 	struct qdma_sw_sg *sg = sgl;
 
 	/** Map the sg list onto a dma pages where
-	 *  each page has max of PAGE_SIZE i.e 4K
+	 *  each page has max of PAGE_SIZE i.e 4K, the physically
+	 *  contiguous pages as one run
 	 */
-	for (i = 0; i < sgcnt; i++, sg++) {
-		/* !! TODO  page size !! */
-		sg->dma_addr = pci_map_page(pdev, sg->pg, 0, PAGE_SIZE, dir);
-		if (unlikely(pci_dma_mapping_error(pdev, sg->dma_addr))) {
-			pr_info("map sgl failed, sg %d, %u.\n", i, sg->len);
+	for (i = 0; i < sgcnt; i += n, sg += n) {
+		dma_addr_t addr;
+
+		n = sgl_map_run(sg, sgcnt - i);
+		addr = pci_map_page(pdev, sg->pg, 0, n * PAGE_SIZE, dir);
+		if (unlikely(pci_dma_mapping_error(pdev, addr))) {
+			pr_info("map sgl failed, sg %u+%u, %u.\n", i, n,
+				sg->len);
 			if (i)
 				sgl_unmap(pdev, sgl, i, dir);
 			return -EIO;
 		}
-		sg->dma_addr += sg->offset;
+		for (j = 0; j < n; j++, addr += PAGE_SIZE)
+			sg[j].dma_addr = addr + sg[j].offset;
 	}
 
 	return 0;
@@ -1981,22 +2407,20 @@ ssize_t qdma_request_submit(unsigned long dev_hndl, unsigned long id,
 		cb->unmap_needed = 1;
 	}
 
-	lock_descq(descq);
-	/**  if the descq is already in online state*/
+	/**  if the descq is already in online state, lockless check,
+	 *  re-checked under the lock when processed
+	 */
 	if (descq->q_state != Q_STATE_ONLINE) {
-		unlock_descq(descq);
 		pr_info("%s descq %s NOT online.\n",
 			xdev->conf.name, descq->conf.name);
 		rv = -EINVAL;
 		goto unmap_sgl;
 	}
-	list_add_tail(&cb->list, &descq->work_list);
-	descq->pend_req_desc += ((req->count + PAGE_SIZE - 1) >> PAGE_SHIFT);
-	unlock_descq(descq);
 
 	pr_debug("%s: cb 0x%p submitted.\n", descq->conf.name, cb);
 
-	qdma_descq_proc_sgt_request(descq);
+	if (qdma_descq_submit(descq, cb))
+		qdma_descq_proc_sgt_request(descq);
 
 	if (!wait)
 		return 0;
@@ -2027,7 +2451,7 @@ unmap_sgl:
  * @param[in]	reqv:		qdma request vector
  *
  * @return	# of bytes transferred
- * @return	<0: error
+ * @return	<0: error, none of the requests was taken (fp_done not called)
  *****************************************************************************/
 ssize_t qdma_batch_request_submit(unsigned long dev_hndl, unsigned long id,
 			  unsigned long count, struct qdma_request **reqv)
@@ -2041,6 +2465,7 @@ ssize_t qdma_batch_request_submit(unsigned long dev_hndl, unsigned long id,
 	unsigned long i;
 	struct qdma_request *req;
 	int st_c2h = 0;
+	bool kick;
 
 	if (!descq)
 		return -EINVAL;
@@ -2066,6 +2491,17 @@ ssize_t qdma_batch_request_submit(unsigned long dev_hndl, unsigned long id,
 		return -EINVAL;
 	}
 
+	/**  if the descq is already in online state, lockless check,
+	 *  re-checked under the lock when processed. Done before any request
+	 *  is mapped or completed, so an error return leaves them all to the
+	 *  caller.
+	 */
+	if (unlikely(descq->q_state != Q_STATE_ONLINE)) {
+		pr_info("%s descq %s NOT online.\n", xdev->conf.name,
+				descq->conf.name);
+		return -EINVAL;
+	}
+
 	if (st_c2h) {
 		for (i = 0; i < count; i++) {
 			req = reqv[i];
@@ -2103,26 +2539,230 @@ ssize_t qdma_batch_request_submit(unsigned long dev_hndl, unsigned long id,
 		}
 	}
 
+	for (i = 0, kick = false; i < count; i++) {
+		req = reqv[i];
+		cb = qdma_req_cb_get(req);
+
+		if (qdma_descq_submit(descq, cb))
+			kick = true;
+	}
+
+	if (kick)
+		qdma_descq_proc_sgt_request(descq);
+
+	return 0;
+}
+
+/**
+ * struct qdma_stripe_child - piece of a striped request
+ */
+struct qdma_stripe_child {
+	/** piece request, sgl points into the stripe sg array */
+	struct qdma_request req;
+	/** the striped request */
+	struct qdma_stripe *stripe;
+	/** queue the piece was submitted to, NULL if it failed to submit */
+	struct qdma_descq *descq;
+};
+
+/**
+ * struct qdma_stripe - striped request, followed by the pieces and their sg
+ *	entries
+ */
+struct qdma_stripe {
+	/** parent request */
+	struct qdma_request *req;
+	/** # of pieces in flight + 1 for the submitter */
+	atomic_t pending;
+	/** # of bytes transferred */
+	atomic_t done;
+	/** first error */
+	int err;
+	/** blocking mode completion */
+	struct completion cmpl;
+	/** # of pieces */
+	unsigned int nr;
+	/** pieces */
+	struct qdma_stripe_child child[0];
+};
+
+static void qdma_stripe_put(struct qdma_stripe *stripe)
+{
+	struct qdma_request *req = stripe->req;
+
+	if (!atomic_dec_and_test(&stripe->pending))
+		return;
+
+	if (req->fp_done) {
+		req->fp_done(req, atomic_read(&stripe->done), stripe->err);
+		kfree(stripe);
+	} else
+		complete(&stripe->cmpl);
+}
+
+static int qdma_stripe_child_done(struct qdma_request *req,
+				unsigned int bytes_done, int err)
+{
+	struct qdma_stripe_child *child = container_of(req,
+					struct qdma_stripe_child, req);
+	struct qdma_stripe *stripe = child->stripe;
+
+	atomic_add(bytes_done, &stripe->done);
+	if (err < 0)
+		cmpxchg(&stripe->err, 0, err);
+	qdma_stripe_put(stripe);
+
+	return 0;
+}
+
+/*
+ * complete a submitted piece that is not done yet with err, taking it off
+ * its queue as qdma_request_wait_for_cmpl() does on a timeout
+ */
+static void qdma_stripe_child_cancel(struct qdma_stripe_child *child, int err)
+{
+	struct qdma_descq *descq = child->descq;
+	struct qdma_request *req = &child->req;
+	struct qdma_sgt_req_cb *cb = qdma_req_cb_get(req);
+
 	lock_descq(descq);
-	/**  if the descq is already in online state*/
-	if (unlikely(descq->q_state != Q_STATE_ONLINE)) {
-		unlock_descq(descq);
-		pr_info("%s descq %s NOT online.\n", xdev->conf.name,
-				descq->conf.name);
+	if (!cb->done) {
+		qdma_descq_submit_drain(descq);
+		list_del(&cb->list);
+		if (cb->unmap_needed) {
+			sgl_unmap(descq->xdev->conf.pdev, req->sgl, req->sgcnt,
+				descq->conf.c2h ? DMA_FROM_DEVICE :
+				DMA_TO_DEVICE);
+			cb->unmap_needed = 0;
+		}
+		cb->req_state = QDMA_REQ_COMPLETE;
+		cb->status = err;
+		cb->done = 1;
+		req->fp_done(req, cb->offset, err);
+	}
+	unlock_descq(descq);
+}
+
+ssize_t qdma_request_submit_striped(unsigned long dev_hndl, unsigned int qcnt,
+			unsigned long *qhndls, struct qdma_request *req)
+{
+	struct xlnx_dma_dev *xdev = (struct xlnx_dma_dev *)dev_hndl;
+	struct qdma_stripe *stripe;
+	struct qdma_sw_sg *sg;
+	unsigned int piece, nr, i;
+	unsigned int sg_idx = 0, left = req->count;
+	bool wait = req->fp_done ? false : true;
+	long left_j;
+	ssize_t rv;
+
+	if (!qcnt || !req->count || !req->sgcnt)
 		return -EINVAL;
+
+	for (i = 0; i < qcnt; i++) {
+		struct qdma_descq *descq = qdma_device_get_descq_by_id(xdev,
+						qhndls[i], NULL, 0, 1);
+
+		if (!descq || descq->conf.st) {
+			pr_info("queue 0x%lx not a MM queue.\n", qhndls[i]);
+			return -EINVAL;
+		}
 	}
 
-	for (i = 0; i < count; i++) {
-		req = reqv[i];
-		cb = qdma_req_cb_get(req);
+	/** pieces of at least QDMA_STRIPE_MIN, at most one per queue */
+	piece = max_t(unsigned int, DIV_ROUND_UP(req->count, qcnt),
+			QDMA_STRIPE_MIN);
+	nr = DIV_ROUND_UP(req->count, piece);
+
+	stripe = kzalloc(sizeof(struct qdma_stripe) +
+			nr * sizeof(struct qdma_stripe_child) +
+			req->sgcnt * sizeof(struct qdma_sw_sg), GFP_KERNEL);
+	if (!stripe)
+		return -ENOMEM;
+	stripe->req = req;
+	init_completion(&stripe->cmpl);
+
+	/** the pieces are cut between sg entries, so that no page is shared
+	 *  (and dma mapped) by two of them: each takes whole entries up to
+	 *  piece bytes or more, which keeps their # within nr
+	 */
+	sg = (struct qdma_sw_sg *)(stripe->child + nr);
+	for (i = 0; left && sg_idx < req->sgcnt; i++) {
+		struct qdma_stripe_child *child = stripe->child + i;
+		struct qdma_request *creq = &child->req;
+		unsigned int n = 0;
+
+		child->stripe = stripe;
+		creq->ep_addr = req->ep_addr + (req->count - left);
+		creq->write = req->write;
+		creq->dma_mapped = req->dma_mapped;
+		creq->no_memcpy = req->no_memcpy;
+		creq->timeout_ms = req->timeout_ms;
+		creq->fp_done = qdma_stripe_child_done;
+		creq->sgl = sg;
+		while (left && sg_idx < req->sgcnt && creq->count < piece) {
+			sg[n] = req->sgl[sg_idx++];
+			sg[n].len = min_t(unsigned int, sg[n].len, left);
+			sg[n].next = sg + n + 1;
+			creq->count += sg[n].len;
+			left -= sg[n].len;
+			n++;
+		}
+		sg[n - 1].next = NULL;
+		creq->sgcnt = n;
+		sg += n;
+	}
+	if (left) {
+		pr_info("sgl too short %u, %u bytes left.\n", req->sgcnt, left);
+		kfree(stripe);
+		return -EINVAL;
+	}
+	nr = i;
+	stripe->nr = nr;
+	atomic_set(&stripe->pending, nr + 1);
+
+	pr_debug("%u bytes, ep 0x%llx -> %u pieces of >= %u bytes, %u queues.\n",
+		req->count, req->ep_addr, nr, piece, qcnt);
+
+	for (i = 0; i < nr; i++) {
+		struct qdma_request *creq = &stripe->child[i].req;
 
-		list_add_tail(&cb->list, &descq->work_list);
+		rv = qdma_request_submit(dev_hndl, qhndls[i], creq);
+		if (rv < 0)
+			qdma_stripe_child_done(creq, 0, rv);
+		else
+			stripe->child[i].descq = qdma_device_get_descq_by_id(
+						xdev, qhndls[i], NULL, 0, 1);
 	}
-	unlock_descq(descq);
 
-	qdma_descq_proc_sgt_request(descq);
+	/** the stripe is freed by the last piece in non-blocking mode */
+	qdma_stripe_put(stripe);
+	if (!wait)
+		return 0;
 
-	return 0;
+	/** bounded by the request timeout, as a single queue request */
+	if (req->timeout_ms)
+		left_j = wait_for_completion_killable_timeout(&stripe->cmpl,
+					msecs_to_jiffies(req->timeout_ms));
+	else if (wait_for_completion_killable(&stripe->cmpl))
+		left_j = -ERESTARTSYS;
+	else
+		left_j = 1;
+	if (left_j <= 0) {
+		int err = left_j ? (int)left_j : -ETIMEDOUT;
+
+		pr_info("%u bytes, ep 0x%llx, %u pieces, err %d.\n",
+			req->count, req->ep_addr, nr, err);
+		for (i = 0; i < nr; i++)
+			if (stripe->child[i].descq)
+				qdma_stripe_child_cancel(stripe->child + i,
+							err);
+		/* every piece is complete now */
+		wait_for_completion(&stripe->cmpl);
+	}
+	rv = stripe->err ? stripe->err : atomic_read(&stripe->done);
+	kfree(stripe);
+
+	return rv;
 }
 
 /*****************************************************************************/
@@ -2131,11 +2771,13 @@ ssize_t qdma_batch_request_submit(unsigned long dev_hndl, unsigned long id,
  *
  * @param[in] num_threads - number of threads to be created each for request
  *  processing and writeback processing
+ * @param[in] thread_cpus - cpu list the threads are bound to, NULL for all
+ *  online cpus
  *
  * @return	0:	success
  * @return	<0:	error
  *****************************************************************************/
-int libqdma_init(unsigned int num_threads)
+int libqdma_init(unsigned int num_threads, const char *thread_cpus)
 {
 
 	/** Make sure that the size of qdma scatter gather request size
@@ -2154,7 +2796,7 @@ int libqdma_init(unsigned int num_threads)
 	}
 
 	/** Create the qdma threads */
-	qdma_threads_create(num_threads);
+	qdma_threads_create(num_threads, thread_cpus);
 #ifdef DEBUGFS
 	return qdma_debugfs_init(&qdma_debugfs_root);
 #else
@@ -2177,6 +2819,20 @@ void libqdma_exit(void)
 	qdma_threads_destroy();
 }
 
+/*****************************************************************************/
+/**
+ * libqdma_rebalance_interval() - set the interval of the periodic queue
+ *				  rebalancing
+ *
+ * @param[in]	interval_ms:	rebalancing interval in ms, 0 to disable
+ *
+ * @return	none
+ *****************************************************************************/
+void libqdma_rebalance_interval(unsigned int interval_ms)
+{
+	qdma_threads_rebalance_interval(interval_ms);
+}
+
 #ifdef __LIBQDMA_MOD__
 /** for module support only */
 #include "version.h"
@@ -31,6 +31,7 @@
 
 #include <linux/types.h>
 #include <linux/interrupt.h>
+#include <linux/mm_types.h>
 #include "libqdma_config.h"
 #include "qdma_access_export.h"
 
@@ -154,11 +155,12 @@ struct pci_dev;
  *
  * @num_threads: number of threads to be created each for request
  *  processing and writeback processing
+ * @thread_cpus: cpu list the threads are bound to, NULL for all online cpus
  *
  * Return: 0:	success <0:	error
  *
  *****************************************************************************/
-int libqdma_init(unsigned int num_threads);
+int libqdma_init(unsigned int num_threads, const char *thread_cpus);
 
 /*****************************************************************************/
 /**
@@ -169,6 +171,20 @@ int libqdma_init(unsigned int num_threads);
  *****************************************************************************/
 void libqdma_exit(void);
 
+/*****************************************************************************/
+/**
+ * libqdma_rebalance_interval() - set the interval of the periodic queue
+ *	rebalancing
+ *
+ * Every interval, the service time of each queue is sampled and the queues
+ * of a busy completion thread (poll mode) or interrupt work cpu (interrupt
+ * mode) are moved to the least loaded one.
+ *
+ * @interval_ms: rebalancing interval in ms, 0 to disable
+ *
+ *****************************************************************************/
+void libqdma_rebalance_interval(unsigned int interval_ms);
+
 /**
  * enum intr_ring_size_sel - qdma interrupt ring size selection
  *
@@ -317,6 +333,18 @@ struct qdma_dev_conf {
 	u8 tm_mode_en;
 	/** @tm_one_cdh_en: enable 1 CDH for Traffic Manager */
 	u8 tm_one_cdh_en;
+	/** @pidx_coal_desc: MM and ST H2C, write the pidx once this many
+	 *  descriptors are pending, 0 to write it for every submission
+	 */
+	u16 pidx_coal_desc;
+	/** @pidx_coal_us: max. time a pidx write is deferred, in us,
+	 *  0 disables the coalescing
+	 */
+	u16 pidx_coal_us;
+	/** @cmpl_poll_us: polled completion, max. time a blocking request
+	 *  spins on the completion status before it sleeps, in us
+	 */
+	u16 cmpl_poll_us;
 
 	/**
 	 *  @fp_user_isr_handler: user interrupt, if null,
@@ -802,6 +830,25 @@ struct qdma_queue_conf {
 	/** @at: Address Translation */
 	u8 at:1;
 
+	/** config flags: byte #7 */
+	/** @c2h_zerocopy: ST C2H only, post the read request pages as
+	 *  the C2H descriptors instead of the pre-allocated free list,
+	 *  the request length must be a multiple of c2h_bufsz
+	 */
+	u8 c2h_zerocopy:1;
+	/** @adaptive_cmpl: ST C2H with completion interrupt only, service
+	 *  the completions with a budget, poll instead of re-arming the
+	 *  interrupt while the budget is used up, and adjust the trigger
+	 *  mode, timer and counter indexes to the observed rate. The
+	 *  cmpl_trig_mode, cmpl_timer_idx and cmpl_cnt_th_idx are ignored.
+	 */
+	u8 adaptive_cmpl:1;
+	/** @cmpl_poll: the blocking requests spin on the completion status
+	 *  for up to qdma_dev_conf.cmpl_poll_us before they sleep, not with
+	 *  adaptive_cmpl
+	 */
+	u8 cmpl_poll:1;
+
 	/** @en_mm_cmpt: MM Completions enabled? */
 	u8 en_mm_cmpt;
 	/*
@@ -837,7 +884,9 @@ struct qdma_queue_conf {
 	 * sgcnt / sgl: packet data in scatter-gather list
 	 *
 	 *   NOTE: a. do NOT modify any field of sgl
-	 *	   b. if zero copy, do a get_page() to prevent page freeing
+	 *	   b. if zero copy, do a get_page() to prevent page freeing,
+	 *	      the page is recycled by the queue's page pool once the
+	 *	      reference is dropped
 	 *	   c. do loop through the sgl with sg->next and stop
 	 *	      at sgcnt. the last sg may not have sg->next = NULL
 	 *
@@ -928,6 +977,73 @@ int qdma_queue_start(unsigned long dev_hndl, unsigned long id,
  *****************************************************************************/
 int qdma_queue_stop(unsigned long dev_hndl, unsigned long id, char *buf,
 				int buflen);
+
+/**
+ * struct qdma_queue_bulk_stats - per phase timing of qdma_queue_start_bulk()
+ *	and qdma_queue_stop_bulk()
+ */
+struct qdma_queue_bulk_stats {
+	/** @qcnt: # of queues started or stopped */
+	unsigned int qcnt;
+	/** @rings_reused: # of rings kept from a previous start and reused */
+	unsigned int rings_reused;
+	/** @config_ns: start: state check and software configuration */
+	u64 config_ns;
+	/** @alloc_ns: start: ring and buffer allocation */
+	u64 alloc_ns;
+	/** @prog_ns: start: hw context programming */
+	u64 prog_ns;
+	/** @online_ns: start: interrupt and thread setup */
+	u64 online_ns;
+	/** @drain_ns: stop: wait for the outstanding requests */
+	u64 drain_ns;
+	/** @clear_ns: stop: hw context clearing */
+	u64 clear_ns;
+	/** @free_ns: stop: buffer release */
+	u64 free_ns;
+};
+
+/*****************************************************************************/
+/**
+ * qdma_queue_start_bulk() - start a range of queues, phase by phase
+ *
+ * The rings of a queue are kept when it is stopped and reused by the next
+ * start with the same ring size, until the queue is removed.
+ *
+ * @dev_hndl:	dev_hndl returned from qdma_device_open()
+ * @qcnt:	# of queues
+ * @qhndls:	the opaque qhndls
+ * @stats:	per phase timing, can be NULL
+ * @buflen:	length of the input buffer
+ * @buf:	message buffer
+ *
+ * Return:	0 for success and <0 for error, none of the queues is started
+ *
+ *****************************************************************************/
+int qdma_queue_start_bulk(unsigned long dev_hndl, unsigned int qcnt,
+			unsigned long *qhndls,
+			struct qdma_queue_bulk_stats *stats,
+			char *buf, int buflen);
+
+/*****************************************************************************/
+/**
+ * qdma_queue_stop_bulk() - stop a range of queues, phase by phase
+ *
+ * @dev_hndl:	dev_hndl returned from qdma_device_open()
+ * @qcnt:	# of queues
+ * @qhndls:	the opaque qhndls
+ * @stats:	per phase timing, can be NULL
+ * @buflen:	length of the input buffer
+ * @buf:	message buffer
+ *
+ * Return:	0 for success and <0 for error, the queues before the failing
+ *		one are stopped
+ *
+ *****************************************************************************/
+int qdma_queue_stop_bulk(unsigned long dev_hndl, unsigned int qcnt,
+			unsigned long *qhndls,
+			struct qdma_queue_bulk_stats *stats,
+			char *buf, int buflen);
 /**
  * struct qdma_q_state - display queue state in a string buffer
  *
@@ -1125,6 +1241,10 @@ struct qdma_request {
 	u8 dma_mapped:1;
 	/** @h2c_eot: user defined data present */
 	u8 h2c_eot:1;
+	/** @poll: blocking only, spin on the completion status before
+	 *  sleeping, as qdma_queue_conf.cmpl_poll does for the whole queue
+	 */
+	u8 poll:1;
 	/** @udd_len: indicates end of transfer towards user kernel */
 	u8 udd_len;
 	/** @sgcnt: # of scatter-gather entries < 64K */
@@ -1166,6 +1286,34 @@ ssize_t qdma_request_submit(unsigned long dev_hndl, unsigned long id,
 ssize_t qdma_batch_request_submit(unsigned long dev_hndl, unsigned long id,
 			  unsigned long count, struct qdma_request **reqv);
 
+/*****************************************************************************/
+/**
+ * qdma_request_submit_striped() - split a MM request across several queues
+ *
+ * The request is cut into up to qcnt contiguous pieces of at least
+ * QDMA_STRIPE_MIN bytes but the last, one per queue, submitted
+ * concurrently. Pieces end on sg entry boundaries, so no page is shared
+ * between two of them. req
+ * completes once all the pieces did: with req->fp_done set, fp_done is
+ * called with the total # of bytes and the first error, otherwise the call
+ * blocks until then, for up to req->timeout_ms (0: no timeout) or a fatal
+ * signal, after which the pieces still pending are cancelled.
+ *
+ * @dev_hndl:	hndl returned from qdma_device_open()
+ * @qcnt:	number of queues
+ * @qhndls:	MM queues of the request direction, possibly on both channels
+ * @req:	qdma request, ep_addr is the start of the whole transfer
+ *
+ * Return:	# of bytes transferred (0 in non-blocking mode) for success
+ *		and <0 for error
+ *
+ *****************************************************************************/
+ssize_t qdma_request_submit_striped(unsigned long dev_hndl, unsigned int qcnt,
+			unsigned long *qhndls, struct qdma_request *req);
+
+/** min. size of a piece of a striped request */
+#define QDMA_STRIPE_MIN		(64 * 1024)
+
 /*****************************************************************************/
 /**
  * qdma_queue_c2h_peek() - peek a receive (c2h) queue
@@ -1215,6 +1363,36 @@ struct qdma_cmpl_ctrl {
 };
 
 
+/*****************************************************************************/
+/**
+ * qdma_queue_c2h_ring_mmap() - map the ST C2H free list buffers and the
+ *	received buffer ring into the user space, see qdma_c2h_ring.h for
+ *	the layout. Once mapped, the queue no longer serves read requests
+ *	until it is stopped.
+ *
+ * @dev_hndl:	hndl returned from qdma_device_open()
+ * @qhndl:		hndl returned from qdma_queue_add()
+ * @vma:		user space mapping, must cover the whole layout
+ *
+ * Return:	0 for success or <0 for error
+ *****************************************************************************/
+int qdma_queue_c2h_ring_mmap(unsigned long dev_hndl, unsigned long qhndl,
+			struct vm_area_struct *vma);
+
+/*****************************************************************************/
+/**
+ * qdma_queue_c2h_ring_wait() - recycle the buffers consumed through the
+ *	mmap'ed ring and wait for received packets
+ *
+ * @dev_hndl:	hndl returned from qdma_device_open()
+ * @qhndl:		hndl returned from qdma_queue_add()
+ * @timeout_ms:	max. wait in mili-seconds if nothing is pending, 0 - no wait
+ *
+ * Return:	# of ring entries available to the user or <0 for error
+ *****************************************************************************/
+int qdma_queue_c2h_ring_wait(unsigned long dev_hndl, unsigned long qhndl,
+			unsigned int timeout_ms);
+
 /*****************************************************************************/
 /**
  * qdma_queue_cmpl_ctrl() - read/set the c2h Q's completion control
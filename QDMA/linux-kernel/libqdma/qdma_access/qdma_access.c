@@ -957,7 +957,7 @@ static int32_t all_hw_errs[TOTAL_LEAF_ERROR_AGGREGATORS] = {
 
 static int hw_monitor_reg(void *dev_hndl, unsigned int reg, uint32_t mask,
 		uint32_t val, unsigned int interval_us,
-		unsigned int timeout_us);
+		unsigned int timeout_us, struct qdma_reg_poll_stats *stats);
 static int qdma_indirect_reg_invalidate(void *dev_hndl,
 		enum ind_ctxt_cmd_sel sel, uint16_t hw_qid);
 static int qdma_indirect_reg_clear(void *dev_hndl,
@@ -971,16 +971,39 @@ static void qdma_read_csr_values(void *dev_hndl, uint32_t reg_offst,
 static void qdma_write_csr_values(void *dev_hndl, uint32_t reg_offst,
 		uint32_t idx, uint32_t cnt, const uint32_t *values);
 
+/*
+ * busy polling statistics per context type, summed over all the devices, so
+ * protected by qdma_stats_lock_take() rather than the per device register
+ * access lock
+ */
+static struct qdma_reg_poll_stats reg_poll_stats[QDMA_CTXT_SEL_MAX];
+
+static const char *ctxt_sel_name[QDMA_CTXT_SEL_MAX] = {
+	"SW_C2H", "SW_H2C", "HW_C2H", "HW_H2C", "CR_C2H", "CR_H2C",
+	"CMPT", "PFTCH", "INT_COAL", "PASID_LOW", "PASID_HIGH", "TIMER",
+	"FMAP"
+};
+
 /*
  * hw_monitor_reg() - polling a register repeatly until
  *	(the register value & mask) == val or time is up
  *
+ * The register is read back-to-back QDMA_REG_POLL_SPIN_CNT times first,
+ * then with delays doubling from QDMA_REG_POLL_MIN_INTERVAL_US up to
+ * interval_us, the indirect context commands mostly complete well within
+ * a poll interval.
+ *
  * return -QDMA_BUSY_IIMEOUT_ERR if register value didn't match, 0 other wise
  */
 static int hw_monitor_reg(void *dev_hndl, unsigned int reg, uint32_t mask,
-		uint32_t val, unsigned int interval_us, unsigned int timeout_us)
-{
-	int count;
+		uint32_t val, unsigned int interval_us, unsigned int timeout_us,
+		struct qdma_reg_poll_stats *stats)
+{
+	unsigned int spin = QDMA_REG_POLL_SPIN_CNT;
+	unsigned int delay_us = QDMA_REG_POLL_MIN_INTERVAL_US;
+	unsigned int waited_us = 0;
+	unsigned int reads = 0;
+	int rv = -QDMA_BUSY_TIMEOUT_ERR;
 	uint32_t v;
 
 	if (!interval_us)
@@ -988,20 +1011,78 @@ static int hw_monitor_reg(void *dev_hndl, unsigned int reg, uint32_t mask,
 	if (!timeout_us)
 		timeout_us = QDMA_REG_POLL_DFLT_TIMEOUT_US;
 
-	count = timeout_us / interval_us;
-
-	do {
+	while (1) {
 		v = qdma_reg_read(dev_hndl, reg);
-		if ((v & mask) == val)
-			return QDMA_SUCCESS;
-		qdma_udelay(interval_us);
-	} while (--count);
+		reads++;
+		if ((v & mask) == val) {
+			rv = QDMA_SUCCESS;
+			break;
+		}
+		if (spin) {
+			spin--;
+			continue;
+		}
+		if (waited_us >= timeout_us)
+			break;
+		qdma_udelay(delay_us);
+		waited_us += delay_us;
+		delay_us <<= 1;
+		if (delay_us > interval_us)
+			delay_us = interval_us;
+	}
 
-	v = qdma_reg_read(dev_hndl, reg);
-	if ((v & mask) == val)
-		return QDMA_SUCCESS;
+	if (stats) {
+		qdma_stats_lock_take();
+		stats->ops++;
+		if (!waited_us)
+			stats->spin_done++;
+		stats->reads += reads;
+		stats->delay_us += waited_us;
+		if (waited_us > stats->max_delay_us)
+			stats->max_delay_us = waited_us;
+		if (rv < 0)
+			stats->timeouts++;
+		qdma_stats_lock_give();
+	}
+
+	return rv;
+}
+
+static inline struct qdma_reg_poll_stats *ctxt_poll_stats(
+		enum ind_ctxt_cmd_sel sel)
+{
+	return (sel < QDMA_CTXT_SEL_MAX) ? &reg_poll_stats[sel] : NULL;
+}
+
+int qdma_reg_poll_stats_get(uint8_t sel,
+		struct qdma_reg_poll_stats *stats)
+{
+	if (!stats || sel >= QDMA_CTXT_SEL_MAX)
+		return -QDMA_INVALID_PARAM_ERR;
+
+	qdma_stats_lock_take();
+	*stats = reg_poll_stats[sel];
+	qdma_stats_lock_give();
+
+	return QDMA_SUCCESS;
+}
+
+void qdma_reg_poll_stats_clear(void)
+{
+	int i;
+
+	qdma_stats_lock_take();
+	for (i = 0; i < QDMA_CTXT_SEL_MAX; i++)
+		reg_poll_stats[i] = (struct qdma_reg_poll_stats){ 0 };
+	qdma_stats_lock_give();
+}
+
+const char *qdma_get_ctxt_sel_name(uint8_t sel)
+{
+	if (sel < QDMA_CTXT_SEL_MAX)
+		return ctxt_sel_name[sel];
 
-	return -QDMA_BUSY_TIMEOUT_ERR;
+	return NULL;
 }
 
 static int qdma_indirect_reg_invalidate(void *dev_hndl,
@@ -1022,7 +1103,7 @@ static int qdma_indirect_reg_invalidate(void *dev_hndl,
 	if (hw_monitor_reg(dev_hndl, QDMA_OFFSET_IND_CTXT_CMD,
 			QDMA_IND_CTXT_CMD_BUSY_MASK, 0,
 			QDMA_REG_POLL_DFLT_INTERVAL_US,
-			QDMA_REG_POLL_DFLT_TIMEOUT_US)) {
+			QDMA_REG_POLL_DFLT_TIMEOUT_US, ctxt_poll_stats(sel))) {
 		qdma_reg_access_release(dev_hndl);
 		return -QDMA_CONTEXT_BUSY_TIMEOUT_ERR;
 	}
@@ -1050,7 +1131,7 @@ static int qdma_indirect_reg_clear(void *dev_hndl,
 	if (hw_monitor_reg(dev_hndl, QDMA_OFFSET_IND_CTXT_CMD,
 			QDMA_IND_CTXT_CMD_BUSY_MASK, 0,
 			QDMA_REG_POLL_DFLT_INTERVAL_US,
-			QDMA_REG_POLL_DFLT_TIMEOUT_US)) {
+			QDMA_REG_POLL_DFLT_TIMEOUT_US, ctxt_poll_stats(sel))) {
 		qdma_reg_access_release(dev_hndl);
 		return -QDMA_CONTEXT_BUSY_TIMEOUT_ERR;
 	}
@@ -1079,7 +1160,7 @@ static int qdma_indirect_reg_read(void *dev_hndl, enum ind_ctxt_cmd_sel sel,
 	if (hw_monitor_reg(dev_hndl, QDMA_OFFSET_IND_CTXT_CMD,
 			QDMA_IND_CTXT_CMD_BUSY_MASK, 0,
 			QDMA_REG_POLL_DFLT_INTERVAL_US,
-			QDMA_REG_POLL_DFLT_TIMEOUT_US)) {
+			QDMA_REG_POLL_DFLT_TIMEOUT_US, ctxt_poll_stats(sel))) {
 		qdma_reg_access_release(dev_hndl);
 		return -QDMA_CONTEXT_BUSY_TIMEOUT_ERR;
 	}
@@ -1124,7 +1205,7 @@ static int qdma_indirect_reg_write(void *dev_hndl, enum ind_ctxt_cmd_sel sel,
 	if (hw_monitor_reg(dev_hndl, QDMA_OFFSET_IND_CTXT_CMD,
 			QDMA_IND_CTXT_CMD_BUSY_MASK, 0,
 			QDMA_REG_POLL_DFLT_INTERVAL_US,
-			QDMA_REG_POLL_DFLT_TIMEOUT_US)) {
+			QDMA_REG_POLL_DFLT_TIMEOUT_US, ctxt_poll_stats(sel))) {
 		qdma_reg_access_release(dev_hndl);
 		return -QDMA_CONTEXT_BUSY_TIMEOUT_ERR;
 	}
@@ -2242,7 +2323,7 @@ int qdma_is_flr_done(void *dev_hndl, uint8_t is_vf, uint8_t *done)
 	/* wait for it to become zero */
 	rv = hw_monitor_reg(dev_hndl, reg_addr, QDMA_FLR_STATUS_MASK,
 			0, 5 * QDMA_REG_POLL_DFLT_INTERVAL_US,
-			QDMA_REG_POLL_DFLT_TIMEOUT_US);
+			QDMA_REG_POLL_DFLT_TIMEOUT_US, NULL);
 	if (rv < 0)
 		*done = 0;
 	else
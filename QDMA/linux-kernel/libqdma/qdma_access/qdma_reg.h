@@ -109,6 +109,10 @@ static inline uint8_t get_trailing_zeros(uint64_t x)
 /* polling a register */
 #define	QDMA_REG_POLL_DFLT_INTERVAL_US	100		/* 100us per poll */
 #define	QDMA_REG_POLL_DFLT_TIMEOUT_US	(500*1000)	/* 500ms */
+/* back-to-back reads before the first delay */
+#define	QDMA_REG_POLL_SPIN_CNT		16
+/* first delay, doubled up to the poll interval */
+#define	QDMA_REG_POLL_MIN_INTERVAL_US	1
 
 /*
  * Q Context programming (indirect)
@@ -134,6 +138,7 @@ enum ind_ctxt_cmd_sel {
 	QDMA_CTXT_SEL_PASID_RAM_HIGH,
 	QDMA_CTXT_SEL_TIMER,
 	QDMA_CTXT_SEL_FMAP,
+	QDMA_CTXT_SEL_MAX
 };
 
 #define QDMA_REG_IND_CTXT_REG_COUNT                         8
@@ -55,15 +55,18 @@
 #define qdma_waitq_wakeup               swake_up
 #define qdma_waitq_wait_event           swait_event_interruptible
 #define qdma_waitq_wait_event_timeout   swait_event_interruptible_timeout
+#define qdma_waitq_wait_event_uninterruptible	swait_event
 
 #else
 #include <linux/wait.h>
 
 #define qdma_wait_queue                 wait_queue_head_t
 #define qdma_waitq_init                 init_waitqueue_head
-#define qdma_waitq_wakeup               wake_up_interruptible
+/* wake_up(): qdma_waitq_wait_event_uninterruptible() sleepers too */
+#define qdma_waitq_wakeup               wake_up
 #define qdma_waitq_wait_event           wait_event_interruptible
 #define qdma_waitq_wait_event_timeout   wait_event_interruptible_timeout
+#define qdma_waitq_wait_event_uninterruptible	wait_event
 
 #endif  /* swaitq */
 
@@ -20,6 +20,108 @@
 #define pr_fmt(fmt)	KBUILD_MODNAME ":%s: " fmt, __func__
 
 #include "qdma_debugfs.h"
+#include "qdma_thread.h"
+#include "qdma_access.h"
+
+/*****************************************************************************/
+/**
+ * threads_read() - read the completion thread and interrupt work cpu
+ *	placement
+ *
+ * @return	>=0: # of bytes read
+ * @return	<0: error
+ *****************************************************************************/
+static ssize_t threads_read(struct file *fp, char __user *user_buffer,
+			size_t count, loff_t *ppos)
+{
+	int buflen = PAGE_SIZE;
+	char *buf;
+	int len;
+	ssize_t rv;
+
+	/* grow the buffer until the dump fits */
+	while (1) {
+		buf = kzalloc(buflen, GFP_KERNEL);
+		if (!buf)
+			return -ENOMEM;
+		len = qdma_threads_dump(buf, buflen);
+		if (len < buflen - 1)
+			break;
+		kfree(buf);
+		buflen <<= 1;
+	}
+
+	rv = simple_read_from_buffer(user_buffer, count, ppos, buf, len);
+	kfree(buf);
+
+	return rv;
+}
+
+static const struct file_operations threads_fops = {
+	.owner = THIS_MODULE,
+	.open = simple_open,
+	.read = threads_read,
+};
+
+/*****************************************************************************/
+/**
+ * reg_poll_read() - read the busy polling statistics of the indirect
+ *	context commands, per context type
+ *
+ * @return	>=0: # of bytes read
+ * @return	<0: error
+ *****************************************************************************/
+static ssize_t reg_poll_read(struct file *fp, char __user *user_buffer,
+			size_t count, loff_t *ppos)
+{
+	struct qdma_reg_poll_stats stats;
+	int buflen = PAGE_SIZE;
+	char *buf;
+	int len;
+	u8 sel;
+	ssize_t rv;
+
+	buf = kzalloc(buflen, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	len = snprintf(buf, buflen, "%-10s %10s %10s %10s %12s %8s %8s\n",
+			"ctxt", "ops", "spin_done", "reads", "delay_us",
+			"max_us", "timeout");
+	for (sel = 0; !qdma_reg_poll_stats_get(sel, &stats) &&
+			len < buflen; sel++)
+		len += snprintf(buf + len, buflen - len,
+			"%-10s %10llu %10llu %10llu %12llu %8u %8u\n",
+			qdma_get_ctxt_sel_name(sel), stats.ops,
+			stats.spin_done, stats.reads, stats.delay_us,
+			stats.max_delay_us, stats.timeouts);
+
+	rv = simple_read_from_buffer(user_buffer, count, ppos, buf, len);
+	kfree(buf);
+
+	return rv;
+}
+
+/*****************************************************************************/
+/**
+ * reg_poll_write() - any write clears the busy polling statistics
+ *
+ * @return	# of bytes written
+ *****************************************************************************/
+static ssize_t reg_poll_write(struct file *fp, const char __user *user_buffer,
+			size_t count, loff_t *ppos)
+{
+	qdma_reg_poll_stats_clear();
+
+	return count;
+}
+
+static const struct file_operations reg_poll_fops = {
+	.owner = THIS_MODULE,
+	.open = simple_open,
+	.read = reg_poll_read,
+	.write = reg_poll_write,
+};
 
 /*****************************************************************************/
 /**
@@ -50,6 +152,11 @@ int qdma_debugfs_init(struct dentry **qdma_debugfs_root)
 
 #endif
 
+	debugfs_create_file("threads", 0444, debugfs_root, NULL,
+			    &threads_fops);
+	debugfs_create_file("reg_poll", 0644, debugfs_root, NULL,
+			    &reg_poll_fops);
+
 	*qdma_debugfs_root = debugfs_root;
 	return 0;
 }
@@ -25,6 +25,7 @@
 #include "qdma_regs.h"
 #include "qdma_context.h"
 #include "qdma_descq.h"
+#include "qdma_st_c2h.h"
 #include "qdma_regs.h"
 #include <linux/uaccess.h>
 
@@ -43,6 +44,7 @@ enum dbgfs_queue_info_type {
 	DBGFS_QINFO_INFO = 0,
 	DBGFS_QINFO_CNTXT = 1,
 	DBGFS_QINFO_DESC = 2,
+	DBGFS_QINFO_FLQ_POOL = 3,
 	DBGFS_QINFO_END,
 };
 
@@ -96,6 +98,8 @@ static int qdbg_desc_read(unsigned long dev_hndl, unsigned long id, char **data,
 		int *data_len, enum dbgfs_desc_type type);
 static int qdbg_cntxt_read(unsigned long dev_hndl, unsigned long id,
 		char **data, int *data_len, enum dbgfs_desc_type type);
+static int qdbg_flq_pool_read(unsigned long dev_hndl, unsigned long id,
+		char **data, int *data_len);
 
 /*****************************************************************************/
 /**
@@ -663,6 +667,46 @@ static int qdbg_desc_read(unsigned long dev_hndl, unsigned long id, char **data,
 	return len;
 }
 
+/*****************************************************************************/
+/**
+ * qdbg_flq_pool_read() - reads the free list page pool statistics of a queue
+ *
+ * @param[in]	dev_hndl:	xdev device handle
+ * @param[in]	id: queue handle
+ * @param[out]	data: buffer pointer to collect the statistics
+ * @param[out]	data_len: buffer len pointer
+ *
+ * @return	>0: size read
+ * @return	<0: error
+ *****************************************************************************/
+static int qdbg_flq_pool_read(unsigned long dev_hndl, unsigned long id,
+		char **data, int *data_len)
+{
+	int len = 0;
+	char *buf = NULL;
+	int buflen = DEBUGFS_QUEUE_INFO_SZ;
+	struct qdma_descq *descq = NULL;
+	struct xlnx_dma_dev *xdev = (struct xlnx_dma_dev *)dev_hndl;
+
+	/** allocate memory */
+	buf = (char *) kzalloc(buflen, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	descq = qdma_device_get_descq_by_id(xdev, id, buf, buflen, 0);
+	if (!descq) {
+		kfree(buf);
+		return QDMA_ERR_INVALID_QIDX;
+	}
+
+	len = descq_flq_pool_dump(descq, buf, buflen);
+
+	*data = buf;
+	*data_len = buflen;
+
+	return len;
+}
+
 /*****************************************************************************/
 /**
  * q_dbg_file_read() - static function that provides common read
@@ -693,6 +737,9 @@ static ssize_t q_dbg_file_read(struct file *fp, char __user *user_buffer,
 		} else if (type == DBGFS_QINFO_DESC) {
 			rv = qdbg_desc_read(qpriv->dev_hndl, qpriv->qhndl,
 					&buf, &buf_len, DBGFS_DESC_TYPE_C2H);
+		} else if (type == DBGFS_QINFO_FLQ_POOL) {
+			rv = qdbg_flq_pool_read(qpriv->dev_hndl, qpriv->qhndl,
+					&buf, &buf_len);
 		}
 
 		if (rv < 0)
@@ -833,6 +880,40 @@ static ssize_t q_desc_read(struct file *fp, char __user *user_buffer,
 	return q_dbg_file_read(fp, user_buffer, count, ppos, DBGFS_QINFO_DESC);
 }
 
+/*****************************************************************************/
+/**
+ * q_flq_pool_open() - static function that executes flq_pool file open
+ *
+ * @param[in]	inode:	pointer to file inode
+ * @param[in]	fp:	pointer to file structure
+ *
+ * @return	0: success
+ * @return	<0: error
+ *****************************************************************************/
+static int q_flq_pool_open(struct inode *inode, struct file *fp)
+{
+	return q_dbg_file_open(inode, fp);
+}
+
+/*****************************************************************************/
+/**
+ * q_flq_pool_read() - static function that executes flq_pool file read
+ *
+ * @param[in]	fp:	pointer to file structure
+ * @param[out]	user_buffer: pointer to user buffer
+ * @param[in]	count: size of data to read
+ * @param[in/out]	ppos: pointer to offset read
+ *
+ * @return	>0: size read
+ * @return	<0: error
+ *****************************************************************************/
+static ssize_t q_flq_pool_read(struct file *fp, char __user *user_buffer,
+		size_t count, loff_t *ppos)
+{
+	return q_dbg_file_read(fp, user_buffer, count, ppos,
+			DBGFS_QINFO_FLQ_POOL);
+}
+
 /*****************************************************************************/
 /**
  * create_q_dbg_files() - static function to create queue debug files
@@ -872,10 +953,21 @@ int create_q_dbg_files(struct qdma_descq *descq, struct dentry *queue_root)
 			fops->read = q_desc_read;
 			fops->release = q_dbg_file_release;
 			break;
+		case DBGFS_QINFO_FLQ_POOL:
+			snprintf(qf[i].name, DBGFS_DBG_FNAME_SZ, "%s",
+					"flq_pool");
+			fops->open = q_flq_pool_open;
+			fops->read = q_flq_pool_read;
+			fops->release = q_dbg_file_release;
+			break;
 		}
 	}
 
 	for (i = 0; i < DBGFS_QINFO_END; i++) {
+		/* free list page pool: st c2h only */
+		if (i == DBGFS_QINFO_FLQ_POOL &&
+		    !(descq->conf.st && descq->conf.c2h))
+			continue;
 		fp[i] = debugfs_create_file(qf[i].name, 0644, queue_root,
 				descq, &qf[i].fops);
 		if (!fp[i])
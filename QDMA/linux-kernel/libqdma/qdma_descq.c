@@ -23,6 +23,7 @@
 
 #include <linux/kernel.h>
 #include <linux/delay.h>
+#include <linux/log2.h>
 
 #include "qdma_device.h"
 #include "qdma_intr.h"
@@ -79,6 +80,41 @@ static int sgl_find_offset(struct qdma_sw_sg *sgl, unsigned int sgcnt,
 	return -EINVAL;
 }
 
+/*
+ * extend the dma span [addr, addr + *len) ending in *sg_p with the next
+ * entries, at most nr, that continue it, as long as the span stays within
+ * max bytes. Returns the # of entries merged, *sg_p is moved to the last.
+ */
+static unsigned int sgl_merge_contig(struct qdma_sw_sg **sg_p,
+			unsigned int nr, dma_addr_t addr, unsigned int *len,
+			unsigned int max)
+{
+	struct qdma_sw_sg *sg = *sg_p;
+	unsigned int i;
+
+	for (i = 0; i < nr && *len < max; i++, sg++) {
+		if (sg[1].dma_addr != addr + *len ||
+				sg[1].len > max - *len)
+			break;
+		*len += sg[1].len;
+	}
+	*sg_p = sg;
+
+	return i;
+}
+
+/*
+ * ST H2C descriptor length: up to QDMA_ST_H2C_DESC_LEN_MAX, a page for the
+ * STM, traffic manager and bypass designs
+ */
+static inline unsigned int descq_st_h2c_desc_max(struct qdma_descq *descq)
+{
+	if (descq->xdev->stm_en || descq->xdev->conf.tm_mode_en ||
+			descq->conf.desc_bypass)
+		return PAGE_SIZE;
+	return QDMA_ST_H2C_DESC_LEN_MAX;
+}
+
 static inline void req_submitted(struct qdma_descq *descq,
 				struct qdma_sgt_req_cb *cb)
 {
@@ -89,6 +125,46 @@ static inline void req_submitted(struct qdma_descq *descq,
 
 static int descq_mm_n_h2c_cmpl_status(struct qdma_descq *descq);
 
+void qdma_descq_submit_drain(struct qdma_descq *descq)
+{
+	struct llist_node *first = llist_del_all(&descq->submit_list);
+	struct qdma_sgt_req_cb *cb, *tmp;
+
+	if (!first)
+		return;
+
+	/* llist is LIFO, keep the submission order */
+	first = llist_reverse_order(first);
+	llist_for_each_entry_safe(cb, tmp, first, llnode)
+		list_add_tail(&cb->list, &descq->work_list);
+}
+
+void qdma_descq_cancel_work(struct qdma_descq *descq)
+{
+	struct qdma_sgt_req_cb *cb, *tmp;
+	struct qdma_request *req;
+
+	qdma_descq_submit_drain(descq);
+	list_for_each_entry_safe(cb, tmp, &descq->work_list, list) {
+		req = (struct qdma_request *)cb;
+		cb->req_state = QDMA_REQ_COMPLETE;
+		cb->done = 1;
+		cb->status = -ENXIO;
+		/* the waiter only unlinks a request that is not done */
+		list_del(&cb->list);
+		if (req->fp_done) {
+			if (cb->unmap_needed) {
+				sgl_unmap(descq->xdev->conf.pdev, req->sgl,
+					req->sgcnt, descq->conf.c2h ?
+					DMA_FROM_DEVICE : DMA_TO_DEVICE);
+				cb->unmap_needed = 0;
+			}
+			req->fp_done(req, 0, -ENXIO);
+		} else
+			qdma_waitq_wakeup(&cb->wq);
+	}
+}
+
 static int descq_poll_mm_n_h2c_cmpl_status(struct qdma_descq *descq)
 {
 	enum qdma_drv_mode drv_mode = descq->xdev->conf.qdma_drv_mode;
@@ -100,6 +176,80 @@ static int descq_poll_mm_n_h2c_cmpl_status(struct qdma_descq *descq)
 		return 0;
 }
 
+/*
+ * pidx doorbell coalescing (MM and ST H2C): the descriptors are written to
+ * the ring right away but the pidx is only written once pidx_coal_desc of
+ * them are pending, the ring is full, or pidx_coal_us after the first one
+ * was deferred.
+ */
+static inline bool descq_pidx_coal(struct qdma_descq *descq)
+{
+#if KERNEL_VERSION(4, 16, 0) <= LINUX_VERSION_CODE
+	return descq->xdev->conf.pidx_coal_desc &&
+		descq->xdev->conf.pidx_coal_us;
+#else
+	/* needs a softirq hrtimer */
+	return false;
+#endif
+}
+
+int qdma_descq_pidx_flush(struct qdma_descq *descq)
+{
+	if (descq->pidx_info.pidx == descq->pidx)
+		return 0;
+
+	descq->pidx_info.pidx = descq->pidx;
+	return queue_pidx_update(descq->xdev, descq->conf.qidx,
+				descq->conf.c2h, &descq->pidx_info);
+}
+
+/* descq lock held, descq->pidx advanced past the new descriptors */
+static int descq_pidx_ring(struct qdma_descq *descq)
+{
+	unsigned int pend;
+
+	if (!descq_pidx_coal(descq))
+		return qdma_descq_pidx_flush(descq);
+
+	pend = ring_idx_delta(descq->pidx, descq->pidx_info.pidx,
+				descq->conf.rngsz);
+	if (pend >= descq->xdev->conf.pidx_coal_desc || !descq->avail) {
+		descq->pidx_coal_cnt++;
+		hrtimer_try_to_cancel(&descq->pidx_timer);
+		return qdma_descq_pidx_flush(descq);
+	}
+
+	descq->pidx_defer_cnt++;
+#if KERNEL_VERSION(4, 16, 0) <= LINUX_VERSION_CODE
+	if (!hrtimer_is_queued(&descq->pidx_timer))
+		hrtimer_start(&descq->pidx_timer,
+			ns_to_ktime(descq->xdev->conf.pidx_coal_us *
+					NSEC_PER_USEC),
+			HRTIMER_MODE_REL_SOFT);
+#endif
+
+	return 0;
+}
+
+static enum hrtimer_restart descq_pidx_timer(struct hrtimer *timer)
+{
+	struct qdma_descq *descq = container_of(timer, struct qdma_descq,
+						pidx_timer);
+	int rv = 0;
+
+	lock_descq(descq);
+	if (descq->q_state == Q_STATE_ONLINE)
+		rv = qdma_descq_pidx_flush(descq);
+	unlock_descq(descq);
+
+	if (rv < 0)
+		pr_err("%s: Failed to update pidx\n", descq->conf.name);
+	else if (descq->cmplthp)
+		qdma_kthread_wakeup(descq->cmplthp);
+
+	return HRTIMER_NORESTART;
+}
+
 static ssize_t descq_mm_proc_request(struct qdma_descq *descq)
 {
 	int rv = 0;
@@ -109,6 +259,7 @@ static ssize_t descq_mm_proc_request(struct qdma_descq *descq)
 	struct qdma_mm_desc *desc;
 
 	lock_descq(descq);
+	qdma_descq_submit_drain(descq);
 	/* process completion of submitted requests */
 	if (descq->q_stop_wait) {
 		descq_mm_n_h2c_cmpl_status(descq);
@@ -116,6 +267,8 @@ static ssize_t descq_mm_proc_request(struct qdma_descq *descq)
 		return 0;
 	}
 	if (unlikely(descq->q_state != Q_STATE_ONLINE)) {
+		/* submitted while the queue was being stopped */
+		qdma_descq_cancel_work(descq);
 		unlock_descq(descq);
 		return 0;
 	}
@@ -148,6 +301,9 @@ static ssize_t descq_mm_proc_request(struct qdma_descq *descq)
 
 		if (!desc_max) {
 			descq->pidx = pidx;
+			/* the hw has to see the deferred descriptors */
+			if (descq_pidx_coal(descq))
+				qdma_descq_pidx_flush(descq);
 			descq_poll_mm_n_h2c_cmpl_status(descq);
 			desc_max = descq->avail;
 		}
@@ -177,6 +333,7 @@ static ssize_t descq_mm_proc_request(struct qdma_descq *descq)
 			unsigned int tlen = sg->len;
 			dma_addr_t addr = sg->dma_addr;
 			unsigned int pg_off = sg->offset;
+			unsigned int merged;
 
 			pr_debug("desc %u/%u, sgl %d, len %u,%u, offset %u.\n",
 				desc_cnt, desc_max, i, len, tlen, sg_offset);
@@ -188,6 +345,12 @@ static ssize_t descq_mm_proc_request(struct qdma_descq *descq)
 				sg_offset = 0;
 			}
 
+			/* one descriptor for a dma contiguous run of entries */
+			merged = sgl_merge_contig(&sg, sg_max - i - 1, addr,
+						&tlen, QDMA_DESC_BLEN_MAX);
+			i += merged;
+			descq->sg_merge_cnt += merged;
+
 			while (tlen) {
 				unsigned int len = min_t(unsigned int, tlen,
 							QDMA_DESC_BLEN_MAX);
@@ -249,7 +412,6 @@ static ssize_t descq_mm_proc_request(struct qdma_descq *descq)
 			req->ep_addr, data_cnt, data_cnt);
 
 		descq->avail -= desc_cnt;
-		descq->pend_req_desc -= desc_cnt;
 		if (cb->offset == req->count)
 			req_submitted(descq, cb);
 		else
@@ -258,9 +420,8 @@ static ssize_t descq_mm_proc_request(struct qdma_descq *descq)
 
 	if (desc_written) {
 		descq->pend_list_empty = 0;
-		descq->pidx_info.pidx = pidx;
-		rv = queue_pidx_update(descq->xdev, descq->conf.qidx,
-				descq->conf.c2h, &descq->pidx_info);
+		descq->pidx = pidx;
+		rv = descq_pidx_ring(descq);
 		if (rv < 0) {
 			pr_err("%s: Failed to update pidx\n",
 					descq->conf.name);
@@ -268,8 +429,6 @@ static ssize_t descq_mm_proc_request(struct qdma_descq *descq)
 			return -EINVAL;
 		}
 
-		descq->pidx = pidx;
-
 		descq_poll_mm_n_h2c_cmpl_status(descq);
 	}
 
@@ -291,6 +450,7 @@ static ssize_t descq_proc_st_h2c_request(struct qdma_descq *descq)
 	unsigned int desc_written = 0;
 
 	lock_descq(descq);
+	qdma_descq_submit_drain(descq);
 	/* process completion of submitted requests */
 	if (descq->q_stop_wait) {
 		descq_mm_n_h2c_cmpl_status(descq);
@@ -298,6 +458,8 @@ static ssize_t descq_proc_st_h2c_request(struct qdma_descq *descq)
 		return 0;
 	}
 	if (unlikely(descq->q_state != Q_STATE_ONLINE)) {
+		/* submitted while the queue was being stopped */
+		qdma_descq_cancel_work(descq);
 		unlock_descq(descq);
 		return 0;
 	}
@@ -324,11 +486,14 @@ static ssize_t descq_proc_st_h2c_request(struct qdma_descq *descq)
 		unsigned int desc_cnt = 0;
 		unsigned int pktsz = req->ep_addr ?
 				min_t(unsigned int, req->ep_addr, PAGE_SIZE) :
-				PAGE_SIZE;
+				descq_st_h2c_desc_max(descq);
 		int i = 0;
 
 		if (!desc_max) {
 			descq->pidx = pidx;
+			/* the hw has to see the deferred descriptors */
+			if (descq_pidx_coal(descq))
+				qdma_descq_pidx_flush(descq);
 			descq_poll_mm_n_h2c_cmpl_status(descq);
 			desc_max = descq->avail;
 		}
@@ -364,6 +529,7 @@ static ssize_t descq_proc_st_h2c_request(struct qdma_descq *descq)
 		for (; i < sg_max && desc_cnt < desc_max; i++, sg++) {
 			unsigned int tlen = sg->len;
 			dma_addr_t addr = sg->dma_addr;
+			unsigned int merged;
 
 			if (sg_offset) {
 				tlen -= sg_offset;
@@ -371,6 +537,12 @@ static ssize_t descq_proc_st_h2c_request(struct qdma_descq *descq)
 				sg_offset = 0;
 			}
 
+			/* one descriptor for a dma contiguous run of entries */
+			merged = sgl_merge_contig(&sg, sg_max - i - 1, addr,
+						&tlen, pktsz);
+			i += merged;
+			descq->sg_merge_cnt += merged;
+
 			do { /* to support zero byte transfer */
 				unsigned int len = min_t(unsigned int, tlen,
 							 pktsz);
@@ -434,8 +606,6 @@ static ssize_t descq_proc_st_h2c_request(struct qdma_descq *descq)
 						desc++;
 					}
 						desc_cnt++;
-						/* below due to one CDH desc */
-						descq->pend_req_desc += 1;
 						desc->pld_len = 0;
 						desc->cdh_flags = 0;
 						desc->src_addr = addr;
@@ -472,7 +642,8 @@ static ssize_t descq_proc_st_h2c_request(struct qdma_descq *descq)
 				addr += len;
 				tlen -= len;
 
-				if ((i == sg_max - 1)) {
+				/* last descriptor of the last entry */
+				if ((i == sg_max - 1) && !tlen) {
 					desc->flags |= S_H2C_DESC_F_EOP;
 
 					if (descq->xdev->stm_en)
@@ -516,7 +687,6 @@ static ssize_t descq_proc_st_h2c_request(struct qdma_descq *descq)
 			data_cnt, data_cnt, cb->offset);
 
 		descq->avail -= desc_cnt;
-		descq->pend_req_desc -= desc_cnt;
 
 		if (cb->offset == req->count)
 			req_submitted(descq, cb);
@@ -526,16 +696,14 @@ static ssize_t descq_proc_st_h2c_request(struct qdma_descq *descq)
 
 	if (desc_written) {
 		descq->pend_list_empty = 0;
-		descq->pidx_info.pidx = pidx;
-		ret = queue_pidx_update(descq->xdev, descq->conf.qidx,
-				descq->conf.c2h, &descq->pidx_info);
+		descq->pidx = pidx;
+		ret = descq_pidx_ring(descq);
 		if (ret < 0) {
 			pr_err("%s: Failed to update pidx\n",
 					descq->conf.name);
 			unlock_descq(descq);
 			return -EINVAL;
 		}
-		descq->pidx = pidx;
 
 		descq_poll_mm_n_h2c_cmpl_status(descq);
 	}
@@ -571,23 +739,57 @@ static inline int get_desc_cmpl_status_size(struct qdma_descq *descq)
 	return (int)sizeof(struct qdma_desc_cmpl_status);
 }
 
+static void desc_ring_cache_free(struct xlnx_dma_dev *xdev,
+				struct qdma_ring_cache *cache)
+{
+	if (!cache->va)
+		return;
+
+	pr_debug("free cached %u(0x%x), 0x%p, bus 0x%llx.\n",
+		cache->len, cache->len, cache->va, cache->bus);
+
+	dma_free_coherent(&xdev->conf.pdev->dev, cache->len, cache->va,
+			cache->bus);
+	cache->va = NULL;
+	cache->bus = 0UL;
+	cache->len = 0;
+}
+
+/* the ring is kept in the cache for the next start of the queue */
 static inline void desc_ring_free(struct xlnx_dma_dev *xdev, int ring_sz,
-			int desc_sz, int cs_sz, u8 *desc, dma_addr_t desc_bus)
+			int desc_sz, int cs_sz, u8 *desc, dma_addr_t desc_bus,
+			struct qdma_ring_cache *cache)
 {
 	unsigned int len = ring_sz * desc_sz + cs_sz;
 
 	pr_debug("free %u(0x%x)=%d*%u+%d, 0x%p, bus 0x%llx.\n",
 		len, len, desc_sz, ring_sz, cs_sz, desc, desc_bus);
 
-	dma_free_coherent(&xdev->conf.pdev->dev, ring_sz * desc_sz + cs_sz,
-			desc, desc_bus);
+	desc_ring_cache_free(xdev, cache);
+	cache->va = desc;
+	cache->bus = desc_bus;
+	cache->len = len;
 }
 
 static void *desc_ring_alloc(struct xlnx_dma_dev *xdev, int ring_sz,
-			int desc_sz, int cs_sz, dma_addr_t *bus, u8 **cs_pp)
+			int desc_sz, int cs_sz, dma_addr_t *bus, u8 **cs_pp,
+			struct qdma_ring_cache *cache, u8 *reused)
 {
 	unsigned int len = ring_sz * desc_sz + cs_sz;
-	u8 *p = dma_alloc_coherent(&xdev->conf.pdev->dev, len, bus, GFP_KERNEL);
+	u8 *p;
+
+	if (cache->va && cache->len == len) {
+		p = cache->va;
+		*bus = cache->bus;
+		cache->va = NULL;
+		cache->bus = 0UL;
+		cache->len = 0;
+		(*reused)++;
+	} else {
+		desc_ring_cache_free(xdev, cache);
+		p = dma_alloc_coherent(&xdev->conf.pdev->dev, len, bus,
+					GFP_KERNEL);
+	}
 
 	if (!p) {
 		pr_info("%s, OOM, sz ring %d, desc %d, cmpl status sz %d.\n",
@@ -752,11 +954,24 @@ void qdma_descq_init(struct qdma_descq *descq, struct xlnx_dma_dev *xdev,
 
 	spin_lock_init(&descq->lock);
 	INIT_LIST_HEAD(&descq->work_list);
+	init_llist_head(&descq->submit_list);
 	INIT_LIST_HEAD(&descq->pend_list);
 	qdma_waitq_init(&descq->pend_list_wq);
+	qdma_waitq_init(&descq->c2h_ring_wq);
 	INIT_LIST_HEAD(&descq->intr_list);
 	INIT_LIST_HEAD(&descq->legacy_intr_q_list);
 	INIT_WORK(&descq->work, intr_work);
+#if KERNEL_VERSION(6, 13, 0) <= LINUX_VERSION_CODE
+	hrtimer_setup(&descq->pidx_timer, descq_pidx_timer, CLOCK_MONOTONIC,
+			HRTIMER_MODE_REL_SOFT);
+#elif KERNEL_VERSION(4, 16, 0) <= LINUX_VERSION_CODE
+	hrtimer_init(&descq->pidx_timer, CLOCK_MONOTONIC,
+			HRTIMER_MODE_REL_SOFT);
+	descq->pidx_timer.function = descq_pidx_timer;
+#else
+	hrtimer_init(&descq->pidx_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	descq->pidx_timer.function = descq_pidx_timer;
+#endif
 	descq->xdev = xdev;
 	descq->channel = 0;
 	descq->qidx_hw = qdev->qbase + idx_hw;
@@ -825,11 +1040,13 @@ int qdma_descq_alloc_resource(struct qdma_descq *descq)
 	u8 *desc_bypass;
 	u8 bypass_data[DESC_SZ_64B_BYTES];
 #endif
+	descq->rings_reused = 0;
 	/* descriptor ring */
 	descq->desc = desc_ring_alloc(xdev, descq->conf.rngsz,
 				get_desc_size(descq),
 				get_desc_cmpl_status_size(descq),
-				&descq->desc_bus, &descq->desc_cmpl_status);
+				&descq->desc_bus, &descq->desc_cmpl_status,
+				&descq->desc_cache, &descq->rings_reused);
 	if (!descq->desc) {
 		pr_info("dev %s, descq %s, sz %u, desc ring OOM.\n",
 			xdev->conf.name, descq->conf.name, descq->conf.rngsz);
@@ -869,7 +1086,9 @@ int qdma_descq_alloc_resource(struct qdma_descq *descq)
 					sizeof(struct
 					       qdma_c2h_cmpt_cmpl_status),
 					&descq->desc_cmpt_bus,
-					&descq->desc_cmpt_cmpl_status);
+					&descq->desc_cmpt_cmpl_status,
+					&descq->cmpt_cache,
+					&descq->rings_reused);
 		if (!descq->desc_cmpt) {
 			pr_warn("dev %s, descq %s, sz %u, cmpt ring OOM.\n",
 				xdev->conf.name, descq->conf.name,
@@ -926,7 +1145,8 @@ void qdma_descq_free_resource(struct qdma_descq *descq)
 			descq_flq_free_resource(descq);
 
 		desc_ring_free(descq->xdev, descq->conf.rngsz, desc_sz, cs_sz,
-				descq->desc, descq->desc_bus);
+				descq->desc, descq->desc_bus,
+				&descq->desc_cache);
 
 		descq->desc_cmpl_status = NULL;
 		descq->desc = NULL;
@@ -937,7 +1157,8 @@ void qdma_descq_free_resource(struct qdma_descq *descq)
 		desc_ring_free(descq->xdev, descq->conf.rngsz_cmpt,
 			descq->cmpt_entry_len,
 			sizeof(struct qdma_c2h_cmpt_cmpl_status),
-			descq->desc_cmpt, descq->desc_cmpt_bus);
+			descq->desc_cmpt, descq->desc_cmpt_bus,
+			&descq->cmpt_cache);
 
 		descq->desc_cmpt_cmpl_status = NULL;
 		descq->desc_cmpt = NULL;
@@ -945,6 +1166,12 @@ void qdma_descq_free_resource(struct qdma_descq *descq)
 	}
 }
 
+void qdma_descq_free_ring_cache(struct qdma_descq *descq)
+{
+	desc_ring_cache_free(descq->xdev, &descq->desc_cache);
+	desc_ring_cache_free(descq->xdev, &descq->cmpt_cache);
+}
+
 void qdma_descq_config(struct qdma_descq *descq, struct qdma_queue_conf *qconf,
 		 int reconfig)
 {
@@ -1000,6 +1227,9 @@ void qdma_descq_config(struct qdma_descq *descq, struct qdma_queue_conf *qconf,
 		descq->conf.pipe_tdest = qconf->pipe_tdest;
 		descq->conf.cmpl_ovf_chk_dis = qconf->cmpl_ovf_chk_dis;
 		descq->conf.en_mm_cmpt = qconf->en_mm_cmpt;
+		descq->conf.c2h_zerocopy = qconf->c2h_zerocopy;
+		descq->conf.adaptive_cmpl = qconf->adaptive_cmpl;
+		descq->conf.cmpl_poll = qconf->cmpl_poll;
 	}
 }
 
@@ -1043,6 +1273,29 @@ int qdma_descq_config_complete(struct qdma_descq *descq)
 		descq->cmpt_cidx_info.counter_idx = qconf->cmpl_cnt_th_idx;
 		descq->cmpt_cidx_info.wrb_en = qconf->cmpl_stat_en;
 	}
+
+	/* zero-copy is ST C2H only, each descriptor covers one c2h_bufsz
+	 * chunk of a single request page
+	 */
+	if (!qconf->st || !qconf->c2h)
+		qconf->c2h_zerocopy = 0;
+	if (qconf->c2h_zerocopy && (qconf->fp_descq_c2h_packet ||
+			!is_power_of_2(qconf->c2h_bufsz) ||
+			qconf->c2h_bufsz > PAGE_SIZE)) {
+		pr_info("%s: zero-copy NOT supported, bufsz %u.\n",
+			descq->conf.name, qconf->c2h_bufsz);
+		return -EINVAL;
+	}
+
+	/* adaptive moderation needs the interrupt driven ST C2H service */
+	if (!qconf->st || !qconf->c2h || !qconf->cmpl_en_intr)
+		qconf->adaptive_cmpl = 0;
+	if (qconf->adaptive_cmpl)
+		descq_st_c2h_cmpl_mod_init(descq);
+	/* the adaptive moderation does its own polling */
+	if (qconf->adaptive_cmpl)
+		qconf->cmpl_poll = 0;
+
 	if (qconf->st && qconf->c2h)
 		descq->pidx_info.irq_en = 0;
 	else
@@ -1053,14 +1306,23 @@ int qdma_descq_config_complete(struct qdma_descq *descq)
 	 * usable entries is ring_size - 1
 	 */
 	descq->avail = descq->conf.rngsz - 1;
+	/* zero-copy ST C2H: nothing is posted until a read is submitted */
+	if (qconf->c2h_zerocopy)
+		descq->avail = 0;
 	descq->pend_list_empty = 1;
 
 	descq->pidx = 0;
+	if (!(qconf->c2h && qconf->st))
+		descq->pidx_info.pidx = 0;
+	descq->pidx_coal_cnt = 0;
+	descq->pidx_defer_cnt = 0;
+	descq->cmpl_poll_hit = 0;
+	descq->sg_merge_cnt = 0;
+	descq->cmpl_poll_miss = 0;
 	descq->cidx = 0;
 	descq->cidx_cmpt = 0;
 	descq->pidx_cmpt = 0;
 	descq->credit = 0;
-	descq->pend_req_desc = 0;
 
 	descq->mm_cmpt_ring_crtd = is_mm_cmpl_required(descq);
 
@@ -1106,7 +1368,8 @@ int qdma_descq_prog_hw(struct qdma_descq *descq)
 				return -EINVAL;
 			}
 
-			descq->pidx_info.pidx = descq->conf.rngsz - 1;
+			descq->pidx_info.pidx = descq->conf.c2h_zerocopy ?
+						0 : descq->conf.rngsz - 1;
 			rv = queue_pidx_update(descq->xdev, descq->conf.qidx,
 					descq->conf.c2h, &descq->pidx_info);
 			if (rv < 0) {
@@ -1169,7 +1432,8 @@ int qdma_descq_prog_stm(struct qdma_descq *descq, bool clear)
 			return -EINVAL;
 		}
 
-		descq->pidx_info.pidx = descq->conf.rngsz - 1;
+		descq->pidx_info.pidx = descq->conf.c2h_zerocopy ?
+					0 : descq->conf.rngsz - 1;
 		rv = queue_pidx_update(descq->xdev, descq->conf.qidx,
 				descq->conf.c2h, &descq->pidx_info);
 		if (rv < 0) {
@@ -1182,6 +1446,33 @@ int qdma_descq_prog_stm(struct qdma_descq *descq, bool clear)
 }
 #endif
 
+bool qdma_descq_cmpl_pending(struct qdma_descq *descq)
+{
+	unsigned int cidx_hw;
+
+	if (descq->conf.st && descq->conf.c2h) {
+		struct qdma_c2h_cmpt_cmpl_status *cs =
+				(struct qdma_c2h_cmpt_cmpl_status *)
+				descq->desc_cmpt_cmpl_status;
+
+#ifdef __READ_ONCE_DEFINED__
+		cidx_hw = READ_ONCE(cs->pidx);
+#else
+		cidx_hw = cs->pidx;
+#endif
+		return cidx_hw != descq->cidx_cmpt;
+	}
+
+#ifdef __READ_ONCE_DEFINED__
+	cidx_hw = READ_ONCE(((struct qdma_desc_cmpl_status *)
+				descq->desc_cmpl_status)->cidx);
+#else
+	cidx_hw = ((struct qdma_desc_cmpl_status *)
+				descq->desc_cmpl_status)->cidx;
+#endif
+	return cidx_hw != descq->cidx;
+}
+
 void qdma_descq_service_cmpl_update(struct qdma_descq *descq, int budget,
 				bool c2h_upd_cmpl)
 {
@@ -1198,7 +1489,8 @@ void qdma_descq_service_cmpl_update(struct qdma_descq *descq, int budget,
 	} else {
 		lock_descq(descq);
 		descq_mm_n_h2c_cmpl_status(descq);
-		if (descq->pend_req_desc) {
+		/* requests waiting for ring space */
+		if (!list_empty(&descq->work_list)) {
 			unlock_descq(descq);
 			qdma_descq_proc_sgt_request(descq);
 			return;
@@ -1328,7 +1620,7 @@ int qdma_descq_dump_desc(struct qdma_descq *descq, int start,
 	// TODO: is this even safe.... probably not
 	buf[len++] = '\n';
 
-	if (descq->conf.st && descq->conf.c2h) {
+	if (descq->conf.st && descq->conf.c2h && fl->pg) {
 		p = page_address(fl->pg);
 		len += sprintf(buf + len, "data 0: 0x%p ", p);
 		hex_dump_to_buffer(p, descq->cmpt_entry_len,
@@ -1489,9 +1781,52 @@ int qdma_descq_dump(struct qdma_descq *descq, char *buf, int buflen, int detail)
 
 	if (descq->conf.st && descq->conf.c2h) {
 		cur += snprintf(cur, end - cur,
-			"\tcmpt desc 0x%p/0x%llx, %u\n",
+			"\tcmpt desc 0x%p/0x%llx, %u%s\n",
 			descq->desc_cmpt, descq->desc_cmpt_bus,
-			descq->conf.rngsz_cmpt);
+			descq->conf.rngsz_cmpt,
+			descq->conf.c2h_zerocopy ? ", zero-copy" : "");
+		if (cur >= end)
+			goto handle_truncation;
+	}
+
+	if (descq->conf.adaptive_cmpl) {
+		struct qdma_cmpl_mod *mod = &descq->cmpl_mod;
+
+		cur += snprintf(cur, end - cur,
+			"\tadaptive cmpl lvl %u, trig %u, tmr %u, cntr %u%s, polls %lu, changes %lu\n",
+			mod->level, descq->cmpt_cidx_info.trig_mode,
+			descq->cmpt_cidx_info.timer_idx,
+			descq->cmpt_cidx_info.counter_idx,
+			mod->polling ? ", polling" : "", mod->poll_cnt,
+			mod->level_chg);
+		if (cur >= end)
+			goto handle_truncation;
+	}
+
+	if (descq_pidx_coal(descq) && !(descq->conf.st && descq->conf.c2h)) {
+		cur += snprintf(cur, end - cur,
+			"\tpidx coalescing %u desc/%u us, full %lu, deferred %lu\n",
+			descq->xdev->conf.pidx_coal_desc,
+			descq->xdev->conf.pidx_coal_us, descq->pidx_coal_cnt,
+			descq->pidx_defer_cnt);
+		if (cur >= end)
+			goto handle_truncation;
+	}
+
+	if (descq->sg_merge_cnt) {
+		cur += snprintf(cur, end - cur,
+			"\tsg entries merged into contiguous descriptors %lu\n",
+			descq->sg_merge_cnt);
+		if (cur >= end)
+			goto handle_truncation;
+	}
+
+	if (descq->conf.cmpl_poll || descq->cmpl_poll_hit ||
+			descq->cmpl_poll_miss) {
+		cur += snprintf(cur, end - cur,
+			"\tpolled cmpl %u us, hit %lu, miss %lu\n",
+			descq->xdev->conf.cmpl_poll_us, descq->cmpl_poll_hit,
+			descq->cmpl_poll_miss);
 		if (cur >= end)
 			goto handle_truncation;
 	}
@@ -1637,19 +1972,16 @@ int qdma_queue_packet_write(unsigned long dev_hndl, unsigned long id,
 		cb->unmap_needed = 1;
 	}
 
-	lock_descq(descq);
+	/* lockless check, re-checked under the lock when processed */
 	if (descq->q_state != Q_STATE_ONLINE) {
-		unlock_descq(descq);
 		pr_info("%s descq %s NOT online.\n",
 			descq->xdev->conf.name, descq->conf.name);
 		rv = -EINVAL;
 		goto unmap_sgl;
 	}
 
-	list_add_tail(&cb->list, &descq->work_list);
-	descq->pend_req_desc += ((req->count + PAGE_SIZE - 1) >> PAGE_SHIFT);
-	unlock_descq(descq);
-	qdma_descq_proc_sgt_request(descq);
+	if (qdma_descq_submit(descq, cb))
+		qdma_descq_proc_sgt_request(descq);
 
 	pr_debug("%s: cb 0x%p submitted.\n", descq->conf.name, cb);
 
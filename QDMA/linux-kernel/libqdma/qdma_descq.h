@@ -26,6 +26,8 @@
  */
 #include <linux/spinlock_types.h>
 #include <linux/types.h>
+#include <linux/hrtimer.h>
+#include <linux/llist.h>
 #include "qdma_compat.h"
 #include "libqdma_export.h"
 #include "qdma_regs.h"
@@ -51,7 +53,41 @@ enum qdma_req_state {
 	QDMA_REQ_COMPLETE
 };
 
-#define QDMA_FLQ_SIZE 80
+#define QDMA_FLQ_SIZE 104
+
+/**
+ * @struct - qdma_cmpl_mod
+ * @brief ST C2H adaptive completion moderation state, see
+ *	qdma_queue_conf.adaptive_cmpl
+ */
+struct qdma_cmpl_mod {
+	/** moderation level, 0: trigger on every completion */
+	u8 level;
+	/** budget exhausted: interrupt not re-armed, the queue is polled */
+	u8 polling;
+	/** # of services in the current sample window */
+	unsigned int svc_cnt;
+	/** # of completion entries in the current sample window */
+	unsigned int cmpl_cnt;
+	/** # of times the queue was re-polled */
+	unsigned long poll_cnt;
+	/** # of moderation level changes */
+	unsigned long level_chg;
+};
+
+/**
+ * @struct - qdma_ring_cache
+ * @brief dma ring kept from the previous start of the queue, reused if the
+ *	next start needs the same size, freed on queue removal
+ */
+struct qdma_ring_cache {
+	/** ring virtual address, NULL if none */
+	u8 *va;
+	/** ring dma address */
+	dma_addr_t bus;
+	/** ring length in bytes, including the status entry */
+	unsigned int len;
+};
 
 /**
  * @struct - qdma_descq
@@ -90,24 +126,38 @@ struct qdma_descq {
 	struct list_head legacy_intr_q_list;
 	/** interrupt id associated for this queue */
 	int intr_id;
+	/** queue collected by the current interrupt ring pass */
+	u8 intr_coal_seen;
 	/** work  list for the queue */
 	struct list_head work_list;
+	/** MM and ST H2C: lock-free submission list, moved to work_list in
+	 *  batches by the request processing, see qdma_descq_submit()
+	 */
+	struct llist_head submit_list;
 	/** write back therad list */
 	struct qdma_kthread *cmplthp;
-	/** completion status thread list for the queue */
+	/** completion status thread list for the queue, or the queue list
+	 *  of intr_work_cpu in interrupt mode
+	 */
 	struct list_head cmplthp_list;
+	/** completion service time in ns, for the queue rebalancing */
+	u64 svc_ns;
+	/** svc_ns at the last rebalancing pass */
+	u64 svc_ns_last;
+	/** service time in ns over the last rebalancing interval */
+	u64 svc_load;
 	/** pending qork thread list */
 	struct list_head pend_list;
 	/** wait queue for pending list clear */
 	qdma_wait_queue pend_list_wq;
+	/** ST C2H mmap'ed ring: wait queue for received packets */
+	qdma_wait_queue c2h_ring_wq;
 	/** pending list empty count */
 	unsigned int pend_list_empty;
 	/* flag to indicate wwaiting for transfers to complete before q stop*/
 	unsigned int q_stop_wait;
 	/** availed count */
 	unsigned int avail;
-	/** current req count */
-	unsigned int pend_req_desc;
 	/** current producer index */
 	unsigned int pidx;
 	/** current consumer index */
@@ -154,10 +204,32 @@ struct qdma_descq {
 	dma_addr_t desc_cmpt_bus;
 	/** descriptor writeback dma bus address*/
 	u8 *desc_cmpt_cmpl_status;
+	/** descriptor ring of the previous start */
+	struct qdma_ring_cache desc_cache;
+	/** completion ring of the previous start */
+	struct qdma_ring_cache cmpt_cache;
+	/** # of rings reused by the last qdma_descq_alloc_resource() */
+	u8 rings_reused;
 	/** pidx info to be written to PIDX regiser*/
 	struct qdma_q_pidx_reg_info pidx_info;
+	/** deferred pidx doorbell, MM and ST H2C, see conf.pidx_coal_us */
+	struct hrtimer pidx_timer;
+	/** # of pidx writes on reaching conf.pidx_coal_desc */
+	unsigned long pidx_coal_cnt;
+	/** # of deferred pidx writes */
+	unsigned long pidx_defer_cnt;
+	/** # of blocking requests completed while polling */
+	unsigned long cmpl_poll_hit;
+	/** # of blocking requests still pending after the poll budget */
+	unsigned long cmpl_poll_miss;
+	/** MM and ST H2C: # of sg entries merged into the descriptor of
+	 *  the previous, dma contiguous, entry
+	 */
+	unsigned long sg_merge_cnt;
 	/** cmpt cidx info to be written to CMPT CIDX regiser*/
 	struct qdma_q_cmpt_cidx_reg_info cmpt_cidx_info;
+	/** adaptive completion moderation */
+	struct qdma_cmpl_mod cmpl_mod;
 
 #ifdef ERR_DEBUG
 	/** flag to indicate error inducing */
@@ -270,6 +342,17 @@ int qdma_descq_alloc_resource(struct qdma_descq *descq);
  *****************************************************************************/
 void qdma_descq_free_resource(struct qdma_descq *descq);
 
+/*****************************************************************************/
+/**
+ * qdma_descq_free_ring_cache() - free the rings qdma_descq_free_resource()
+ *	kept for the next start of the queue
+ *
+ * @param[in]	descq:		pointer to qdma_descq
+ *
+ * @return	none
+ *****************************************************************************/
+void qdma_descq_free_ring_cache(struct qdma_descq *descq);
+
 /*****************************************************************************/
 /**
  * qdma_descq_prog_hw() - program the hw descriptors
@@ -295,6 +378,18 @@ int qdma_descq_prog_hw(struct qdma_descq *descq);
 int qdma_descq_prog_stm(struct qdma_descq *descq, bool clear);
 #endif
 
+/*****************************************************************************/
+/**
+ * qdma_descq_pidx_flush() - write the pidx doorbell deferred by the pidx
+ *	coalescing, called with the descq lock held
+ *
+ * @param[in]	descq:		pointer to qdma_descq
+ *
+ * @return	0: success
+ * @return	<0: failure
+ *****************************************************************************/
+int qdma_descq_pidx_flush(struct qdma_descq *descq);
+
 /*****************************************************************************/
 /**
  * qdma_descq_context_cleanup() - clean up the queue context
@@ -306,6 +401,17 @@ int qdma_descq_prog_stm(struct qdma_descq *descq, bool clear);
  *****************************************************************************/
 int qdma_descq_context_cleanup(struct qdma_descq *descq);
 
+/*****************************************************************************/
+/**
+ * qdma_descq_cmpl_pending() - check, without the descq lock, whether the
+ *	completion status written back by the hw shows unprocessed entries
+ *
+ * @param[in]	descq:		pointer to qdma_descq
+ *
+ * @return	true if qdma_descq_service_cmpl_update() has work to do
+ *****************************************************************************/
+bool qdma_descq_cmpl_pending(struct qdma_descq *descq);
+
 /*****************************************************************************/
 /**
  * qdma_descq_service_cmpl_update() - process completion data for the request
@@ -389,8 +495,12 @@ void incr_cmpl_desc_cnt(struct qdma_descq *descq, unsigned int cnt);
  * @brief	qdma_sgt_req_cb fits in qdma_request.opaque
  */
 struct qdma_sgt_req_cb {
-	/** qdma read/write request list*/
-	struct list_head list;
+	union {
+		/** qdma read/write request list*/
+		struct list_head list;
+		/** descq submit_list entry, until moved to the work_list */
+		struct llist_node llnode;
+	};
 	/** request wait queue */
 	qdma_wait_queue wq;
 	/** number of descriptors to proccess*/
@@ -416,6 +526,46 @@ struct qdma_sgt_req_cb {
 /** macro to get the request call back data */
 #define qdma_req_cb_get(req)	(struct qdma_sgt_req_cb *)((req)->opaque)
 
+/*****************************************************************************/
+/**
+ * qdma_descq_submit() - queue a MM or ST H2C request without taking the
+ *	descq lock
+ *
+ * @param[in]	descq:		pointer to qdma_descq
+ * @param[in]	cb:		request call back data
+ *
+ * @return	true: the submit list was empty, the caller has to run
+ *		qdma_descq_proc_sgt_request(), otherwise the caller that
+ *		found it empty will pick this request up too
+ *****************************************************************************/
+static inline bool qdma_descq_submit(struct qdma_descq *descq,
+				struct qdma_sgt_req_cb *cb)
+{
+	return llist_add(&cb->llnode, &descq->submit_list);
+}
+
+/*****************************************************************************/
+/**
+ * qdma_descq_submit_drain() - move the submitted requests to the work_list,
+ *	called with the descq lock held
+ *
+ * @param[in]	descq:		pointer to qdma_descq
+ *
+ * @return	none
+ *****************************************************************************/
+void qdma_descq_submit_drain(struct qdma_descq *descq);
+
+/*****************************************************************************/
+/**
+ * qdma_descq_cancel_work() - fail all the requests not yet submitted to the
+ *	hardware with -ENXIO, called with the descq lock held
+ *
+ * @param[in]	descq:		pointer to qdma_descq
+ *
+ * @return	none
+ *****************************************************************************/
+void qdma_descq_cancel_work(struct qdma_descq *descq);
+
 /*****************************************************************************/
 /**
  * qdma_descq_proc_sgt_request() - handler to process the qdma
@@ -22,9 +22,13 @@
 #include "qdma_intr.h"
 
 #include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/interrupt.h>
+#include <linux/cpumask.h>
 #include "qdma_descq.h"
 #include "qdma_device.h"
 #include "qdma_regs.h"
+#include "qdma_st_c2h.h"
 #include "thread.h"
 #include "version.h"
 #include "qdma_mbox_protocol.h"
@@ -141,27 +145,131 @@ static irqreturn_t error_intr_handler(int irq_index, int irq, void *dev_id)
 }
 #endif
 
+/* max. # of interrupt ring entries consumed per pass */
+#define QDMA_INTR_COAL_BUDGET	64
+
+static void intr_coal_descq_service(struct qdma_descq *descq)
+{
+	if (descq->conf.fp_descq_isr_top) {
+		descq->conf.fp_descq_isr_top(descq->q_hndl, descq->conf.quld);
+	} else {
+		if (descq->cpu_assigned)
+			schedule_work_on(descq->intr_work_cpu, &descq->work);
+		else
+			schedule_work(&descq->work);
+	}
+}
+
+/*
+ * one pass over the interrupt ring of a vector, with coal_entry->lock held:
+ * up to QDMA_INTR_COAL_BUDGET entries are consumed and the distinct queues
+ * they name collected, the CIDX is written once, then each queue is
+ * serviced once, however many entries it had in the pass.
+ * return true if the budget ran out with entries left in the ring.
+ */
+static bool intr_coal_ring_pass(struct intr_coal_conf *coal_entry, int irq)
+{
+	struct xlnx_dma_dev *xdev = coal_entry->xdev;
+	struct qdma_intr_cidx_reg_info *intr_cidx_info =
+			&coal_entry->intr_cidx_info;
+	struct qdma_descq *descqs[QDMA_INTR_COAL_BUDGET];
+	struct qdma_intr_ring *ring_entry;
+	struct qdma_descq *descq;
+	unsigned int qidx = 0;
+	unsigned int nr = 0;
+	unsigned int budget = QDMA_INTR_COAL_BUDGET;
+	unsigned int i;
+
+	ring_entry = coal_entry->intr_ring_base + intr_cidx_info->sw_cidx;
+	while (budget && ring_entry->coal_color == coal_entry->color) {
+		pr_debug("IRQ[%d]: vec %u, Qid = %d, e_color = %d, c_color = %d, intr_type = %d\n",
+				irq, coal_entry->vec_id, ring_entry->qid,
+				coal_entry->color, ring_entry->coal_color,
+				ring_entry->intr_type);
+
+		descq = qdma_device_get_descq_by_hw_qid(xdev, ring_entry->qid,
+				ring_entry->intr_type);
+		if (!descq) {
+			pr_err("IRQ[%d]: vec %u, Qid = %d: desc not found\n",
+					irq, coal_entry->vec_id,
+					ring_entry->qid);
+		} else {
+			qidx = descq->conf.qidx;
+			if (descq->intr_coal_seen) {
+				coal_entry->dup_cnt++;
+			} else {
+				descq->intr_coal_seen = 1;
+				descqs[nr++] = descq;
+			}
+		}
+
+		if (++intr_cidx_info->sw_cidx ==
+				coal_entry->intr_rng_num_entries) {
+			coal_entry->color = coal_entry->color ? 0 : 1;
+			intr_cidx_info->sw_cidx = 0;
+		}
+		ring_entry = coal_entry->intr_ring_base +
+				intr_cidx_info->sw_cidx;
+		budget--;
+	}
+
+	if (budget == QDMA_INTR_COAL_BUDGET)
+		return false;
+
+	coal_entry->pass_cnt++;
+	coal_entry->entry_cnt += QDMA_INTR_COAL_BUDGET - budget;
+	/*
+	 * the ring index is part of intr_cidx_info, any queue register of the
+	 * function updates it: the last queue found, or queue 0 if none of
+	 * the consumed entries named a known queue
+	 */
+	queue_intr_cidx_update(xdev, qidx, intr_cidx_info);
+
+	for (i = 0; i < nr; i++) {
+		descqs[i]->intr_coal_seen = 0;
+		intr_coal_descq_service(descqs[i]);
+	}
+
+	if (budget || ring_entry->coal_color != coal_entry->color)
+		return false;
+	coal_entry->budget_cnt++;
+	return true;
+}
+
+/* the rest of the ring, left by a pass out of budget */
+static void intr_coal_work(struct work_struct *work)
+{
+	struct intr_coal_conf *coal_entry = container_of(work,
+					struct intr_coal_conf, work);
+	unsigned long flags;
+	bool more;
+
+	spin_lock_irqsave(&coal_entry->lock, flags);
+	more = !coal_entry->shutdown && intr_coal_ring_pass(coal_entry, -1);
+	spin_unlock_irqrestore(&coal_entry->lock, flags);
+
+	/* requeued behind the queue services it just scheduled */
+	if (more)
+		schedule_work(&coal_entry->work);
+}
+
 static void data_intr_aggregate(struct xlnx_dma_dev *xdev, int vidx, int irq)
 {
-	struct qdma_descq *descq = NULL;
-	u32 counter = 0;
 	struct intr_coal_conf *coal_entry =
 			(xdev->intr_coal_list + vidx - xdev->dvec_start_idx);
-	struct qdma_intr_ring *ring_entry;
-	struct qdma_intr_cidx_reg_info *intr_cidx_info;
+	bool more;
 
 	if (!coal_entry) {
 		pr_err("Failed to locate the coalescing entry for vector = %d\n",
 			vidx);
 		return;
 	}
-	intr_cidx_info = &coal_entry->intr_cidx_info;
 	pr_debug("INTR_COAL: msix[%d].vector=%d, msix[%d].entry=%d, rngsize=%d, cidx = %d\n",
 		vidx, xdev->msix[vidx].vector,
 		vidx,
 		xdev->msix[vidx].entry,
 		coal_entry->intr_rng_num_entries,
-		intr_cidx_info->sw_cidx);
+		coal_entry->intr_cidx_info.sw_cidx);
 
 	pr_debug("vidx = %d, dvec_start_idx = %d\n", vidx,
 		 xdev->dvec_start_idx);
@@ -174,53 +282,13 @@ static void data_intr_aggregate(struct xlnx_dma_dev *xdev, int vidx, int irq)
 		return;
 	}
 
-	counter = intr_cidx_info->sw_cidx;
-	ring_entry = (coal_entry->intr_ring_base + counter);
-	if (!ring_entry) {
-		pr_err("Failed to locate the ring entry for vector = %d\n",
-			vidx);
-		return;
-	}
-	while (ring_entry->coal_color == coal_entry->color) {
-		pr_debug("IRQ[%d]: IVE[%d], Qid = %d, e_color = %d, c_color = %d, intr_type = %d\n",
-				irq, vidx, ring_entry->qid, coal_entry->color,
-				ring_entry->coal_color, ring_entry->intr_type);
+	/* one pass in the hard irq, the work takes over a longer ring */
+	spin_lock(&coal_entry->lock);
+	more = !coal_entry->shutdown && intr_coal_ring_pass(coal_entry, irq);
+	spin_unlock(&coal_entry->lock);
 
-		descq = qdma_device_get_descq_by_hw_qid(xdev, ring_entry->qid,
-				ring_entry->intr_type);
-		if (!descq) {
-			pr_err("IRQ[%d]: IVE[%d], Qid = %d: desc not found\n",
-					irq, vidx, ring_entry->qid);
-			return;
-		}
-
-		if (descq->conf.fp_descq_isr_top) {
-			descq->conf.fp_descq_isr_top(descq->q_hndl,
-					descq->conf.quld);
-		} else {
-			if (descq->cpu_assigned)
-				schedule_work_on(descq->intr_work_cpu,
-						&descq->work);
-			else
-				schedule_work(&descq->work);
-		}
-
-		if (++intr_cidx_info->sw_cidx ==
-				coal_entry->intr_rng_num_entries) {
-			counter = 0;
-			xdev->intr_coal_list->color =
-				(xdev->intr_coal_list->color) ? 0 : 1;
-			intr_cidx_info->sw_cidx = 0;
-		} else
-			counter++;
-
-		ring_entry = (coal_entry->intr_ring_base + counter);
-	}
-
-	if (descq) {
-		queue_intr_cidx_update(descq->xdev,
-				descq->conf.qidx, &coal_entry->intr_cidx_info);
-	}
+	if (more)
+		schedule_work(&coal_entry->work);
 }
 
 static void data_intr_direct(struct xlnx_dma_dev *xdev, int vidx, int irq)
@@ -375,7 +443,31 @@ static void intr_context_invalidate(struct xlnx_dma_dev *xdev)
 
 void intr_ring_teardown(struct xlnx_dma_dev *xdev)
 {
+	struct intr_coal_conf *coal_entry;
+	unsigned long flags;
+	int i;
+
+	/*
+	 * the data vectors may still be live: stop the ring walks first so
+	 * neither the handler nor the work can queue the work again once
+	 * it is cancelled
+	 */
+	for (i = 0; i < QDMA_NUM_DATA_VEC_FOR_INTR_CXT; i++) {
+		coal_entry = xdev->intr_coal_list + i;
+		spin_lock_irqsave(&coal_entry->lock, flags);
+		coal_entry->shutdown = true;
+		spin_unlock_irqrestore(&coal_entry->lock, flags);
+		cancel_work_sync(&coal_entry->work);
+	}
+
 	intr_context_invalidate(xdev);
+
+	/* a handler still running may hold a coalescing entry */
+	if (xdev->num_vecs)
+		for (i = 0; i < QDMA_NUM_DATA_VEC_FOR_INTR_CXT; i++)
+			synchronize_irq(
+				xdev->msix[i + xdev->dvec_start_idx].vector);
+
 	kfree(xdev->intr_coal_list);
 }
 
@@ -414,12 +506,31 @@ static irqreturn_t irq_top(int irq, void *dev_id)
 }
 
 
+/* spread the vectors over the cpus of the device node */
+static void intr_vector_affinity_set(struct xlnx_dma_dev *xdev, int idx)
+{
+#if KERNEL_VERSION(4, 1, 0) <= LINUX_VERSION_CODE
+	int node = dev_to_node(&xdev->conf.pdev->dev);
+
+	irq_set_affinity_hint(xdev->msix[idx].vector,
+			cpumask_of(cpumask_local_spread(idx, node)));
+#endif
+}
+
+static void intr_vector_free(struct xlnx_dma_dev *xdev, int idx)
+{
+#if KERNEL_VERSION(4, 1, 0) <= LINUX_VERSION_CODE
+	irq_set_affinity_hint(xdev->msix[idx].vector, NULL);
+#endif
+	free_irq(xdev->msix[idx].vector, xdev);
+}
+
 void intr_teardown(struct xlnx_dma_dev *xdev)
 {
 	int i = xdev->num_vecs;
 
 	while (--i >= 0)
-		free_irq(xdev->msix[i].vector, xdev);
+		intr_vector_free(xdev, i);
 
 	if (xdev->num_vecs)
 		pci_disable_msix(xdev->conf.pdev);
@@ -480,6 +591,8 @@ static int intr_vector_setup(struct xlnx_dma_dev *xdev, int idx,
 		return rv;
 	}
 
+	intr_vector_affinity_set(xdev, idx);
+
 	return 0;
 }
 #ifdef __PCI_MSI_VEC_COUNT__
@@ -516,8 +629,8 @@ int intr_setup(struct xlnx_dma_dev *xdev)
 		return 0;
 	}
 
-	xdev->msix = kzalloc((sizeof(struct msix_entry) * xdev->num_vecs),
-						GFP_KERNEL);
+	xdev->msix = kzalloc_node((sizeof(struct msix_entry) * xdev->num_vecs),
+				  GFP_KERNEL, dev_to_node(&xdev->conf.pdev->dev));
 	if (!xdev->msix) {
 		pr_err("dev %s xdev->msix OOM.\n",
 			dev_name(&xdev->conf.pdev->dev));
@@ -526,8 +639,9 @@ int intr_setup(struct xlnx_dma_dev *xdev)
 	}
 
 	xdev->dev_intr_info_list =
-			kzalloc((sizeof(struct intr_info_t) * xdev->num_vecs),
-					GFP_KERNEL);
+			kzalloc_node((sizeof(struct intr_info_t) * xdev->num_vecs),
+				     GFP_KERNEL,
+				     dev_to_node(&xdev->conf.pdev->dev));
 	if (!xdev->dev_intr_info_list) {
 		pr_err("dev %s xdev->dev_intr_info_list OOM.\n",
 			dev_name(&xdev->conf.pdev->dev));
@@ -598,7 +712,7 @@ int intr_setup(struct xlnx_dma_dev *xdev)
 
 cleanup_irq:
 	while (--i >= 0)
-		free_irq(xdev->msix[i].vector, xdev);
+		intr_vector_free(xdev, i);
 
 	pci_disable_msix(xdev->conf.pdev);
 	xdev->num_vecs = 0;
@@ -781,6 +895,9 @@ int intr_ring_setup(struct xlnx_dma_dev *xdev)
 			xdev->msix[counter + xdev->dvec_start_idx].entry;
 			intr_coal_list_entry->intr_cidx_info.sw_cidx = 0;
 			intr_coal_list_entry->color = 1;
+			intr_coal_list_entry->xdev = xdev;
+			spin_lock_init(&intr_coal_list_entry->lock);
+			INIT_WORK(&intr_coal_list_entry->work, intr_coal_work);
 			intr_coal_list_entry->intr_cidx_info.rng_idx =
 					get_intr_ring_index(xdev,
 					    intr_coal_list_entry->vec_id);
@@ -821,9 +938,15 @@ err_out:
 void intr_work(struct work_struct *work)
 {
 	struct qdma_descq *descq;
+	ktime_t t0 = ktime_get();
 
 	descq = container_of(work, struct qdma_descq, work);
-	qdma_descq_service_cmpl_update(descq, 0, 1);
+	if (descq->conf.adaptive_cmpl)
+		descq_st_c2h_adaptive_service(descq);
+	else
+		qdma_descq_service_cmpl_update(descq, 0, 1);
+	/* the workqueue does not run the same work concurrently */
+	descq->svc_ns += ktime_to_ns(ktime_sub(ktime_get(), t0));
 }
 
 /**
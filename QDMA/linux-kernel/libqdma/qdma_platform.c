@@ -24,6 +24,11 @@
  */
 static DEFINE_MUTEX(res_mutex);
 
+/**
+ * spinlock used for the statistics shared by all the devices
+ */
+static DEFINE_SPINLOCK(stats_lock);
+
 void *qdma_calloc(uint32_t num_blocks, uint32_t size)
 {
 	return kzalloc(num_blocks * size, GFP_KERNEL);
@@ -81,6 +86,16 @@ void qdma_resource_lock_give(void)
 	mutex_unlock(&res_mutex);
 }
 
+void qdma_stats_lock_take(void)
+{
+	spin_lock(&stats_lock);
+}
+
+void qdma_stats_lock_give(void)
+{
+	spin_unlock(&stats_lock);
+}
+
 void qdma_hw_error_handler(void *dev_hndl, enum qdma_error_idx err_idx)
 {
 	pr_err("%s detected", qdma_get_error_name(err_idx));
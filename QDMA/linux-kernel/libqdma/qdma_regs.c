@@ -529,6 +529,9 @@ int qdma_queue_cmpl_ctrl(unsigned long dev_hndl, unsigned long id,
 	if (set) {
 		lock_descq(descq);
 
+		/* explicit settings take over from the adaptive moderation */
+		descq->conf.adaptive_cmpl = 0;
+		descq->cmpl_mod.polling = 0;
 		descq->cmpt_cidx_info.trig_mode =
 				descq->conf.cmpl_trig_mode =
 						cctrl->trigger_mode;
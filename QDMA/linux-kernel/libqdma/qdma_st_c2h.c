@@ -23,6 +23,7 @@
 
 #include <linux/kernel.h>
 #include <linux/delay.h>
+#include <linux/mm.h>
 
 #include "qdma_device.h"
 #include "qdma_intr.h"
@@ -40,6 +41,12 @@
  * ST C2H descq (i.e., freelist) RX buffers
  */
 
+static inline unsigned int descq_st_c2h_ring_bytes(struct qdma_flq *flq)
+{
+	return sizeof(struct qdma_c2h_ring_ctrl) +
+		flq->size * sizeof(struct qdma_c2h_ring_entry);
+}
+
 static inline void flq_unmap_one(struct qdma_sw_sg *sdesc,
 				struct qdma_c2h_desc *desc, struct device *dev,
 				unsigned char pg_order)
@@ -63,9 +70,8 @@ static inline void flq_free_one(struct qdma_sw_sg *sdesc,
 	}
 }
 
-static inline int flq_fill_one(struct qdma_sw_sg *sdesc,
-				struct qdma_c2h_desc *desc, struct device *dev,
-				int node, unsigned int buf_sz,
+static inline int flq_map_page(struct qdma_flq_pool_ent *ent,
+				struct device *dev, int node,
 				unsigned char pg_order, gfp_t gfp)
 {
 	struct page *pg;
@@ -86,8 +92,25 @@ static inline int flq_fill_one(struct qdma_sw_sg *sdesc,
 		return -EINVAL;
 	}
 
-	sdesc->pg = pg;
-	sdesc->dma_addr = mapping;
+	ent->pg = pg;
+	ent->dma_addr = mapping;
+	return 0;
+}
+
+static inline int flq_fill_one(struct qdma_sw_sg *sdesc,
+				struct qdma_c2h_desc *desc, struct device *dev,
+				int node, unsigned int buf_sz,
+				unsigned char pg_order, gfp_t gfp)
+{
+	struct qdma_flq_pool_ent ent;
+	int rv;
+
+	rv = flq_map_page(&ent, dev, node, pg_order, gfp);
+	if (unlikely(rv < 0))
+		return rv;
+
+	sdesc->pg = ent.pg;
+	sdesc->dma_addr = ent.dma_addr;
 	sdesc->len = buf_sz << pg_order;
 	sdesc->offset = 0;
 
@@ -95,6 +118,200 @@ static inline int flq_fill_one(struct qdma_sw_sg *sdesc,
 	return 0;
 }
 
+/*
+ * free list page pool: used when the packets are handed to the
+ * fp_descq_c2h_packet() handler, which may keep a page by get_page()
+ */
+
+/* # of pages allocated and mapped at a time when the pool runs dry */
+#define QDMA_FLQ_POOL_BULK	32
+
+static inline void flq_pool_release_one(struct qdma_flq_pool_ent *ent,
+				struct device *dev, unsigned char pg_order)
+{
+	dma_unmap_page(dev, ent->dma_addr, PAGE_SIZE << pg_order,
+			DMA_FROM_DEVICE);
+	put_page(ent->pg);
+	ent->pg = NULL;
+}
+
+static int flq_pool_alloc_bulk(struct qdma_flq *flq, struct device *dev,
+				int node, gfp_t gfp)
+{
+	struct qdma_flq_pool *pool = flq->pool;
+	unsigned int cnt = min_t(unsigned int, QDMA_FLQ_POOL_BULK,
+				 pool->size - pool->free_cnt);
+	int rv = 0;
+	int i;
+
+	for (i = 0; i < cnt; i++) {
+		rv = flq_map_page(pool->free + pool->free_cnt, dev, node,
+				  flq->pg_order, gfp);
+		if (unlikely(rv < 0)) {
+			if (rv == -ENOMEM)
+				flq->alloc_fail++;
+			else
+				flq->mapping_err++;
+			break;
+		}
+		pool->free_cnt++;
+		pool->alloc_slow++;
+	}
+
+	return pool->free_cnt ? 0 : rv;
+}
+
+/* move the pages no longer referenced by the handler to the free stack */
+static void flq_pool_reap(struct qdma_flq *flq, struct device *dev)
+{
+	struct qdma_flq_pool *pool = flq->pool;
+
+	while (pool->busy_cnt && pool->free_cnt < pool->size) {
+		struct qdma_flq_pool_ent *ent = pool->busy + pool->busy_head;
+
+		if (page_ref_count(ent->pg) != 1)
+			break;
+
+		dma_sync_single_for_device(dev, ent->dma_addr,
+				PAGE_SIZE << flq->pg_order, DMA_FROM_DEVICE);
+		pool->free[pool->free_cnt++] = *ent;
+		pool->busy_head = ring_idx_incr(pool->busy_head, 1, pool->size);
+		pool->busy_cnt--;
+		pool->recycle++;
+	}
+}
+
+static void flq_pool_destroy(struct qdma_flq *flq, struct device *dev)
+{
+	struct qdma_flq_pool *pool = flq->pool;
+
+	if (!pool)
+		return;
+
+	while (pool->free_cnt)
+		flq_pool_release_one(pool->free + --pool->free_cnt, dev,
+				     flq->pg_order);
+	for ( ; pool->busy_cnt; pool->busy_cnt--,
+		pool->busy_head = ring_idx_incr(pool->busy_head, 1, pool->size))
+		flq_pool_release_one(pool->busy + pool->busy_head, dev,
+				     flq->pg_order);
+
+	kfree(pool);
+	flq->pool = NULL;
+}
+
+static int flq_pool_create(struct qdma_flq *flq, struct device *dev,
+				int node)
+{
+	struct qdma_flq_pool *pool;
+
+	pool = kzalloc_node(sizeof(struct qdma_flq_pool) + 2 * flq->size *
+				sizeof(struct qdma_flq_pool_ent),
+			    GFP_KERNEL, node);
+	if (!pool) {
+		pr_info("OOM, pool sz %u.\n", flq->size);
+		return -ENOMEM;
+	}
+	pool->size = flq->size;
+	pool->free = (struct qdma_flq_pool_ent *)(pool + 1);
+	pool->busy = pool->free + pool->size;
+	flq->pool = pool;
+
+	/* start with one bulk of mapped pages */
+	return flq_pool_alloc_bulk(flq, dev, node, GFP_KERNEL);
+}
+
+/*
+ * refill one free list entry from the pool: the page is reused in place if
+ * the handler did not keep it, otherwise it is parked on the busy fifo and
+ * replaced by a free one
+ */
+static int flq_pool_refill_one(struct qdma_flq *flq, struct qdma_sw_sg *sdesc,
+				struct qdma_c2h_desc *desc, struct device *dev,
+				int node, unsigned int buf_sz, gfp_t gfp)
+{
+	struct qdma_flq_pool *pool = flq->pool;
+	struct qdma_flq_pool_ent *ent;
+	unsigned char pg_order = flq->pg_order;
+	int rv;
+
+	if (sdesc->pg && page_ref_count(sdesc->pg) == 1) {
+		dma_sync_single_for_device(dev, sdesc->dma_addr,
+				PAGE_SIZE << pg_order, DMA_FROM_DEVICE);
+		pool->reuse++;
+		goto done;
+	}
+
+	if (sdesc->pg) {
+		if (pool->busy_cnt == pool->size)
+			flq_pool_reap(flq, dev);
+		if (pool->busy_cnt == pool->size) {
+			/* the oldest busy page is left to the handler */
+			flq_pool_release_one(pool->busy + pool->busy_head, dev,
+					     pg_order);
+			pool->busy_head = ring_idx_incr(pool->busy_head, 1,
+							pool->size);
+			pool->busy_cnt--;
+			pool->release++;
+		}
+		ent = pool->busy + ring_idx_incr(pool->busy_head,
+						 pool->busy_cnt, pool->size);
+		ent->pg = sdesc->pg;
+		ent->dma_addr = sdesc->dma_addr;
+		pool->busy_cnt++;
+
+		sdesc->pg = NULL;
+		sdesc->dma_addr = 0UL;
+		desc->dst_addr = 0UL;
+	}
+
+	if (!pool->free_cnt)
+		flq_pool_reap(flq, dev);
+	if (pool->free_cnt) {
+		pool->alloc_fast++;
+	} else {
+		rv = flq_pool_alloc_bulk(flq, dev, node, gfp);
+		if (unlikely(rv < 0))
+			return rv;
+	}
+
+	ent = pool->free + --pool->free_cnt;
+	sdesc->pg = ent->pg;
+	sdesc->dma_addr = ent->dma_addr;
+	ent->pg = NULL;
+
+done:
+	sdesc->len = buf_sz << pg_order;
+	sdesc->offset = 0;
+	desc->dst_addr = sdesc->dma_addr;
+	return 0;
+}
+
+int descq_flq_pool_dump(struct qdma_descq *descq, char *buf, int buflen)
+{
+	struct qdma_flq *flq = (struct qdma_flq *)descq->flq;
+	struct qdma_flq_pool *pool;
+	int len;
+
+	lock_descq(descq);
+	pool = flq->pool;
+	if (!pool)
+		len = snprintf(buf, buflen, "%s: NO page pool.\n",
+				descq->conf.name);
+	else
+		len = snprintf(buf, buflen,
+			"%s: page pool %u, free %u, busy %u\n"
+			"\talloc fast %lu, slow %lu, fail %lu, map err %lu\n"
+			"\treuse %lu, recycle %lu, release %lu\n",
+			descq->conf.name, pool->size, pool->free_cnt,
+			pool->busy_cnt, pool->alloc_fast, pool->alloc_slow,
+			flq->alloc_fail, flq->mapping_err, pool->reuse,
+			pool->recycle, pool->release);
+	unlock_descq(descq);
+
+	return min(len, buflen);
+}
+
 void descq_flq_free_resource(struct qdma_descq *descq)
 {
 	struct xlnx_dma_dev *xdev = descq->xdev;
@@ -105,18 +322,29 @@ void descq_flq_free_resource(struct qdma_descq *descq)
 	unsigned char pg_order = flq->pg_order;
 	int i;
 
-	for (i = 0; i < flq->size; i++, sdesc++, desc++) {
+	/* zero-copy: the pages belong to the read requests */
+	for (i = 0; !descq->conf.c2h_zerocopy && i < flq->size;
+					i++, sdesc++, desc++) {
 		if (sdesc)
 			flq_free_one(sdesc, desc, dev, pg_order);
 		else
 			break;
 	}
+	flq_pool_destroy(flq, dev);
 
 	kfree(flq->sdesc);
 	flq->sdesc = NULL;
 	flq->sdesc_info = NULL;
 
+	/* the user space mappings hold their own page references */
+	if (flq->ring) {
+		free_pages((unsigned long)flq->ring,
+			   get_order(descq_st_c2h_ring_bytes(flq)));
+		flq->ring = NULL;
+	}
+
 	memset(flq, 0, sizeof(struct qdma_flq));
+	qdma_waitq_wakeup(&descq->c2h_ring_wq);
 }
 
 int descq_flq_alloc_resource(struct qdma_descq *descq)
@@ -153,6 +381,12 @@ int descq_flq_alloc_resource(struct qdma_descq *descq)
 	prev->next = flq->sdesc;
 	sprev->next = flq->sdesc_info;
 
+	/* zero-copy: filled by descq_st_c2h_zc_post() */
+	if (descq->conf.c2h_zerocopy) {
+		descq->cidx_cmpt_pend = 0;
+		return 0;
+	}
+
 	for (sdesc = flq->sdesc, i = 0; i < flq->size; i++, sdesc++, desc++) {
 		rv = flq_fill_one(sdesc, desc, dev, node, descq->conf.c2h_bufsz,
 				  flq->pg_order, GFP_KERNEL);
@@ -162,6 +396,15 @@ int descq_flq_alloc_resource(struct qdma_descq *descq)
 		}
 	}
 
+	/* the packets are handed over, refill from a page pool */
+	if (descq->conf.fp_descq_c2h_packet) {
+		rv = flq_pool_create(flq, dev, node);
+		if (rv < 0) {
+			descq_flq_free_resource(descq);
+			return rv;
+		}
+	}
+
 	descq->cidx_cmpt_pend = 0;
 return 0;
 }
@@ -194,17 +437,25 @@ static int qdma_flq_refill(struct qdma_descq *descq, int idx, int count,
 			int node = dev_to_node(dev);
 			int rv;
 
-			flq_unmap_one(sdesc, desc, dev, order);
-			rv = flq_fill_one(sdesc, desc, dev, node,
-					  descq->conf.c2h_bufsz, order, gfp);
-			if (unlikely(rv < 0)) {
-				if (rv == -ENOMEM)
-					flq->alloc_fail++;
-				else
-					flq->mapping_err++;
-
-				break;
+			if (flq->pool) {
+				/* failures counted by flq_pool_alloc_bulk() */
+				rv = flq_pool_refill_one(flq, sdesc, desc, dev,
+						node, descq->conf.c2h_bufsz,
+						gfp);
+			} else {
+				flq_unmap_one(sdesc, desc, dev, order);
+				rv = flq_fill_one(sdesc, desc, dev, node,
+						descq->conf.c2h_bufsz, order,
+						gfp);
+				if (unlikely(rv < 0)) {
+					if (rv == -ENOMEM)
+						flq->alloc_fail++;
+					else
+						flq->mapping_err++;
+				}
 			}
+			if (unlikely(rv < 0))
+				break;
 		}
 		sinfo->fbits = 0;
 		descq->avail++;
@@ -219,6 +470,196 @@ static int qdma_flq_refill(struct qdma_descq *descq, int idx, int count,
 	return i;
 }
 
+/*
+ * mmap'ed ring: publish the received buffers [ring_prod, pidx) to the
+ * user space
+ */
+static void descq_st_c2h_ring_publish(struct qdma_descq *descq)
+{
+	struct qdma_flq *flq = (struct qdma_flq *)descq->flq;
+	struct qdma_c2h_ring_ctrl *ring = flq->ring;
+	struct qdma_c2h_ring_entry *ent = (struct qdma_c2h_ring_entry *)
+						(ring + 1);
+	unsigned int prod = flq->ring_prod;
+
+	if (prod == descq->pidx)
+		return;
+
+	for ( ; prod != descq->pidx; prod = ring_idx_incr(prod, 1, flq->size)) {
+		struct qdma_sdesc_info *sinfo = flq->sdesc_info + prod;
+
+		ent[prod].offset = flq->sdesc[prod].offset;
+		ent[prod].len = flq->sdesc[prod].len;
+		ent[prod].flags = (sinfo->f.sop ? QDMA_C2H_RING_F_SOP : 0) |
+				  (sinfo->f.eop ? QDMA_C2H_RING_F_EOP : 0);
+	}
+
+	/* entries visible before the producer index */
+	smp_wmb();
+	WRITE_ONCE(ring->prod, prod);
+	flq->ring_prod = prod;
+
+	qdma_waitq_wakeup(&descq->c2h_ring_wq);
+}
+
+/*
+ * mmap'ed ring: recycle the buffers the user space has consumed, i.e.,
+ * [pidx_pend, cons), back to the hardware
+ */
+static int descq_st_c2h_ring_recycle(struct qdma_descq *descq)
+{
+	struct qdma_flq *flq = (struct qdma_flq *)descq->flq;
+	unsigned int cons = READ_ONCE(flq->ring->cons);
+	unsigned int pidx = flq->pidx_pend;
+	unsigned int cnt;
+	int i;
+	int rv;
+
+	/* cons is user controlled, it cannot pass the published entries */
+	if (cons >= flq->size)
+		return 0;
+	cnt = ring_idx_delta(cons, pidx, flq->size);
+	if (!cnt || cnt > ring_idx_delta(flq->ring_prod, pidx, flq->size))
+		return 0;
+
+	for (i = 0; i < cnt; i++, pidx = ring_idx_incr(pidx, 1, flq->size)) {
+		struct qdma_sdesc_info *sinfo = flq->sdesc_info + pidx;
+
+		if (sinfo->f.eop)
+			descq->cidx_cmpt_pend = sinfo->cidx;
+		flq->pkt_dlen -= flq->sdesc[pidx].len;
+	}
+
+	incr_cmpl_desc_cnt(descq, cnt);
+	qdma_flq_refill(descq, flq->pidx_pend, cnt, 1, GFP_ATOMIC);
+	flq->pidx_pend = cons;
+
+	if (descq->q_stop_wait)
+		return 0;
+
+	descq->pidx_info.pidx = ring_idx_decr(flq->pidx_pend, 1, flq->size);
+	rv = queue_pidx_update(descq->xdev, descq->conf.qidx,
+			descq->conf.c2h, &descq->pidx_info);
+	if (rv < 0) {
+		pr_err("%s: Failed to update pidx\n", descq->conf.name);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+/*
+ * zero-copy: the pending read requests are posted to the hardware in
+ * order, one c2h_bufsz chunk of a request page per descriptor
+ */
+int descq_st_c2h_zc_post(struct qdma_descq *descq)
+{
+	struct qdma_flq *flq = (struct qdma_flq *)descq->flq;
+	unsigned int bufsz = descq->conf.c2h_bufsz;
+	unsigned int free = flq->size - 1 -
+			ring_idx_delta(flq->pidx, flq->pidx_pend, flq->size);
+	struct qdma_sgt_req_cb *cb;
+	unsigned int posted = 0;
+	int rv;
+
+	list_for_each_entry(cb, &descq->pend_list, list) {
+		struct qdma_request *req = (struct qdma_request *)cb;
+		struct qdma_sw_sg *tsg = req->sgl;
+		unsigned int j;
+
+		if (!free)
+			break;
+		if ((cb->desc_nr * bufsz) == req->count)
+			continue;
+
+		for (j = 0; tsg && j < cb->sg_idx; j++)
+			tsg = tsg->next;
+
+		while (free && tsg && (cb->desc_nr * bufsz) < req->count) {
+			struct qdma_sw_sg *sdesc = flq->sdesc + flq->pidx;
+			struct qdma_c2h_desc *desc = flq->desc + flq->pidx;
+
+			sdesc->pg = tsg->pg;
+			sdesc->offset = tsg->offset + cb->sg_offset;
+			sdesc->len = bufsz;
+			sdesc->dma_addr = tsg->dma_addr + cb->sg_offset;
+			desc->dst_addr = sdesc->dma_addr;
+			flq->sdesc_info[flq->pidx].fbits = 0;
+
+			flq->pidx = ring_idx_incr(flq->pidx, 1, flq->size);
+			cb->desc_nr++;
+			free--;
+			posted++;
+
+			cb->sg_offset += bufsz;
+			if (cb->sg_offset >= tsg->len) {
+				tsg = tsg->next;
+				cb->sg_idx++;
+				cb->sg_offset = 0;
+			}
+		}
+
+		/* keep the ring in request order */
+		if ((cb->desc_nr * bufsz) != req->count)
+			break;
+	}
+
+	if (!posted)
+		return 0;
+
+	descq->avail += posted;
+	descq->pidx_info.pidx = flq->pidx;
+	rv = queue_pidx_update(descq->xdev, descq->conf.qidx,
+			descq->conf.c2h, &descq->pidx_info);
+	if (rv < 0) {
+		pr_err("%s: Failed to update pidx\n", descq->conf.name);
+		return -EINVAL;
+	}
+
+	return posted;
+}
+
+/*
+ * zero-copy: the data is already in the request pages, consume the
+ * request's descriptors and account for the received bytes
+ */
+static int descq_st_c2h_zc_read(struct qdma_descq *descq,
+				struct qdma_request *req)
+{
+	struct qdma_sgt_req_cb *cb = qdma_req_cb_get(req);
+	struct qdma_flq *flq = (struct qdma_flq *)descq->flq;
+	unsigned int bufsz = descq->conf.c2h_bufsz;
+	unsigned int pidx = flq->pidx_pend;
+	unsigned int fsgcnt = ring_idx_delta(descq->pidx, pidx, flq->size);
+	unsigned int rcvd = 0;
+	int i;
+
+	for (i = 0; i < fsgcnt && cb->left; i++) {
+		struct qdma_sw_sg *sdesc = flq->sdesc + pidx;
+		struct qdma_sdesc_info *sinfo = flq->sdesc_info + pidx;
+
+		if (sinfo->f.eop)
+			descq->cidx_cmpt_pend = sinfo->cidx;
+
+		rcvd += sdesc->len;
+		cb->left -= bufsz;
+
+		sdesc->pg = NULL;
+		sdesc->dma_addr = 0UL;
+		sinfo->fbits = 0;
+
+		pidx = ring_idx_incr(pidx, 1, flq->size);
+	}
+
+	incr_cmpl_desc_cnt(descq, i);
+
+	flq->pidx_pend = pidx;
+	flq->pkt_dlen -= rcvd;
+	cb->offset += rcvd;
+
+	return rcvd;
+}
+
 /*
  *
  */
@@ -237,6 +678,9 @@ int descq_st_c2h_read(struct qdma_descq *descq, struct qdma_request *req,
 	int rv = 0;
 	unsigned int copied = 0;
 
+	if (descq->conf.c2h_zerocopy)
+		return descq_st_c2h_zc_read(descq, req);
+
 	if (!fsgcnt)
 		return 0;
 
@@ -462,7 +906,22 @@ static int rcv_pkt(struct qdma_descq *descq, struct cmpl_info *cmpl,
 	}
 
 	if (descq->conf.fp_descq_c2h_packet) {
-		int rv = descq->conf.fp_descq_c2h_packet(descq->q_hndl,
+		int rv;
+
+		/* the pool keeps the pages mapped after the handler returns */
+		if (flq->pool) {
+			struct device *dev = &descq->xdev->conf.pdev->dev;
+			struct qdma_sw_sg *sg = flq->sdesc + pidx;
+			int i;
+
+			for (i = 0; i < fl_nr; i++, sg = sg->next)
+				if (sg->len)
+					dma_sync_single_for_cpu(dev,
+						sg->dma_addr, sg->len,
+						DMA_FROM_DEVICE);
+		}
+
+		rv = descq->conf.fp_descq_c2h_packet(descq->q_hndl,
 				descq->conf.quld, len, fl_nr, flq->sdesc + pidx,
 				descq->conf.cmpl_udd_en ?
 				(unsigned char *)cmpl->entry : NULL);
@@ -535,6 +994,161 @@ int rcv_udd_only(struct qdma_descq *descq, struct cmpl_info *cmpl)
 	return 0;
 }
 
+/*
+ * adaptive completion moderation: the completion entries per service are
+ * sampled over a window. When the interrupts carry at least the counter
+ * threshold, the rate is high and the level goes up (longer timer, bigger
+ * counter); when they carry less than half of it, the timer is adding
+ * latency for little coalescing and the level goes down.
+ */
+
+/* max. # of completion entries processed per service */
+#define QDMA_CMPL_POLL_BUDGET	64
+/* # of services per sample window */
+#define QDMA_CMPL_MOD_WINDOW	16
+
+/* index of the next bigger (up) or smaller value in a global csr array */
+static int cmpl_mod_next_idx(const unsigned int *v, int cur, bool up)
+{
+	int best = -1;
+	int i;
+
+	for (i = 0; i < QDMA_GLOBAL_CSR_ARRAY_SZ; i++) {
+		if (up ? v[i] <= v[cur] : v[i] >= v[cur])
+			continue;
+		if (best < 0 || (up ? v[i] < v[best] : v[i] > v[best]))
+			best = i;
+	}
+
+	return best;
+}
+
+static int cmpl_mod_min_idx(const unsigned int *v)
+{
+	int best = 0;
+	int i;
+
+	for (i = 1; i < QDMA_GLOBAL_CSR_ARRAY_SZ; i++)
+		if (v[i] < v[best])
+			best = i;
+
+	return best;
+}
+
+static void cmpl_mod_set(struct qdma_descq *descq, u8 level, int timer_idx,
+			int cnt_idx)
+{
+	struct qdma_cmpl_mod *mod = &descq->cmpl_mod;
+
+	mod->level = level;
+	descq->conf.cmpl_trig_mode = level ? TRIG_MODE_COMBO :
+					TRIG_MODE_ANY;
+	descq->conf.cmpl_timer_idx = timer_idx;
+	descq->conf.cmpl_cnt_th_idx = cnt_idx;
+
+	/* takes effect with the next cmpt cidx update */
+	descq->cmpt_cidx_info.trig_mode = descq->conf.cmpl_trig_mode;
+	descq->cmpt_cidx_info.timer_idx = timer_idx;
+	descq->cmpt_cidx_info.counter_idx = cnt_idx;
+}
+
+void descq_st_c2h_cmpl_mod_init(struct qdma_descq *descq)
+{
+	struct global_csr_conf *csr = &descq->xdev->csr_info;
+
+	memset(&descq->cmpl_mod, 0, sizeof(struct qdma_cmpl_mod));
+	cmpl_mod_set(descq, 0, cmpl_mod_min_idx(csr->c2h_timer_cnt),
+		     cmpl_mod_min_idx(csr->c2h_cnt_th));
+}
+
+static void cmpl_mod_update(struct qdma_descq *descq)
+{
+	struct global_csr_conf *csr = &descq->xdev->csr_info;
+	struct qdma_cmpl_mod *mod = &descq->cmpl_mod;
+	int timer_idx = descq->cmpt_cidx_info.timer_idx;
+	int cnt_idx = descq->cmpt_cidx_info.counter_idx;
+	unsigned int th = csr->c2h_cnt_th[cnt_idx];
+	unsigned int avg = mod->cmpl_cnt / mod->svc_cnt;
+	int idx;
+
+	mod->svc_cnt = 0;
+	mod->cmpl_cnt = 0;
+
+	if (avg >= th) {
+		/* level 1 keeps the smallest timer and counter */
+		if (mod->level) {
+			idx = cmpl_mod_next_idx(csr->c2h_cnt_th, cnt_idx, true);
+			if (idx < 0)
+				return;
+			cnt_idx = idx;
+			idx = cmpl_mod_next_idx(csr->c2h_timer_cnt, timer_idx,
+						true);
+			if (idx >= 0)
+				timer_idx = idx;
+		}
+		cmpl_mod_set(descq, mod->level + 1, timer_idx, cnt_idx);
+	} else if (mod->level && (avg << 1) < th) {
+		if (mod->level > 1) {
+			idx = cmpl_mod_next_idx(csr->c2h_cnt_th, cnt_idx,
+						false);
+			if (idx >= 0)
+				cnt_idx = idx;
+			idx = cmpl_mod_next_idx(csr->c2h_timer_cnt, timer_idx,
+						false);
+			if (idx >= 0)
+				timer_idx = idx;
+		}
+		cmpl_mod_set(descq, mod->level - 1, timer_idx, cnt_idx);
+	} else {
+		return;
+	}
+
+	mod->level_chg++;
+}
+
+/* mask the interrupt while polling, re-arm it once caught up */
+static inline void cmpl_mod_arm(struct qdma_descq *descq, bool poll)
+{
+	if (!descq->conf.adaptive_cmpl)
+		return;
+
+	descq->cmpl_mod.polling = poll;
+	descq->cmpt_cidx_info.irq_en = poll ? 0 : descq->conf.cmpl_en_intr;
+}
+
+void descq_st_c2h_adaptive_service(struct qdma_descq *descq)
+{
+	struct qdma_cmpl_mod *mod = &descq->cmpl_mod;
+	unsigned int cidx;
+	bool poll;
+
+	lock_descq(descq);
+	if (descq->q_state != Q_STATE_ONLINE) {
+		unlock_descq(descq);
+		return;
+	}
+
+	cidx = descq->cidx_cmpt;
+	descq_process_completion_st_c2h(descq, QDMA_CMPL_POLL_BUDGET, true);
+	mod->cmpl_cnt += ring_idx_delta(descq->cidx_cmpt, cidx,
+					descq->conf.rngsz_cmpt);
+	if (++mod->svc_cnt >= QDMA_CMPL_MOD_WINDOW)
+		cmpl_mod_update(descq);
+
+	poll = mod->polling && !descq->err;
+	if (poll)
+		mod->poll_cnt++;
+	unlock_descq(descq);
+
+	if (!poll)
+		return;
+
+	if (descq->cpu_assigned)
+		schedule_work_on(descq->intr_work_cpu, &descq->work);
+	else
+		schedule_work(&descq->work);
+}
+
 int descq_process_completion_st_c2h(struct qdma_descq *descq, int budget,
 					bool upd_cmpl)
 {
@@ -548,6 +1162,7 @@ int descq_process_completion_st_c2h(struct qdma_descq *descq, int budget,
 	struct qdma_flq *flq = (struct qdma_flq *)descq->flq;
 	unsigned int pidx_pend = flq->pidx_pend;
 	bool uld_handler = descq->conf.fp_descq_c2h_packet ? true : false;
+	int quota = budget;
 	int pend, ret = 0;
 	int proc_cnt = 0;
 	int rv = 0;
@@ -558,6 +1173,11 @@ int descq_process_completion_st_c2h(struct qdma_descq *descq, int budget,
 		return 0;
 	}
 
+	/* return the buffers consumed through the mmap'ed ring first */
+	if (flq->ring && descq_st_c2h_ring_recycle(descq) < 0)
+		return -EINVAL;
+	pidx_pend = flq->pidx_pend;
+
 	dma_rmb();
 
 	pend = ring_idx_delta(pidx_cmpt, cidx_cmpt, rngsz_cmpt);
@@ -566,6 +1186,7 @@ int descq_process_completion_st_c2h(struct qdma_descq *descq, int budget,
 		 * there are no entries as of now
 		 */
 		if (descq->xdev->conf.qdma_drv_mode != POLL_MODE) {
+			cmpl_mod_arm(descq, false);
 			descq->cmpt_cidx_info.wrb_cidx = descq->cidx_cmpt;
 			rv = queue_cmpt_cidx_update(descq->xdev,
 					descq->conf.qidx,
@@ -623,6 +1244,8 @@ int descq_process_completion_st_c2h(struct qdma_descq *descq, int budget,
 	if (proc_cnt) {
 		descq->pidx_cmpt = pidx_cmpt;
 		descq->pidx = pidx;
+		/* budget used up, there may be more */
+		cmpl_mod_arm(descq, quota && proc_cnt == quota);
 		descq->cmpt_cidx_info.wrb_cidx = descq->cidx_cmpt;
 		rv = queue_cmpt_cidx_update(descq->xdev,
 				descq->conf.qidx, &descq->cmpt_cidx_info);
@@ -631,14 +1254,21 @@ int descq_process_completion_st_c2h(struct qdma_descq *descq, int budget,
 					descq->conf.name);
 			return -EINVAL;
 		}
-		if (!descq->conf.fp_descq_c2h_packet)
+		if (flq->ring)
+			descq_st_c2h_ring_publish(descq);
+		else if (!descq->conf.fp_descq_c2h_packet)
 			qdma_c2h_packets_proc_dflt(descq);
 
 		flq->pkt_cnt = ring_idx_delta(cs->pidx, descq->cidx_cmpt,
 					      rngsz_cmpt);
 
-		/* some descq entries have been consumed */
-		if (flq->pidx_pend != pidx_pend) {
+		/* zero-copy: post the next read requests, if any */
+		if (descq->conf.c2h_zerocopy) {
+			if (!descq->q_stop_wait &&
+			    descq_st_c2h_zc_post(descq) < 0)
+				return -EINVAL;
+		} else if (flq->pidx_pend != pidx_pend) {
+			/* some descq entries have been consumed */
 			pend = ring_idx_delta(flq->pidx_pend, pidx_pend,
 						flq->size);
 			qdma_flq_refill(descq, pidx_pend, pend,
@@ -701,6 +1331,19 @@ int qdma_queue_packet_read(unsigned long dev_hndl, unsigned long id,
 		return -EINVAL;
 	}
 
+	if (descq_st_c2h_ring_mapped(descq)) {
+		pr_info("%s: ring mmap'ed, packet read NOT supported.\n",
+			descq->conf.name);
+		return -EBUSY;
+	}
+
+	/* zero-copy reads go through qdma_request_submit() */
+	if (descq->conf.c2h_zerocopy) {
+		pr_info("%s: zero-copy, packet read NOT supported.\n",
+			descq->conf.name);
+		return -EINVAL;
+	}
+
 	memset(cb, 0, QDMA_REQ_OPAQUE_SIZE);
 
 	qdma_waitq_init(&cb->wq);
@@ -711,3 +1354,141 @@ int qdma_queue_packet_read(unsigned long dev_hndl, unsigned long id,
 
 	return req->count - cb->left;
 }
+
+int qdma_queue_c2h_ring_mmap(unsigned long dev_hndl, unsigned long id,
+			struct vm_area_struct *vma)
+{
+	struct qdma_descq *descq = qdma_device_get_descq_by_id(
+					(struct xlnx_dma_dev *)dev_hndl,
+					id, NULL, 0, 1);
+	struct qdma_flq *flq;
+	struct qdma_c2h_ring_ctrl *ring;
+	unsigned long addr = vma->vm_start;
+	unsigned long ring_sz, buf_sz;
+	struct page *pg;
+	int order;
+	int i, j;
+	int rv;
+
+	if (!descq)
+		return QDMA_ERR_INVALID_QIDX;
+
+	if (!descq->conf.st || !descq->conf.c2h ||
+	    descq->conf.c2h_zerocopy || descq->conf.fp_descq_c2h_packet) {
+		pr_info("%s: st %d, c2h %d, zero-copy %d, mmap NOT supported.\n",
+			descq->conf.name, descq->conf.st, descq->conf.c2h,
+			descq->conf.c2h_zerocopy);
+		return -EINVAL;
+	}
+
+	flq = (struct qdma_flq *)descq->flq;
+	ring_sz = PAGE_ALIGN(descq_st_c2h_ring_bytes(flq));
+	buf_sz = PAGE_SIZE << flq->pg_order;
+	if (vma->vm_pgoff ||
+	    (vma->vm_end - vma->vm_start) != ring_sz + flq->size * buf_sz) {
+		pr_info("%s: mmap 0x%lx,%lu, expect 0,%lu.\n",
+			descq->conf.name, vma->vm_pgoff,
+			vma->vm_end - vma->vm_start,
+			ring_sz + flq->size * buf_sz);
+		return -EINVAL;
+	}
+
+	order = get_order(ring_sz);
+	ring = (struct qdma_c2h_ring_ctrl *)__get_free_pages(
+				GFP_KERNEL | __GFP_ZERO | __GFP_COMP, order);
+	if (!ring) {
+		pr_info("%s: OOM, ring order %d.\n", descq->conf.name, order);
+		return -ENOMEM;
+	}
+
+	lock_descq(descq);
+	if (descq->q_state != Q_STATE_ONLINE ||
+	    !list_empty(&descq->pend_list)) {
+		unlock_descq(descq);
+		free_pages((unsigned long)ring, order);
+		pr_info("%s: NOT online or read pending.\n", descq->conf.name);
+		return -EBUSY;
+	}
+	if (!flq->ring) {
+		ring->size = flq->size;
+		ring->buf_len = descq->conf.c2h_bufsz;
+		ring->buf_stride = buf_sz;
+		ring->buf_offset = ring_sz;
+		ring->prod = ring->cons = flq->pidx_pend;
+		flq->ring_prod = flq->pidx_pend;
+		flq->ring = ring;
+		ring = NULL;
+		/* anything received but not read yet */
+		descq_st_c2h_ring_publish(descq);
+	}
+	pg = virt_to_page(flq->ring);
+	unlock_descq(descq);
+
+	if (ring)
+		free_pages((unsigned long)ring, order);
+
+	for (i = 0; i < (ring_sz >> PAGE_SHIFT); i++, addr += PAGE_SIZE) {
+		rv = vm_insert_page(vma, addr, pg + i);
+		if (rv < 0)
+			return rv;
+	}
+
+	/* recycled in place, the free list pages stay the same */
+	for (i = 0; i < flq->size; i++) {
+		pg = flq->sdesc[i].pg;
+		for (j = 0; j < (1 << flq->pg_order); j++, addr += PAGE_SIZE) {
+			rv = vm_insert_page(vma, addr, pg + j);
+			if (rv < 0)
+				return rv;
+		}
+	}
+
+	return 0;
+}
+
+int qdma_queue_c2h_ring_wait(unsigned long dev_hndl, unsigned long id,
+			unsigned int timeout_ms)
+{
+	struct qdma_descq *descq = qdma_device_get_descq_by_id(
+					(struct xlnx_dma_dev *)dev_hndl,
+					id, NULL, 0, 1);
+	struct qdma_flq *flq;
+	unsigned int prod;
+	int rv;
+
+	if (!descq)
+		return QDMA_ERR_INVALID_QIDX;
+
+	flq = (struct qdma_flq *)descq->flq;
+
+	lock_descq(descq);
+	if (!flq->ring || descq->q_state != Q_STATE_ONLINE) {
+		unlock_descq(descq);
+		return -EINVAL;
+	}
+	/* recycles the consumed buffers and picks up the new packets */
+	rv = descq_process_completion_st_c2h(descq, 0, true);
+	prod = flq->ring_prod;
+	if (!rv)
+		rv = ring_idx_delta(prod, READ_ONCE(flq->ring->cons),
+				    flq->size);
+	unlock_descq(descq);
+
+	if (rv || !timeout_ms)
+		return rv;
+
+	qdma_waitq_wait_event_timeout(descq->c2h_ring_wq,
+			READ_ONCE(flq->ring_prod) != prod ||
+			descq->q_state != Q_STATE_ONLINE,
+			msecs_to_jiffies(timeout_ms));
+
+	lock_descq(descq);
+	if (flq->ring && descq->q_state == Q_STATE_ONLINE)
+		rv = ring_idx_delta(flq->ring_prod, READ_ONCE(flq->ring->cons),
+				    flq->size);
+	else
+		rv = -ENXIO;
+	unlock_descq(descq);
+
+	return rv;
+}
@@ -30,6 +30,7 @@
 #ifdef ERR_DEBUG
 #include "qdma_nl.h"
 #endif
+#include "qdma_c2h_ring.h"
 
 /**
  * @struct - qdma_sdesc_info
@@ -65,6 +66,53 @@ struct qdma_sdesc_info {
 	unsigned int cidx;
 };
 
+/**
+ * @struct - qdma_flq_pool_ent
+ * @brief a dma mapped free list page kept by the page pool
+ */
+struct qdma_flq_pool_ent {
+	/** page, holding one reference of the pool */
+	struct page *pg;
+	/** dma address of the page */
+	dma_addr_t dma_addr;
+};
+
+/**
+ * @struct - qdma_flq_pool
+ * @brief per queue pool of dma mapped pages, used to refill the free list
+ *	when the packets are handed to the queue's fp_descq_c2h_packet()
+ *	handler.
+ *
+ * A page handed to the handler and still referenced by it is parked on the
+ * busy fifo, it comes back to the free stack once the handler drops its
+ * reference. The pages are allocated and mapped in bulk, and unmapped only
+ * when the busy fifo overflows or the queue is stopped.
+ */
+struct qdma_flq_pool {
+	/** RO: capacity of the free stack and of the busy fifo */
+	unsigned int size;
+	/** RW: # of pages on the free stack */
+	unsigned int free_cnt;
+	/** RW: busy fifo head */
+	unsigned int busy_head;
+	/** RW: # of pages on the busy fifo */
+	unsigned int busy_cnt;
+	/** RW: # of pages refilled from the free stack */
+	unsigned long alloc_fast;
+	/** RW: # of pages allocated and mapped */
+	unsigned long alloc_slow;
+	/** RW: # of pages reused in place, not referenced by the handler */
+	unsigned long reuse;
+	/** RW: # of pages returned from the busy fifo to the free stack */
+	unsigned long recycle;
+	/** RW: # of pages unmapped and released, busy fifo overflow */
+	unsigned long release;
+	/** RW: free stack */
+	struct qdma_flq_pool_ent *free;
+	/** RW: busy fifo */
+	struct qdma_flq_pool_ent *busy;
+};
+
 /**
  * @struct - qdma_flq
  * @brief qdma free list q page allocation book keeping
@@ -101,8 +149,28 @@ struct qdma_flq {
 	struct qdma_sw_sg *sdesc;
 	/** RW: sw descriptor info */
 	struct qdma_sdesc_info *sdesc_info;
+	/** RW: ring shared with the user space by mmap, NULL if not mapped */
+	struct qdma_c2h_ring_ctrl *ring;
+	/** RW: producer index of the entries published to the user space */
+	unsigned int ring_prod;
+	/** RW: page pool, NULL if the buffers are recycled in place */
+	struct qdma_flq_pool *pool;
 };
 
+/*****************************************************************************/
+/**
+ * descq_st_c2h_ring_mapped() - check if the free list is shared with the
+ *				user space through mmap
+ *
+ * @param[in]	descq:		pointer to qdma_descq
+ *
+ * @return	true if the free list ring is mmap'ed
+ *****************************************************************************/
+static inline bool descq_st_c2h_ring_mapped(struct qdma_descq *descq)
+{
+	return ((struct qdma_flq *)descq->flq)->ring != NULL;
+}
+
 /*****************************************************************************/
 /**
  * qdma_descq_rxq_read() - read from the rx queue
@@ -161,6 +229,41 @@ void descq_flq_free_resource(struct qdma_descq *descq);
  *****************************************************************************/
 int descq_flq_alloc_resource(struct qdma_descq *descq);
 
+/*****************************************************************************/
+/**
+ * descq_flq_pool_dump() - dump the free list page pool statistics
+ *
+ * @param[in]	descq:		pointer to qdma_descq
+ * @param[out]	buf:		message buffer
+ * @param[in]	buflen:		length of the input buffer
+ *
+ * @return	length of the message
+ *****************************************************************************/
+int descq_flq_pool_dump(struct qdma_descq *descq, char *buf, int buflen);
+
+/*****************************************************************************/
+/**
+ * descq_st_c2h_cmpl_mod_init() - start the adaptive completion moderation
+ *				at the lowest latency level
+ *
+ * @param[in]	descq:		pointer to qdma_descq
+ *
+ * @return	none
+ *****************************************************************************/
+void descq_st_c2h_cmpl_mod_init(struct qdma_descq *descq);
+
+/*****************************************************************************/
+/**
+ * descq_st_c2h_adaptive_service() - budgeted completion service with
+ *				adaptive moderation, reschedules itself while
+ *				the budget is used up
+ *
+ * @param[in]	descq:		pointer to qdma_descq
+ *
+ * @return	none
+ *****************************************************************************/
+void descq_st_c2h_adaptive_service(struct qdma_descq *descq);
+
 /*****************************************************************************/
 /**
  * descq_process_completion_st_c2h() - handler to process the st c2h
@@ -191,4 +294,16 @@ int descq_process_completion_st_c2h(struct qdma_descq *descq, int budget,
 int descq_st_c2h_read(struct qdma_descq *descq, struct qdma_request *req,
 			bool update, bool refill);
 
+/*****************************************************************************/
+/**
+ * descq_st_c2h_zc_post() - zero-copy mode, post the pages of the pending
+ *				read requests as the c2h descriptors
+ *
+ * @param[in]	descq:		pointer to qdma_descq
+ *
+ * @return	# of descriptors posted
+ * @return	<0: failure
+ *****************************************************************************/
+int descq_st_c2h_zc_post(struct qdma_descq *descq);
+
 #endif /* ifndef __QDMA_ST_C2H_H__ */
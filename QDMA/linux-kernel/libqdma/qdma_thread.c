@@ -22,6 +22,10 @@
 #include "qdma_thread.h"
 
 #include <linux/kernel.h>
+#include <linux/workqueue.h>
+#include <linux/ktime.h>
+#include <linux/cpumask.h>
+#include <linux/topology.h>
 
 #include "qdma_descq.h"
 #include "thread.h"
@@ -33,9 +37,23 @@ static unsigned int thread_cnt;
 /** completion status threads */
 static struct qdma_kthread *cs_threads;
 
+/** protects the per cpu queue counts and lists, and the queue membership
+ *  of the completion threads' work lists
+ */
 spinlock_t	qcnt_lock;
 unsigned int cpu_count;
 static unsigned int *per_cpu_qcnt;
+/** interrupt mode: queues serviced on each cpu */
+static struct list_head *per_cpu_qlist;
+
+/** periodic rebalancing */
+static struct delayed_work rebal_work;
+static unsigned int rebal_interval_ms;
+
+/* only a bin busy for this % of the interval is offloaded */
+#define QDMA_REBAL_BUSY_PCT	25
+/* max. # of queues moved per pass */
+#define QDMA_REBAL_MAX_MOVES	4
 
 /* ********************* static function declarations *********************** */
 
@@ -50,7 +68,9 @@ static int qdma_thread_cmpl_status_pend(struct list_head *work_item)
 	int pend = 0;
 
 	lock_descq(descq);
-	pend = !list_empty(&descq->pend_list) || !list_empty(&descq->work_list);
+	pend = !list_empty(&descq->pend_list) ||
+		!list_empty(&descq->work_list) ||
+		!llist_empty(&descq->submit_list);
 	unlock_descq(descq);
 
 	return pend;
@@ -59,12 +79,201 @@ static int qdma_thread_cmpl_status_pend(struct list_head *work_item)
 static int qdma_thread_cmpl_status_proc(struct list_head *work_item)
 {
 	struct qdma_descq *descq;
+	ktime_t t0 = ktime_get();
 
 	descq = list_entry(work_item, struct qdma_descq, cmplthp_list);
 	qdma_descq_service_cmpl_update(descq, 0, 1);
+	descq->svc_ns += ktime_to_ns(ktime_sub(ktime_get(), t0));
 	return 0;
 }
 
+/*
+ * load-aware rebalancing: each pass samples the service time every queue
+ * consumed since the previous pass. A bin (completion thread or interrupt
+ * cpu) is offloaded when it is busy and the busiest, by moving the queue
+ * that best halves the gap to the least loaded bin; a queue bigger than half
+ * of the gap stays, moving it would only move the hot spot.
+ */
+static u64 rebal_sample(struct list_head *qlist)
+{
+	struct qdma_descq *descq;
+	u64 load = 0;
+
+	list_for_each_entry(descq, qlist, cmplthp_list) {
+		u64 ns = READ_ONCE(descq->svc_ns);
+
+		descq->svc_load = ns - descq->svc_ns_last;
+		descq->svc_ns_last = ns;
+		load += descq->svc_load;
+	}
+
+	return load;
+}
+
+/* numa node of a rebalancing bin */
+static inline int rebal_bin_node(bool thread, unsigned int i)
+{
+	return cpu_to_node(thread ? cs_threads[i].cpu : i);
+}
+
+/* the queues only move within the numa node of their bin */
+static bool rebal_find(u64 *load, unsigned int cnt, u64 busy_ns, bool thread,
+			unsigned int *src, unsigned int *dst)
+{
+	unsigned int i;
+	int node;
+
+	*src = 0;
+	for (i = 1; i < cnt; i++)
+		if (load[i] > load[*src])
+			*src = i;
+	if (load[*src] < busy_ns)
+		return false;
+
+	node = rebal_bin_node(thread, *src);
+	*dst = *src;
+	for (i = 0; i < cnt; i++)
+		if (load[i] < load[*dst] && rebal_bin_node(thread, i) == node)
+			*dst = i;
+
+	return *src != *dst;
+}
+
+static struct qdma_descq *rebal_pick(struct list_head *qlist, u64 gap)
+{
+	struct qdma_descq *descq, *best = NULL;
+
+	list_for_each_entry(descq, qlist, cmplthp_list) {
+		if (!descq->svc_load || descq->svc_load > gap)
+			continue;
+		if (!best || descq->svc_load > best->svc_load)
+			best = descq;
+	}
+
+	return best;
+}
+
+/* interrupt mode: move the queues' intr_work to another cpu */
+static void rebal_cpus(u64 busy_ns)
+{
+	u64 *load;
+	unsigned int src, dst;
+	int i;
+
+	load = kcalloc(cpu_count, sizeof(u64), GFP_KERNEL);
+	if (!load)
+		return;
+
+	spin_lock(&qcnt_lock);
+	for (i = 0; i < cpu_count; i++)
+		load[i] = rebal_sample(per_cpu_qlist + i);
+
+	for (i = 0; i < QDMA_REBAL_MAX_MOVES; i++) {
+		struct qdma_descq *descq;
+
+		if (!rebal_find(load, cpu_count, busy_ns, false, &src, &dst))
+			break;
+		descq = rebal_pick(per_cpu_qlist + src,
+				   (load[src] - load[dst]) >> 1);
+		if (!descq)
+			break;
+
+		list_move_tail(&descq->cmplthp_list, per_cpu_qlist + dst);
+		per_cpu_qcnt[src]--;
+		per_cpu_qcnt[dst]++;
+		load[src] -= descq->svc_load;
+		load[dst] += descq->svc_load;
+
+		/* the next interrupt schedules the work on the new cpu, the
+		 * workqueue does not run the same work concurrently
+		 */
+		lock_descq(descq);
+		descq->intr_work_cpu = dst;
+		unlock_descq(descq);
+
+		pr_debug("%s moved cpu %u -> %u, %llu ns.\n",
+			descq->conf.name, src, dst, descq->svc_load);
+	}
+	spin_unlock(&qcnt_lock);
+
+	kfree(load);
+}
+
+/* poll mode: move the queues to another completion thread */
+static void rebal_threads(u64 busy_ns)
+{
+	u64 *load;
+	unsigned int src, dst;
+	int i;
+
+	load = kcalloc(thread_cnt, sizeof(u64), GFP_KERNEL);
+	if (!load)
+		return;
+
+	spin_lock(&qcnt_lock);
+	for (i = 0; i < thread_cnt; i++)
+		load[i] = rebal_sample(&cs_threads[i].work_list);
+
+	for (i = 0; i < QDMA_REBAL_MAX_MOVES; i++) {
+		struct qdma_kthread *from, *to;
+		struct qdma_descq *descq;
+
+		if (!rebal_find(load, thread_cnt, busy_ns, true, &src, &dst))
+			break;
+		descq = rebal_pick(&cs_threads[src].work_list,
+				   (load[src] - load[dst]) >> 1);
+		if (!descq)
+			break;
+
+		from = cs_threads + src;
+		to = cs_threads + dst;
+
+		/* the threads walk their work list under the thread lock */
+		lock_thread(from);
+		list_del(&descq->cmplthp_list);
+		from->work_cnt--;
+		unlock_thread(from);
+
+		lock_descq(descq);
+		descq->cmplthp = to;
+		descq->intr_work_cpu = dst;
+		unlock_descq(descq);
+
+		lock_thread(to);
+		list_add_tail(&descq->cmplthp_list, &to->work_list);
+		to->work_cnt++;
+		unlock_thread(to);
+		qdma_kthread_wakeup(to);
+
+		load[src] -= descq->svc_load;
+		load[dst] += descq->svc_load;
+
+		pr_debug("%s moved %s -> %s, %llu ns.\n",
+			descq->conf.name, from->name, to->name,
+			descq->svc_load);
+	}
+	spin_unlock(&qcnt_lock);
+
+	kfree(load);
+}
+
+static void qdma_threads_rebalance(struct work_struct *work)
+{
+	unsigned int interval_ms = READ_ONCE(rebal_interval_ms);
+	u64 busy_ns;
+
+	if (!interval_ms)
+		return;
+
+	busy_ns = (u64)interval_ms * (NSEC_PER_MSEC / 100) * QDMA_REBAL_BUSY_PCT;
+	if (per_cpu_qlist && cpu_count > 1)
+		rebal_cpus(busy_ns);
+	if (thread_cnt > 1)
+		rebal_threads(busy_ns);
+
+	schedule_delayed_work(&rebal_work, msecs_to_jiffies(interval_ms));
+}
+
 /* ********************* public function definitions ************************ */
 
 void qdma_thread_remove_work(struct qdma_descq *descq)
@@ -73,6 +282,8 @@ void qdma_thread_remove_work(struct qdma_descq *descq)
 	int cpu_idx = cpu_count;
 
 
+	/* the rebalancing moves the queue under qcnt_lock */
+	spin_lock(&qcnt_lock);
 	lock_descq(descq);
 	cmpl_thread = descq->cmplthp;
 	descq->cmplthp = NULL;
@@ -81,6 +292,7 @@ void qdma_thread_remove_work(struct qdma_descq *descq)
 		descq->cpu_assigned = 0;
 		cpu_idx = descq->intr_work_cpu;
 	}
+	spin_unlock(&qcnt_lock);
 
 	pr_debug("%s removing from thread %s, %u.\n",
 		descq->conf.name, cmpl_thread ? cmpl_thread->name : "?",
@@ -91,41 +303,89 @@ void qdma_thread_remove_work(struct qdma_descq *descq)
 	if (cpu_idx < cpu_count) {
 		spin_lock(&qcnt_lock);
 		per_cpu_qcnt[cpu_idx]--;
+		list_del(&descq->cmplthp_list);
 		spin_unlock(&qcnt_lock);
 	}
 
 	if (cmpl_thread) {
+		spin_lock(&qcnt_lock);
 		lock_thread(cmpl_thread);
 		list_del(&descq->cmplthp_list);
 		cmpl_thread->work_cnt--;
 		unlock_thread(cmpl_thread);
+		spin_unlock(&qcnt_lock);
 	}
 }
 
-void qdma_thread_add_work(struct qdma_descq *descq)
+static inline bool cpu_on_node(unsigned int cpu, int node)
+{
+	return node == NUMA_NO_NODE || cpu_to_node(cpu) == node;
+}
+
+/* interrupt mode: the cpu of the node with the fewest queues, -1 if none */
+static int pick_cpu(int node)
+{
+	unsigned int v = 0;
+	int i, idx = -1;
+
+	for (i = cpu_count - 1; i >= 0; i--) {
+		if (!cpu_on_node(i, node))
+			continue;
+		if (idx < 0 || per_cpu_qcnt[i] < v) {
+			idx = i;
+			v = per_cpu_qcnt[i];
+			if (!v)
+				break;
+		}
+	}
+
+	return idx;
+}
+
+/* poll mode: the thread of the node with the fewest queues, -1 if none */
+static int pick_thread(int node)
 {
 	struct qdma_kthread *thp = cs_threads;
 	unsigned int v = 0;
-	int i, idx = thread_cnt;
+	int i, idx = -1;
+
+	for (i = 0; i < thread_cnt; i++, thp++) {
+		if (!cpu_on_node(thp->cpu, node))
+			continue;
+		lock_thread(thp);
+		if (idx < 0 || thp->work_cnt < v) {
+			idx = i;
+			v = thp->work_cnt;
+		}
+		unlock_thread(thp);
+		if (!v)
+			break;
+	}
+
+	return idx;
+}
+
+void qdma_thread_add_work(struct qdma_descq *descq)
+{
+	struct qdma_kthread *thp;
+	/* device local cpus first */
+	int node = dev_to_node(&descq->xdev->conf.pdev->dev);
+	int idx;
 
 	if (descq->xdev->conf.qdma_drv_mode != POLL_MODE) {
 		spin_lock(&qcnt_lock);
-		idx = cpu_count - 1;
-		v = per_cpu_qcnt[idx];
-		for (i = idx - 1; i >= 0  && v; i--) {
-			if (per_cpu_qcnt[i] < v) {
-				idx = i;
-				v = per_cpu_qcnt[i];
-			}
-		}
+		idx = pick_cpu(node);
+		if (idx < 0)
+			idx = pick_cpu(NUMA_NO_NODE);
 
 		per_cpu_qcnt[idx]++;
-		spin_unlock(&qcnt_lock);
+		list_add_tail(&descq->cmplthp_list, per_cpu_qlist + idx);
 
 		lock_descq(descq);
 		descq->cpu_assigned = 1;
 		descq->intr_work_cpu = idx;
 		unlock_descq(descq);
+		spin_unlock(&qcnt_lock);
 
 		pr_debug("%s 0x%p assigned to cpu %u.\n",
 			descq->conf.name, descq, idx);
@@ -134,38 +394,64 @@ void qdma_thread_add_work(struct qdma_descq *descq)
 	}
 
 	/* Polled mode only */
-	for (i = 0; i < thread_cnt; i++, thp++) {
-		lock_thread(thp);
-		if (idx == thread_cnt) {
-			v = thp->work_cnt;
-			idx = i;
-		} else if (!thp->work_cnt) {
-			idx = i;
-			unlock_thread(thp);
-			break;
-		} else if (thp->work_cnt < v)
-			idx = i;
-		unlock_thread(thp);
-	}
+	idx = pick_thread(node);
+	if (idx < 0)
+		idx = pick_thread(NUMA_NO_NODE);
 
 	thp = cs_threads + idx;
+	spin_lock(&qcnt_lock);
+	lock_descq(descq);
+	descq->cmplthp = thp;
+	unlock_descq(descq);
+
 	lock_thread(thp);
 	list_add_tail(&descq->cmplthp_list, &thp->work_list);
 	descq->intr_work_cpu = idx;
 	thp->work_cnt++;
 	unlock_thread(thp);
+	spin_unlock(&qcnt_lock);
 
 	pr_debug("%s 0x%p assigned to cmpl status thread %s,%u.\n",
 		descq->conf.name, descq, thp->name, thp->work_cnt);
+}
 
-	lock_descq(descq);
-	descq->cmplthp = thp;
-	unlock_descq(descq);
+void qdma_threads_rebalance_interval(unsigned int interval_ms)
+{
+	unsigned int prev = xchg(&rebal_interval_ms, interval_ms);
+
+	if (!thread_cnt)
+		return;
+	if (interval_ms && !prev)
+		schedule_delayed_work(&rebal_work,
+				msecs_to_jiffies(interval_ms));
+	else if (!interval_ms && prev)
+		cancel_delayed_work_sync(&rebal_work);
 }
 
-int qdma_threads_create(unsigned int num_threads)
+int qdma_threads_dump(char *buf, int buflen)
+{
+	char *cur = buf;
+	char *const end = buf + buflen;
+	int i;
+
+	for (i = 0; i < thread_cnt && cur < end; i++)
+		cur += qdma_kthread_dump(cs_threads + i, cur, end - cur, 0);
+
+	spin_lock(&qcnt_lock);
+	for (i = 0; per_cpu_qcnt && i < cpu_count && cur < end; i++)
+		cur += snprintf(cur, end - cur,
+				"intr work cpu %d, node %d, queues %u.\n",
+				i, cpu_to_node(i), per_cpu_qcnt[i]);
+	spin_unlock(&qcnt_lock);
+
+	return min_t(int, cur - buf, buflen);
+}
+
+int qdma_threads_create(unsigned int num_threads, const char *cpulist)
 {
 	struct qdma_kthread *thp;
+	cpumask_var_t cpus;
+	unsigned int cpu;
 	int i;
 	int rv;
 
@@ -179,18 +465,43 @@ int qdma_threads_create(unsigned int num_threads)
 	per_cpu_qcnt = kzalloc(cpu_count * sizeof(unsigned int), GFP_KERNEL);
 	if (!per_cpu_qcnt)
 		return -ENOMEM;
+	per_cpu_qlist = kcalloc(cpu_count, sizeof(struct list_head),
+				GFP_KERNEL);
+	if (!per_cpu_qlist)
+		return -ENOMEM;
+	for (i = 0; i < cpu_count; i++)
+		INIT_LIST_HEAD(per_cpu_qlist + i);
+	INIT_DELAYED_WORK(&rebal_work, qdma_threads_rebalance);
+
+	/* the threads are spread over the given cpus, all online by default */
+	if (!zalloc_cpumask_var(&cpus, GFP_KERNEL))
+		return -ENOMEM;
+	if (cpulist && *cpulist) {
+		rv = cpulist_parse(cpulist, cpus);
+		if (rv < 0)
+			pr_warn("bad thread cpu list %s, %d.\n", cpulist, rv);
+		cpumask_and(cpus, cpus, cpu_online_mask);
+	}
+	if (cpumask_empty(cpus))
+		cpumask_copy(cpus, cpu_online_mask);
 
-	thread_cnt = (num_threads == 0) ? cpu_count : num_threads;
+	thread_cnt = (num_threads == 0) ? cpumask_weight(cpus) : num_threads;
 
 	cs_threads = kzalloc(thread_cnt * sizeof(struct qdma_kthread),
 					GFP_KERNEL);
-	if (!cs_threads)
+	if (!cs_threads) {
+		free_cpumask_var(cpus);
 		return -ENOMEM;
+	}
 
 	/* N dma writeback monitoring threads */
 	thp = cs_threads;
+	cpu = cpumask_first(cpus);
 	for (i = 0; i < thread_cnt; i++, thp++) {
-		thp->cpu = i;
+		thp->cpu = cpu;
+		cpu = cpumask_next(cpu, cpus);
+		if (cpu >= nr_cpu_ids)
+			cpu = cpumask_first(cpus);
 		thp->timeout = 0;
 		rv = qdma_kthread_start(thp, "qdma_cmpl_status_th", i);
 		if (rv < 0)
@@ -199,9 +510,11 @@ int qdma_threads_create(unsigned int num_threads)
 		thp->fpending = qdma_thread_cmpl_status_pend;
 	}
 
+	free_cpumask_var(cpus);
 	return 0;
 
 cleanup_threads:
+	free_cpumask_var(cpus);
 	kfree(cs_threads);
 	cs_threads = NULL;
 	thread_cnt = 0;
@@ -215,9 +528,14 @@ void qdma_threads_destroy(void)
 	struct qdma_kthread *thp;
 
 	if (per_cpu_qcnt) {
+		rebal_interval_ms = 0;
+		cancel_delayed_work_sync(&rebal_work);
+
 		spin_lock(&qcnt_lock);
 		kfree(per_cpu_qcnt);
 		per_cpu_qcnt = NULL;
+		kfree(per_cpu_qlist);
+		per_cpu_qlist = NULL;
 		spin_unlock(&qcnt_lock);
 	}
 
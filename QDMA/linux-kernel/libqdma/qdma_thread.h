@@ -38,11 +38,25 @@ struct qdma_descq;
  * 2: queue completion handler thread
  *
  * @param[in] num_threads - number of threads to be created
+ * @param[in] cpulist - cpu list the threads are bound to, round robin,
+ *			all online cpus when NULL or empty
  *
  * @return	0: success
  * @return	<0: failure
  *****************************************************************************/
-int qdma_threads_create(unsigned int num_threads);
+int qdma_threads_create(unsigned int num_threads, const char *cpulist);
+
+/*****************************************************************************/
+/**
+ * qdma_threads_dump() - dump the completion threads and the interrupt work
+ *	cpus with their numa node and queue count
+ *
+ * @param[in] buf - buffer to dump into
+ * @param[in] buflen - buffer length
+ *
+ * @return	length of the dump
+ *****************************************************************************/
+int qdma_threads_dump(char *buf, int buflen);
 
 /*****************************************************************************/
 /**
@@ -53,6 +67,18 @@ int qdma_threads_create(unsigned int num_threads);
  *****************************************************************************/
 void qdma_threads_destroy(void);
 
+/*****************************************************************************/
+/**
+ * qdma_threads_rebalance_interval() - set the interval of the periodic
+ *	queue rebalancing across the completion threads (poll mode) and the
+ *	interrupt work cpus (interrupt mode)
+ *
+ * @param[in] interval_ms - rebalancing interval in ms, 0 to disable
+ *
+ * @return	none
+ *****************************************************************************/
+void qdma_threads_rebalance_interval(unsigned int interval_ms);
+
 /*****************************************************************************/
 /**
  * qdma_thread_remove_work() - handler to remove the attached work thread
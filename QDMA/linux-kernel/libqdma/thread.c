@@ -35,8 +35,9 @@ int qdma_kthread_dump(struct qdma_kthread *thp, char *buf, int buflen,
 		return 0;
 
 	lock_thread(thp);
-	len = snprintf(buf, buflen, "%s, cpu %u, work %u.\n",
-			thp->name, thp->cpu, thp->work_cnt);
+	len = snprintf(buf, buflen, "%s, cpu %u, node %d, work %u.\n",
+			thp->name, thp->cpu, cpu_to_node(thp->cpu),
+			thp->work_cnt);
 
 	if (detail)
 		;
@@ -84,6 +84,10 @@ enum qdma_pf_devices {
  * maximum size of a single DMA transfer descriptor
  */
 #define QDMA_DESC_BLEN_MAX	((1 << (QDMA_DESC_BLEN_BITS)) - 1)
+/**
+ * maximum size of a ST H2C descriptor, the 16 bit length in whole 4K units
+ */
+#define QDMA_ST_H2C_DESC_LEN_MAX	0xF000
 
 /**
  * obtain the 32 most significant (high) bits of a 32-bit or 64-bit address
@@ -134,6 +138,22 @@ struct intr_coal_conf {
 	u8 color;
 	/**< Interrupt cidx info to be written to INTR CIDX register */
 	struct qdma_intr_cidx_reg_info intr_cidx_info;
+	/**< serializes the ring walks of the vector handler and of work */
+	spinlock_t lock;
+	/**< continues the ring walk once a pass ran out of budget */
+	struct work_struct work;
+	/**< set under lock at teardown, no more passes nor work queued */
+	bool shutdown;
+	/**< device of the ring */
+	struct xlnx_dma_dev *xdev;
+	/**< # of ring walk passes */
+	unsigned long pass_cnt;
+	/**< # of ring entries consumed */
+	unsigned long entry_cnt;
+	/**< # of entries of a queue already seen in the same pass */
+	unsigned long dup_cnt;
+	/**< # of passes stopped by the budget */
+	unsigned long budget_cnt;
 };
 
 /**
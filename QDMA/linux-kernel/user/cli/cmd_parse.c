@@ -66,7 +66,9 @@ static const char *progname;
 					XNL_F_QMODE_MM | \
 					XNL_F_QDIR_C2H)
 #define Q_H2C_FLAG_IGNORE_MASK  (XNL_F_C2H_CMPL_INTR_EN | \
-				XNL_F_CMPL_UDD_EN)
+				XNL_F_CMPL_UDD_EN | \
+				XNL_F_C2H_ZEROCOPY | \
+				XNL_F_C2H_ADAPTIVE_CMPL)
 
 #define Q_CMPT_READ_FLAG_IGNORE_MASK  ~(XNL_F_QMODE_ST | \
 					XNL_F_QMODE_MM | \
@@ -191,6 +193,9 @@ char *qdma_err_str[qdma_errs] = {
 static void __attribute__((noreturn)) usage(FILE *fp)
 {
 	fprintf(fp, "Usage: %s [dev|qdma[vf]<N>] [operation] \n", progname);
+	fprintf(fp, "       %s -f <file|->: run the commands of a file or stdin, one per line\n"
+		"\t\twithout the program name, over one netlink session\n",
+		progname);
 	fprintf(fp, "\tdev [operation]: system wide FPGA operations\n");
 	fprintf(fp, 
 		"\t\tlist                    list all qdma functions\n");
@@ -209,12 +214,15 @@ static void __attribute__((noreturn)) usage(FILE *fp)
 		"                                    [idx_cntr <0:15>] [trigmode <every|usr_cnt|usr|usr_tmr|dis>] [cmptsz <0|1|2|3>] [sw_desc_sz <3>]\n"
 	        "                                    [desc_bypass_en] [pfetch_en] [pfetch_bypass_en] [dis_cmpl_status]\n"
 	        "                                    [dis_cmpl_status_acc] [dis_cmpl_status_pend_chk] [c2h_udd_en]\n"
-	        "                                    [cmpl_ovf_dis] [dis_fetch_credit] [dis_cmpl_status] [c2h_cmpl_intr_en] - start a single queue\n"
+	        "                                    [cmpl_ovf_dis] [dis_fetch_credit] [dis_cmpl_status] [c2h_cmpl_intr_en]\n"
+	        "                                    [c2h_zerocopy] [c2h_adaptive_cmpl] [cmpl_poll] - start a single queue\n"
 	        "\t\tq start list <start_idx> <num_Qs> [en_mm_cmpl] [dir <h2c|c2h|bi>] [idx_bufsz <0:15>] [idx_tmr <0:15>]\n"
 		"                                    [idx_cntr <0:15>] [trigmode <every|usr_cnt|usr|usr_tmr|dis>] [cmptsz <0|1|2|3>] [sw_desc_sz <3>]\n"
 	        "                                    [desc_bypass_en] [pfetch_en] [pfetch_bypass_en] [dis_cmpl_status]\n"
 	        "                                    [dis_cmpl_status_acc] [dis_cmpl_status_pend_chk] [cmpl_ovf_dis]\n"
-	        "                                    [dis_fetch_credit] [dis_cmpl_status] [c2h_cmpl_intr_en] - start multiple queues at once\n"
+	        "                                    [dis_fetch_credit] [dis_cmpl_status] [c2h_cmpl_intr_en] [c2h_zerocopy]\n"
+	        "                                    [c2h_adaptive_cmpl] [cmpl_poll]\n"
+	        "                                    - start multiple queues at once\n"
 	        "\t\tq stop idx <N> dir [<h2c|c2h|bi>] - stop a single queue\n"
 	        "\t\tq stop list <start_idx> <num_Qs> dir [<h2c|c2h|bi>] - stop list of queues at once\n"
 	        "\t\tq del idx <N> dir [<h2c|c2h|bi>] - delete a queue\n"
@@ -505,7 +513,6 @@ static char *qflag_type_str[MAX_QFLAGS] = {
 	"pfetch_en",
 	"bypass",
 	"fetch_credit",
-	"dis_fetch_credit",
 	"dis_cmpl_status_acc",
 	"dis_cmpl_status",
 	"dis_cmpl_status_pend_chk",
@@ -514,7 +521,10 @@ static char *qflag_type_str[MAX_QFLAGS] = {
 	"c2h_udd_en",
 	"pftch_bypass_en",
 	"cmpl_ovf_dis",
-	"en_mm_cmpl"
+	"en_mm_cmpl",
+	"c2h_zerocopy",
+	"c2h_adaptive_cmpl",
+	"cmpl_poll"
 };
 
 #define IS_SIZE_IDX_VALID(x) (x < 16)
@@ -962,6 +972,15 @@ static int read_qparm(int argc, char *argv[], int i, struct xcmd_q_parm *qparm,
 		} else if (!strcmp(argv[i], "en_mm_cmpl")) {
 			qparm->flags |= XNL_F_EN_MM_CMPL;
 			i++;
+		} else if (!strcmp(argv[i], "c2h_zerocopy")) {
+			qparm->flags |= XNL_F_C2H_ZEROCOPY;
+			i++;
+		} else if (!strcmp(argv[i], "c2h_adaptive_cmpl")) {
+			qparm->flags |= XNL_F_C2H_ADAPTIVE_CMPL;
+			i++;
+		} else if (!strcmp(argv[i], "cmpl_poll")) {
+			qparm->flags |= XNL_F_CMPL_POLL;
+			i++;
 		} else {
 			warnx("unknown q parameter %s.\n", argv[i]);
 			return -EINVAL;
@@ -11,6 +11,7 @@
 
 #include <string.h>
 #include <stdio.h>
+#include <errno.h>
 
 #include "nl_user.h"
 #include "cmd_parse.h"
@@ -29,6 +30,277 @@ static void dump_dev_info(struct xcmd_info *xcmd)
 	printf("Mailbox enabled                        : %s\n", xcmd->u.cap.mailbox_en ? "yes":"no");
 	printf("MM completion enabled                  : %s\n\n", xcmd->u.cap.mm_cmpt_en ? "yes":"no");
 }
+
+/*
+ * script mode: the commands are read one per line from a file or stdin and
+ * sent over the same netlink sockets. The consecutive q add/start/stop/del
+ * of a device are sent as XNL_CMD_Q_BATCH messages.
+ */
+#define SCRIPT_LINE_MAX		1024
+#define SCRIPT_ARGS_MAX		64
+
+/* q start parameters not carried in struct xnl_q_batch_op */
+#define QPARM_BATCH_UNSUPP_MASK	((1 << QPARM_PIPE_GL_MAX) | \
+				 (1 << QPARM_PIPE_FLOW_ID) | \
+				 (1 << QPARM_PIPE_SLR_ID) | \
+				 (1 << QPARM_PIPE_TDEST))
+
+struct script_session {
+	struct xnl_cb cb[2];		/* pf, vf */
+	unsigned char connected[2];
+	/* device of the last XNL_CMD_DEV_INFO */
+	unsigned char dev_valid;
+	unsigned char dev_vf;
+	uint32_t dev_bdf;
+	/* pending batch */
+	struct xcmd_info batch_xcmd;
+	struct xnl_q_batch_op ops[XNL_Q_BATCH_OPS_MAX];
+	unsigned int lines[XNL_Q_BATCH_OPS_MAX];
+	unsigned int nr;
+};
+
+static struct xnl_cb *session_connect(struct script_session *ss, int vf)
+{
+	if (!ss->connected[vf]) {
+		memset(&ss->cb[vf], 0, sizeof(struct xnl_cb));
+		if (xnl_connect(&ss->cb[vf], vf) < 0)
+			return NULL;
+		ss->connected[vf] = 1;
+	}
+	return &ss->cb[vf];
+}
+
+/* the target device info is queried once per device switch */
+static struct xnl_cb *session_dev_get(struct script_session *ss,
+				struct xcmd_info *xcmd)
+{
+	struct xnl_cb *cb = session_connect(ss, xcmd->vf);
+	unsigned char op;
+	int rv;
+
+	if (!cb)
+		return NULL;
+	if (ss->dev_valid && ss->dev_vf == xcmd->vf &&
+	    ss->dev_bdf == xcmd->if_bdf)
+		return cb;
+
+	op = xcmd->op;
+	xcmd->op = XNL_CMD_DEV_INFO;
+	rv = xnl_send_cmd(cb, xcmd);
+	xcmd->op = op;
+	if (rv < 0) {
+		ss->dev_valid = 0;
+		return NULL;
+	}
+	ss->dev_valid = 1;
+	ss->dev_vf = xcmd->vf;
+	ss->dev_bdf = xcmd->if_bdf;
+
+	return cb;
+}
+
+static int session_flush(struct script_session *ss)
+{
+	struct xnl_cb *cb;
+	unsigned int nr = ss->nr;
+	int rv;
+
+	if (!nr)
+		return 0;
+	ss->nr = 0;
+
+	cb = session_dev_get(ss, &ss->batch_xcmd);
+	rv = cb ? xnl_send_q_batch(cb, &ss->batch_xcmd, ss->ops, nr) : -EINVAL;
+	if (rv < 0) {
+		fprintf(stderr, "line %u ~ %u: batch failed %d.\n",
+			ss->lines[0], ss->lines[nr - 1], rv);
+		return rv;
+	}
+	if ((unsigned int)rv < nr) {
+		fprintf(stderr, "line %u: %s failed.\n", ss->lines[rv],
+			xnl_op_str[ss->ops[rv].op]);
+		return -EIO;
+	}
+
+	return 0;
+}
+
+static int session_batch_add(struct script_session *ss,
+			struct xcmd_info *xcmd, unsigned int line)
+{
+	struct xcmd_q_parm *qparm = &xcmd->u.qparm;
+	struct xnl_q_batch_op *op;
+	int rv;
+
+	if (ss->nr && (ss->nr == XNL_Q_BATCH_OPS_MAX ||
+		       ss->batch_xcmd.vf != xcmd->vf ||
+		       ss->batch_xcmd.if_bdf != xcmd->if_bdf)) {
+		rv = session_flush(ss);
+		if (rv < 0)
+			return rv;
+	}
+	if (!ss->nr)
+		memcpy(&ss->batch_xcmd, xcmd, sizeof(struct xcmd_info));
+
+	op = &ss->ops[ss->nr];
+	memset(op, 0, sizeof(struct xnl_q_batch_op));
+	op->op = xcmd->op;
+	op->qflag = qparm->flags;
+	op->qidx = qparm->idx;
+	op->num_q = qparm->num_q;
+	if (xcmd->op == XNL_CMD_Q_START) {
+		if (qparm->sflags & (1 << QPARM_RNGSZ_IDX)) {
+			op->sflags |= XNL_Q_BATCH_S_RNGSZ_IDX;
+			op->qrngsz_idx = qparm->qrngsz_idx;
+		}
+		if (qparm->sflags & (1 << QPARM_C2H_BUFSZ_IDX)) {
+			op->sflags |= XNL_Q_BATCH_S_C2H_BUFSZ_IDX;
+			op->c2h_bufsz_idx = qparm->c2h_bufsz_idx;
+		}
+		if (qparm->sflags & (1 << QPARM_CMPT_TMR_IDX)) {
+			op->sflags |= XNL_Q_BATCH_S_CMPT_TMR_IDX;
+			op->cmpt_tmr_idx = qparm->cmpt_tmr_idx;
+		}
+		if (qparm->sflags & (1 << QPARM_CMPT_CNTR_IDX)) {
+			op->sflags |= XNL_Q_BATCH_S_CMPT_CNTR_IDX;
+			op->cmpt_cntr_idx = qparm->cmpt_cntr_idx;
+		}
+		if (qparm->sflags & (1 << QPARM_CMPT_TRIG_MODE)) {
+			op->sflags |= XNL_Q_BATCH_S_CMPT_TRIG_MODE;
+			op->cmpt_trig_mode = qparm->cmpt_trig_mode;
+		}
+		if (qparm->sflags & (1 << QPARM_CMPTSZ)) {
+			op->sflags |= XNL_Q_BATCH_S_CMPT_DESC_SIZE;
+			op->cmpt_desc_sz = qparm->cmpt_entry_size;
+		}
+		if (qparm->sflags & (1 << QPARM_SW_DESC_SZ)) {
+			op->sflags |= XNL_Q_BATCH_S_SW_DESC_SIZE;
+			op->sw_desc_sz = qparm->sw_desc_sz;
+		}
+	}
+	ss->lines[ss->nr++] = line;
+
+	return 0;
+}
+
+static int session_cmd(struct script_session *ss, struct xcmd_info *xcmd,
+			unsigned int line)
+{
+	struct xnl_cb *cb;
+	int vf;
+	int rv;
+
+	switch (xcmd->op) {
+	case XNL_CMD_Q_START:
+		if (xcmd->u.qparm.sflags & QPARM_BATCH_UNSUPP_MASK)
+			break;
+		/* fall through */
+	case XNL_CMD_Q_ADD:
+	case XNL_CMD_Q_STOP:
+	case XNL_CMD_Q_DEL:
+		return session_batch_add(ss, xcmd, line);
+	default:
+		break;
+	}
+
+	/* keep the order of the commands */
+	rv = session_flush(ss);
+	if (rv < 0)
+		return rv;
+
+	if (xcmd->op == XNL_CMD_DEV_LIST) {
+		for (vf = 0; vf < 2; vf++) {
+			cb = session_connect(ss, vf);
+			if (cb)
+				xnl_send_cmd(cb, xcmd);
+		}
+		return 0;
+	} else if ((xcmd->op == XNL_CMD_REG_DUMP) ||
+			(xcmd->op == XNL_CMD_REG_RD) ||
+			(xcmd->op == XNL_CMD_REG_WRT)) {
+		return proc_reg_cmd(xcmd);
+	}
+
+	cb = session_dev_get(ss, xcmd);
+	if (!cb)
+		return -EINVAL;
+	rv = xnl_send_cmd(cb, xcmd);
+	if (rv < 0)
+		return rv;
+	if (xcmd->op == XNL_CMD_DEV_CAP)
+		dump_dev_info(xcmd);
+
+	return 0;
+}
+
+static int run_script(char *progname, char *fname)
+{
+	static struct script_session ss;
+	struct xcmd_info xcmd;
+	char line[SCRIPT_LINE_MAX];
+	char *args[SCRIPT_ARGS_MAX];
+	unsigned int lineno = 0;
+	FILE *fp = stdin;
+	int rv = 0;
+	int rv2;
+	int vf;
+
+	if (strcmp(fname, "-")) {
+		fp = fopen(fname, "r");
+		if (!fp) {
+			perror(fname);
+			return -errno;
+		}
+	}
+
+	args[0] = progname;
+	while (fgets(line, SCRIPT_LINE_MAX, fp)) {
+		char *save;
+		char *tok;
+		int argc = 1;
+
+		lineno++;
+		/* blank lines and '#' comments are skipped */
+		tok = strtok_r(line, " \t\r\n", &save);
+		while (tok && tok[0] != '#' && argc < SCRIPT_ARGS_MAX) {
+			args[argc++] = tok;
+			tok = strtok_r(NULL, " \t\r\n", &save);
+		}
+		if (tok && tok[0] != '#') {
+			fprintf(stderr, "line %u: too many parameters.\n",
+				lineno);
+			rv = -EINVAL;
+			break;
+		}
+		if (argc == 1)
+			continue;
+
+		rv = parse_cmd(argc, args, &xcmd);
+		if (rv < 0) {
+			fprintf(stderr, "line %u: invalid command.\n", lineno);
+			break;
+		}
+		rv = session_cmd(&ss, &xcmd, lineno);
+		if (rv < 0) {
+			fprintf(stderr, "line %u: failed %d.\n", lineno, rv);
+			break;
+		}
+	}
+	/* the batched commands before a failing line still run */
+	rv2 = session_flush(&ss);
+	if (rv >= 0)
+		rv = rv2;
+
+	for (vf = 0; vf < 2; vf++) {
+		if (ss.connected[vf])
+			xnl_close(&ss.cb[vf]);
+	}
+	if (fp != stdin)
+		fclose(fp);
+
+	return rv;
+}
+
 int main(int argc, char *argv[])
 {
 	struct xnl_cb cb;
@@ -38,6 +310,9 @@ int main(int argc, char *argv[])
 
 	memset(&xcmd, 0, sizeof(xcmd));
 
+	if (argc == 3 && !strcmp(argv[1], "-f"))
+		return run_script(argv[0], argv[2]);
+
 	rv = parse_cmd(argc, argv, &xcmd);
 	if (rv < 0)
 		return rv;
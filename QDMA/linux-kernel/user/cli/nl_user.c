@@ -68,6 +68,22 @@ static int xnl_send(struct xnl_cb *cb, struct xnl_hdr *hdr)
 	return 0;
 }
 
+/*
+ * replies left over from the previous requests of the session, whatever
+ * their type: the handlers may fail after having replied, or reply twice
+ */
+static int xnl_msg_stale(struct xnl_cb *cb, struct xnl_hdr *hdr)
+{
+	unsigned int seq = cb->snd_seq - 1;	/* of the last request */
+
+	/* error acks and the controller echo the request sequence number */
+	if (hdr->n.nlmsg_type == NLMSG_ERROR ||
+	    hdr->n.nlmsg_type == GENL_ID_CTRL)
+		return hdr->n.nlmsg_seq != seq;
+	/* the driver replies with the request sequence number + 1 */
+	return hdr->n.nlmsg_seq != seq + 1;
+}
+
 static int xnl_recv(struct xnl_cb *cb, struct xnl_hdr *hdr, int dlen, int print)
 {
 	int rv;
@@ -75,13 +91,15 @@ static int xnl_recv(struct xnl_cb *cb, struct xnl_hdr *hdr, int dlen, int print)
 		.nl_family = AF_NETLINK,
 	};
 
-	memset(hdr, 0, sizeof(struct xnl_gen_msg) + dlen);
+	do {
+		memset(hdr, 0, sizeof(struct xnl_gen_msg) + dlen);
 
-	rv = recv(cb->fd, hdr, dlen, 0);
-	if (rv < 0) {
-		perror("nl recv err");
-		return -1;
-	}
+		rv = recv(cb->fd, hdr, dlen, 0);
+		if (rv < 0) {
+			perror("nl recv err");
+			return -1;
+		}
+	} while (rv >= NLMSG_HDRLEN && xnl_msg_stale(cb, hdr));
 	/* as long as there is attribute, even if it is shorter than expected */
 	if (!NLMSG_OK((&hdr->n), rv) && (rv <= sizeof(struct xnl_hdr))) {
 		if (print)
@@ -247,6 +265,20 @@ static int xnl_msg_add_str_attr(struct xnl_hdr *hdr, enum xnl_attr_t type,
 	return 0;
 }
 
+static int xnl_msg_add_data_attr(struct xnl_hdr *hdr, enum xnl_attr_t type,
+				void *data, unsigned int len)
+{
+	struct nlattr *attr = (struct nlattr *)((char *)hdr + hdr->n.nlmsg_len);
+
+	attr->nla_type = (__u16)type;
+	attr->nla_len = len + NLA_HDRLEN;
+
+	memcpy(attr + 1, data, len);
+
+	hdr->n.nlmsg_len += NLMSG_ALIGN(attr->nla_len);
+	return 0;
+}
+
 static int recv_attrs(struct xnl_hdr *hdr, struct xcmd_info *xcmd)
 {
 	unsigned char *p = (unsigned char *)(hdr + 1);
@@ -600,3 +632,49 @@ out:
 	free(msg);
 	return rv;
 }
+
+int xnl_send_q_batch(struct xnl_cb *cb, struct xcmd_info *xcmd,
+			struct xnl_q_batch_op *ops, unsigned int nr)
+{
+	struct xnl_gen_msg *msg;
+	struct xnl_hdr *hdr;
+	/* one line of result per operation */
+	int dlen = XNL_RESP_BUFLEN_MIN * (nr + 1);
+	int rv;
+
+	if (!nr || nr > XNL_Q_BATCH_OPS_MAX)
+		return -EINVAL;
+
+	msg = xnl_msg_alloc(dlen);
+	if (!msg) {
+		fprintf(stderr, "%s: OOM, %s, %u ops.\n", __FUNCTION__,
+			xcmd->ifname, nr);
+		return -ENOMEM;
+	}
+	hdr = (struct xnl_hdr *)msg;
+
+	xnl_msg_set_hdr(hdr, cb->family, XNL_CMD_Q_BATCH);
+	xnl_msg_add_int_attr(hdr, XNL_ATTR_DEV_IDX, xcmd->if_bdf);
+	xnl_msg_add_int_attr(hdr, XNL_ATTR_RSP_BUF_LEN, dlen);
+	xnl_msg_add_data_attr(hdr, XNL_ATTR_Q_BATCH, ops,
+			      nr * sizeof(struct xnl_q_batch_op));
+	xcmd->attrs[XNL_ATTR_Q_BATCH] = 0;
+
+	rv = xnl_send(cb, hdr);
+	if (rv < 0)
+		goto out;
+
+	rv = xnl_recv(cb, hdr, dlen, 1);
+	if (rv < 0)
+		goto out;
+
+	rv = recv_nl_msg(hdr, xcmd);
+	if (rv < 0)
+		goto out;
+
+	/* # of operations done */
+	rv = xcmd->attrs[XNL_ATTR_Q_BATCH];
+out:
+	free(msg);
+	return rv;
+}
@@ -105,4 +105,9 @@ int xnl_connect(struct xnl_cb *cb, int vf);
 void xnl_close(struct xnl_cb *cb);
 int xnl_send_cmd(struct xnl_cb *cb, struct xcmd_info *xcmd);
 
+struct xnl_q_batch_op;
+/* returns the # of operations done, the result text is printed */
+int xnl_send_q_batch(struct xnl_cb *cb, struct xcmd_info *xcmd,
+			struct xnl_q_batch_op *ops, unsigned int nr);
+
 #endif /* ifndef __NL_USER_H__ */
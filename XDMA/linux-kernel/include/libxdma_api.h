@@ -132,6 +132,27 @@ int xdma_user_isr_disable(void *dev_hndl, unsigned int mask);
  */
 ssize_t xdma_xfer_submit(void *dev_hndl, int channel, bool write, u64 ep_addr,
 			struct sg_table *sgt, bool dma_mapped, int timeout_ms);
+
+/*
+ * xdma_xfer_submit_regions - same as xdma_xfer_submit(), but the end point
+ *	side is an explicit list of (ep_addr, len) regions instead of one
+ *	contiguous range starting at ep_addr. The host sg list is consumed in
+ *	order and must be exactly as long as all regions together.
+ *	A 2D (base, row length, stride, rows) window is the region list
+ *	{ base + i * stride, row length } for i < rows.
+ *	AXI-MM engines in incremental address mode only.
+ * @regions: end point regions, in transfer order
+ * @nr_regions: # of entries in regions
+ */
+struct xdma_ep_region {
+	u64 ep_addr;
+	u64 len;
+};
+
+ssize_t xdma_xfer_submit_regions(void *dev_hndl, int channel, bool write,
+			const struct xdma_ep_region *regions,
+			unsigned int nr_regions, struct sg_table *sgt,
+			bool dma_mapped, int timeout_ms);
 			
 
 /////////////////////missing API////////////////////
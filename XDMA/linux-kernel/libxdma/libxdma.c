@@ -26,11 +26,18 @@
 #include <linux/errno.h>
 #include <linux/sched.h>
 #include <linux/vmalloc.h>
+#include <linux/delay.h>
+#include <linux/math64.h>
+#include <linux/async.h>
+#include <linux/ktime.h>
 
 #include "libxdma.h"
 #include "libxdma_api.h"
 #include "cdev_sgdma.h"
 
+#define CREATE_TRACE_POINTS
+#include "xdma_trace.h"
+
 /* SECTION: Module licensing */
 
 #ifdef __LIBXDMA_MOD__
@@ -65,6 +72,22 @@ unsigned int desc_blen_max = XDMA_DESC_BLEN_MAX;
 module_param(desc_blen_max, uint, 0644);
 MODULE_PARM_DESC(desc_blen_max, "per descriptor max. buffer length, default is (1 << 28) - 1");
 
+static unsigned int rq_sched = XDMA_RQ_SCHED_FIFO;
+module_param(rq_sched, uint, 0644);
+MODULE_PARM_DESC(rq_sched, "engine request dispatch, 0 - fifo, 1 - deadline (card address order until the oldest request expires), default is 0");
+
+static unsigned int rq_expire_ms = 50;
+module_param(rq_expire_ms, uint, 0644);
+MODULE_PARM_DESC(rq_expire_ms, "deadline dispatch, max. time in ms a request waits before it is served in order, default is 50");
+
+static unsigned int rq_merge = 1;
+module_param(rq_merge, uint, 0644);
+MODULE_PARM_DESC(rq_merge, "Set 0 to disable merging of queued requests with contiguous card addresses, default is 1");
+
+static unsigned int engine_init_async = 1;
+module_param(engine_init_async, uint, 0644);
+MODULE_PARM_DESC(engine_init_async, "Set 0 to initialize the engines of a device one after the other, default is 1 (in parallel)");
+
 /*
  * xdma device management
  * maintains a list of the xdma devices
@@ -1173,6 +1196,8 @@ static int engine_service(struct xdma_engine *engine, int desc_writeback)
 	return 0;
 }
 
+static int engine_service_frame(struct xdma_engine *engine);
+
 /* engine_service_work */
 static void engine_service_work(struct work_struct *work)
 {
@@ -1189,6 +1214,8 @@ static void engine_service_work(struct work_struct *work)
 		engine->name, engine);
 	if (engine->cyclic_req)
                 engine_service_cyclic(engine);
+	else if (engine->frame_ring)
+		engine_service_frame(engine);
 	else
 		engine_service(engine, 0);
 
@@ -2735,11 +2762,15 @@ err_out:
 	return -ENOMEM;
 }
 
-static int engine_init(struct xdma_engine *engine, struct xdma_dev *xdev,
-			int offset, enum dma_data_direction dir, int channel)
+/*
+ * engine_init() - book keeping part of the engine set up, in irq bit order.
+ * identifier is the value of the engine identifier register.
+ * The resources and registers are set up by engine_init_resource().
+ */
+static void engine_init(struct xdma_engine *engine, struct xdma_dev *xdev,
+			int offset, enum dma_data_direction dir, int channel,
+			u32 identifier)
 {
-	int rv;
-	u32 val;
 
 	dbg_init("channel %d, offset 0x%x, dir %d.\n", channel, offset, dir);
 
@@ -2759,8 +2790,7 @@ static int engine_init(struct xdma_engine *engine, struct xdma_dev *xdev,
 	engine->regs = (xdev->bar[xdev->config_bar_idx] + offset);
 	engine->sgdma_regs = xdev->bar[xdev->config_bar_idx] + offset +
 				SGDMA_OFFSET_FROM_CHANNEL;
-	val = read_register(&engine->regs->identifier);
-        if (val & 0x8000U)
+        if (identifier & 0x8000U)
 		engine->streaming = 1;
 
 	/* remember SG DMA direction */
@@ -2780,16 +2810,17 @@ static int engine_init(struct xdma_engine *engine, struct xdma_dev *xdev,
 	else
 		xdev->mask_irq_c2h |= engine->irq_bitmask;
 	xdev->engines_num++;
+}
 
-	rv = engine_alloc_resource(engine);
-	if (rv)
-		return rv;
+static int engine_init_resource(struct xdma_engine *engine)
+{
+	int rv;
 
-	rv = engine_init_regs(engine);
+	rv = engine_alloc_resource(engine);
 	if (rv)
 		return rv;
 
-	return 0;
+	return engine_init_regs(engine);
 }
 
 /* transfer_destroy() - free transfer */
@@ -2822,12 +2853,15 @@ static int transfer_build(struct xdma_engine *engine,
 			i + req->sw_desc_idx, req->sw_desc_cnt,
 			sdesc->addr, sdesc->len, req->ep_addr);
 
+		/* for non-inc-add mode don't increment ep_addr */
+		if (!engine->non_incr_addr)
+			req->ep_addr = sdesc->ep_addr;
+
 		/* fill in descriptor entry j with transfer details */
 		xdma_desc_set(xfer->desc_virt + j, sdesc->addr, req->ep_addr,
 				 sdesc->len, xfer->dir);
 		xfer->len += sdesc->len;
 
-		/* for non-inc-add mode don't increment ep_addr */
 		if (!engine->non_incr_addr)
 			req->ep_addr += sdesc->len;
 	}
@@ -2943,25 +2977,69 @@ static struct xdma_request_cb * xdma_request_alloc(unsigned int sdesc_nr)
 	return req;
 }
 
-static struct xdma_request_cb * xdma_init_request(struct sg_table *sgt,
-						u64 ep_addr)
+/*
+ * split the host sg list into sw descriptors: a descriptor never crosses a
+ * host sg entry, an end point region or desc_blen_max. Without regions the
+ * end point side is one range starting at ep_addr.
+ * Fills in sdesc, if given, and returns the number of descriptors needed.
+ */
+static unsigned int xdma_request_sdesc_fill(struct sg_table *sgt, u64 ep_addr,
+			const struct xdma_ep_region *regions,
+			unsigned int nr_regions, struct sw_desc *sdesc)
 {
-	struct xdma_request_cb *req;
 	struct scatterlist *sg = sgt->sgl;
-	int max = sgt->nents;
-	int extra = 0;
-	int i, j = 0;
+	unsigned int r = 0;
+	u64 rlen = regions ? 0 : U64_MAX;
+	u64 ep = ep_addr;
+	unsigned int i, j = 0;
+
+	for (i = 0; i < sgt->nents; i++, sg = sg_next(sg)) {
+		unsigned int tlen = sg_dma_len(sg);
+		dma_addr_t addr = sg_dma_address(sg);
 
-	for (i = 0;  i < max; i++, sg = sg_next(sg)) {
-		unsigned int len = sg_dma_len(sg);
+		while (tlen) {
+			unsigned int len;
+
+			/* on to the next end point region */
+			while (!rlen && r < nr_regions) {
+				ep = regions[r].ep_addr;
+				rlen = regions[r].len;
+				r++;
+			}
+			/* regions shorter than the sg list, checked by caller */
+			if (!rlen)
+				return j;
+
+			len = min_t(u64, min_t(u64, tlen, rlen), desc_blen_max);
+			if (sdesc) {
+				sdesc[j].addr = addr;
+				sdesc[j].len = len;
+				sdesc[j].ep_addr = ep;
+			}
+			j++;
 
-		if (unlikely(len > desc_blen_max))
-			extra += (len + desc_blen_max - 1) / desc_blen_max;
+			addr += len;
+			tlen -= len;
+			ep += len;
+			rlen -= len;
+		}
 	}
 
-//pr_info("ep 0x%llx, desc %u+%u.\n", ep_addr, max, extra);
+	return j;
+}
+
+static struct xdma_request_cb * xdma_init_request_regions(
+			struct sg_table *sgt, u64 ep_addr,
+			const struct xdma_ep_region *regions,
+			unsigned int nr_regions)
+{
+	struct xdma_request_cb *req;
+	struct scatterlist *sg = sgt->sgl;
+	unsigned int max;
+	int i;
+
+	max = xdma_request_sdesc_fill(sgt, ep_addr, regions, nr_regions, NULL);
 
-	max += extra;
 	req = xdma_request_alloc(max);
 	if (!req)
 		return NULL;
@@ -2969,108 +3047,83 @@ static struct xdma_request_cb * xdma_init_request(struct sg_table *sgt,
 	req->sgt = sgt;	
 	req->ep_addr = ep_addr;
 
-	for (i = 0, sg = sgt->sgl;  i < sgt->nents; i++, sg = sg_next(sg)) {
-		unsigned int tlen = sg_dma_len(sg);
-		dma_addr_t addr = sg_dma_address(sg);	
-
-		req->total_len += tlen;
-		while (tlen) {
-			req->sdesc[j].addr = addr;
-			if (tlen > desc_blen_max) {
-				req->sdesc[j].len = desc_blen_max;
-				addr += desc_blen_max;
-				tlen -= desc_blen_max;	
-			} else {
-				req->sdesc[j].len = tlen;
-				tlen = 0;
-			}
-			j++;
-		}
-	}
-	BUG_ON(j > max);
+	for (i = 0;  i < sgt->nents; i++, sg = sg_next(sg))
+		req->total_len += sg_dma_len(sg);
 
-	req->sw_desc_cnt = j;
+	req->sw_desc_cnt = xdma_request_sdesc_fill(sgt, ep_addr, regions,
+						nr_regions, req->sdesc);
+	BUG_ON(req->sw_desc_cnt > max);
 #ifdef __LIBXDMA_DEBUG__
 	xdma_request_cb_dump(req);
 #endif
 	return req;
 }
 
-ssize_t xdma_xfer_submit(void *dev_hndl, int channel, bool write, u64 ep_addr,
-			struct sg_table *sgt, bool dma_mapped, int timeout_ms)
+static struct xdma_request_cb * xdma_init_request(struct sg_table *sgt,
+						u64 ep_addr)
+{
+	return xdma_init_request_regions(sgt, ep_addr, NULL, 0);
+}
+
+/* regions must cover the host sg list exactly */
+static int xdma_regions_check(struct xdma_engine *engine,
+			struct sg_table *sgt,
+			const struct xdma_ep_region *regions,
+			unsigned int nr_regions)
 {
-	struct xdma_dev *xdev = (struct xdma_dev *)dev_hndl;
-	struct xdma_engine *engine;
-	int rv = 0;
-	ssize_t done = 0;
 	struct scatterlist *sg = sgt->sgl;
-	int nents;
-	enum dma_data_direction dir = write ? DMA_TO_DEVICE : DMA_FROM_DEVICE;
-	struct xdma_request_cb *req = NULL;
+	u64 sg_len = 0;
+	u64 ep_len = 0;
+	int i;
 
-	if (!dev_hndl)
+	if (engine->streaming || engine->non_incr_addr) {
+		pr_info("%s, ep regions need AXI-MM incremental addressing.\n",
+			engine->name);
 		return -EINVAL;
+	}
 
-	if (debug_check_dev_hndl(__func__, xdev->pdev, dev_hndl) < 0)
-		return -EINVAL;
+	for (i = 0; i < sgt->nents; i++, sg = sg_next(sg))
+		sg_len += sg_dma_len(sg);
+	for (i = 0; i < nr_regions; i++) {
+		u64 ep_end;
 
-	if (write == 1) {
-		if (channel >= xdev->h2c_channel_max) {
-			pr_warn("H2C channel %d >= %d.\n",
-				channel, xdev->h2c_channel_max);
-			return -EINVAL;
-		}
-		engine = &xdev->engine_h2c[channel];
-	} else if (write == 0) {
-		if (channel >= xdev->c2h_channel_max) {
-			pr_warn("C2H channel %d >= %d.\n",
-				channel, xdev->c2h_channel_max);
+		if (check_add_overflow(ep_len, regions[i].len, &ep_len) ||
+		    check_add_overflow(regions[i].ep_addr, regions[i].len,
+					&ep_end)) {
+			pr_info("%s, ep region %d len 0x%llx overflows.\n",
+				engine->name, i, regions[i].len);
 			return -EINVAL;
 		}
-		engine = &xdev->engine_c2h[channel];
-	} else {
-		pr_warn("write %d, exp. 0|1.\n", write);
-		return -EINVAL;
-	}
-
-        BUG_ON(!engine);
-        BUG_ON(engine->magic != MAGIC_ENGINE);
-
-	xdev = engine->xdev;
-	if (xdma_device_flag_check(xdev, XDEV_FLAG_OFFLINE)) {
-		pr_info("xdev 0x%p, offline.\n", xdev);
-		return -EBUSY;
 	}
 
-	/* check the direction */
-	if (engine->dir != dir) {
-		pr_info("0x%p, %s, %d, W %d, 0x%x/0x%x mismatch.\n",
-			engine, engine->name, channel, write, engine->dir, dir);
+	if (sg_len != ep_len) {
+		pr_info("%s, sg len %llu != ep regions len %llu.\n",
+			engine->name, sg_len, ep_len);
 		return -EINVAL;
 	}
 
-	if (!dma_mapped) {
-		nents = pci_map_sg(xdev->pdev, sg, sgt->orig_nents, dir);
-		if (!nents) {
-			pr_info("map sgl failed, sgt 0x%p.\n", sgt);
-			return -EIO;
-		}
-		sgt->nents = nents;
-	} else {
-		BUG_ON(!sgt->nents);
-	}
+	return 0;
+}
 
-	req = xdma_init_request(sgt, ep_addr);
-	if (!req) {
-		rv = -ENOMEM;
-		goto unmap_sgl;
-	}
+/*
+ * engine_request_run() - run a request through the engine, one transfer of
+ * up to XDMA_TRANSFER_MAX_DESC descriptors at a time.
+ * interruptible: a signal to the caller may end the wait, set only for a
+ * request of the caller alone; otherwise only timeout_ms ends it.
+ * Returns 0 or -errno, the number of bytes transferred goes to *done.
+ */
+static int engine_request_run(struct xdma_engine *engine,
+			struct xdma_request_cb *req, int timeout_ms,
+			bool interruptible, ssize_t *done)
+{
+	struct xdma_dev *xdev = engine->xdev;
+	int nents = req->sw_desc_cnt;
+	int rv = 0;
 
 	dbg_tfr("%s, len %u sg cnt %u.\n",
 		engine->name, req->total_len, req->sw_desc_cnt);
 
-	sg = sgt->sgl;
-	nents = req->sw_desc_cnt;
+	*done = 0;
 	while (nents) {
 		unsigned long flags;
 		struct xdma_transfer *xfer;
@@ -3078,26 +3131,29 @@ ssize_t xdma_xfer_submit(void *dev_hndl, int channel, bool write, u64 ep_addr,
 		/* one transfer at a time */
 		spin_lock(&engine->desc_lock);
 
+		/* engine (and its descriptors) owned by the frame grabber */
+		if (engine->frame_ring) {
+			spin_unlock(&engine->desc_lock);
+			return -EBUSY;
+		}
+
 		/* build transfer */	
 		rv = transfer_init(engine, req);
 		if (rv < 0) {
 			spin_unlock(&engine->desc_lock);
-			goto unmap_sgl;
+			return rv;
 		}
 		xfer = &req->xfer;
 
-		if (!dma_mapped)
-			xfer->flags = XFER_FLAG_NEED_UNMAP;
-
 		/* last transfer for the given request? */
 		nents -= xfer->desc_num;
 		if (!nents) {
 			xfer->last_in_request = 1;
-			xfer->sgt = sgt;
+			xfer->sgt = req->sgt;
 		}
 
 		dbg_tfr("xfer, %u, ep 0x%llx, done %lu, sg %u/%u.\n",
-			xfer->len, req->ep_addr, done, req->sw_desc_idx,
+			xfer->len, req->ep_addr, *done, req->sw_desc_idx,
 			req->sw_desc_cnt);
 
 #ifdef __LIBXDMA_DEBUG__
@@ -3108,7 +3164,7 @@ ssize_t xdma_xfer_submit(void *dev_hndl, int channel, bool write, u64 ep_addr,
 		if (rv < 0) {
 			spin_unlock(&engine->desc_lock);
 			pr_info("unable to submit %s, %d.\n", engine->name, rv);
-			goto unmap_sgl;
+			return rv;
 		}
 
 		/*
@@ -3123,7 +3179,7 @@ ssize_t xdma_xfer_submit(void *dev_hndl, int channel, bool write, u64 ep_addr,
 			dbg_tfr("%s poll desc_count=%d\n", engine->name, desc_count);
 			engine_service_poll(engine, desc_count);
 
-		} else {
+		} else if (interruptible) {
 #if	LINUX_VERSION_CODE >= KERNEL_VERSION(4,6,0)
 			swait_event_interruptible_timeout(xfer->wq,
 #else
@@ -3131,6 +3187,14 @@ ssize_t xdma_xfer_submit(void *dev_hndl, int channel, bool write, u64 ep_addr,
 #endif
                 	        (xfer->state != TRANSFER_STATE_SUBMITTED),
 				msecs_to_jiffies(timeout_ms));
+		} else {
+#if	LINUX_VERSION_CODE >= KERNEL_VERSION(4,6,0)
+			swait_event_timeout(xfer->wq,
+#else
+			wait_event_timeout(xfer->wq,
+#endif
+				(xfer->state != TRANSFER_STATE_SUBMITTED),
+				msecs_to_jiffies(timeout_ms));
 		}
 
 		spin_lock_irqsave(&engine->lock, flags);
@@ -3140,8 +3204,8 @@ ssize_t xdma_xfer_submit(void *dev_hndl, int channel, bool write, u64 ep_addr,
 			spin_unlock_irqrestore(&engine->lock, flags);
 
 			dbg_tfr("transfer %p, %u, ep 0x%llx compl, +%lu.\n",
-				xfer, xfer->len, req->ep_addr - xfer->len, done);
-			done += xfer->len;
+				xfer, xfer->len, req->ep_addr - xfer->len, *done);
+			*done += xfer->len;
 			rv = 0;
 			break;
 		case TRANSFER_STATE_FAILED:
@@ -3151,7 +3215,7 @@ ssize_t xdma_xfer_submit(void *dev_hndl, int channel, bool write, u64 ep_addr,
 
 #ifdef __LIBXDMA_DEBUG__
 			transfer_dump(xfer);
-			sgt_dump(sgt);
+			sgt_dump(req->sgt);
 #endif
 			rv = -EIO;
 			break;
@@ -3168,9 +3232,10 @@ ssize_t xdma_xfer_submit(void *dev_hndl, int channel, bool write, u64 ep_addr,
 
 #ifdef __LIBXDMA_DEBUG__
 			transfer_dump(xfer);
-			sgt_dump(sgt);
+			sgt_dump(req->sgt);
 #endif
-			rv = -ERESTARTSYS;
+			/* a signal can only have ended an interruptible wait */
+			rv = interruptible ? -ERESTARTSYS : -ETIMEDOUT;
 			break;
 		}
 
@@ -3178,112 +3243,499 @@ ssize_t xdma_xfer_submit(void *dev_hndl, int channel, bool write, u64 ep_addr,
 		spin_unlock(&engine->desc_lock);
 
 		if (rv < 0)
-			goto unmap_sgl;
+			return rv;
 	} /* while (sg) */
 
-unmap_sgl:
-	if (!dma_mapped && sgt->nents) {
-		pci_unmap_sg(xdev->pdev, sgt->sgl, sgt->orig_nents, dir);
-		sgt->nents = 0;
-	}
-
-	if (req)
-		xdma_request_free(req);
-
-	if (rv < 0)
-		return rv;
-
-	return done;
+	return 0;
 }
-EXPORT_SYMBOL_GPL(xdma_xfer_submit);
 
-int xdma_performance_submit(struct xdma_dev *xdev, struct xdma_engine *engine)
+/*
+ * per engine request queue
+ *
+ * Submitters queue their request on engine->rq and sleep. Whoever finds
+ * nobody dispatching becomes the dispatcher and runs batches on behalf of
+ * everybody until its own request is done, then hands over. A batch is the
+ * next request picked by rq_sched plus any queued requests whose card
+ * address range continues it at either end, run as a single request.
+ */
+static int rq_entry_mergeable(struct xdma_rq_entry *ent, u64 ep_start,
+			u64 ep_end, unsigned int desc_cnt, u64 len)
 {
-	u8 *buffer_virt;
-	u32 max_consistent_size = 128 * 32 * 1024; /* 1024 pages, 4MB */
-	dma_addr_t buffer_bus;	/* bus address */
-	struct xdma_transfer *transfer;
-	u64 ep_addr = 0;
-	int num_desc_in_a_loop = 128;
-	int size_in_desc = engine->xdma_perf->transfer_size;
-	int size = size_in_desc * num_desc_in_a_loop;
-	int i;
+	if (!ent->mergeable)
+		return 0;
+	if (desc_cnt + ent->req->sw_desc_cnt > XDMA_TRANSFER_MAX_DESC)
+		return 0;
+	if (len + ent->req->total_len > UINT_MAX)
+		return 0;
+	if (ent->ep_start == ep_end)
+		return 1;	/* back merge */
+	if (ent->ep_end == ep_start)
+		return -1;	/* front merge */
+	return 0;
+}
 
-	BUG_ON(size_in_desc > max_consistent_size);
+/* pick the next batch off the queue, called with rq->lock held */
+static void engine_rq_batch(struct xdma_engine *engine, struct list_head *batch)
+{
+	struct xdma_rq *rq = &engine->rq;
+	struct xdma_rq_entry *ent, *tmp, *first;
+	unsigned int desc_cnt;
+	u64 ep_start, ep_end;
+	u64 len;
+	int merged;
+
+	first = list_first_entry(&rq->queue, struct xdma_rq_entry, list);
+	if (rq_sched == XDMA_RQ_SCHED_DEADLINE && first->mergeable &&
+	    time_before(jiffies, first->deadline)) {
+		struct xdma_rq_entry *best = NULL;
+		struct xdma_rq_entry *lowest = first;
 
-	if (size > max_consistent_size) {
-		size = max_consistent_size;
-		num_desc_in_a_loop = size / size_in_desc;
+		/*
+		 * nothing expired, sweep up the card address space from where
+		 * the previous batch ended and wrap around
+		 */
+		list_for_each_entry(ent, &rq->queue, list) {
+			if (!ent->mergeable)
+				continue;
+			if (ent->ep_start < lowest->ep_start)
+				lowest = ent;
+			if (ent->ep_start >= rq->ep_pos &&
+			    (!best || ent->ep_start < best->ep_start))
+				best = ent;
+		}
+		first = best ? best : lowest;
+	} else if (rq_sched == XDMA_RQ_SCHED_DEADLINE && first->mergeable) {
+		rq->stats.expired++;
 	}
 
-	buffer_virt = dma_alloc_coherent(&xdev->pdev->dev, size,
-					&buffer_bus, GFP_KERNEL);
+	list_move_tail(&first->list, batch);
+	rq->stats.depth--;
 
-	/* allocate transfer data structure */
-	transfer = kzalloc(sizeof(struct xdma_transfer), GFP_KERNEL);
-	BUG_ON(!transfer);
+	ep_start = first->ep_start;
+	ep_end = first->ep_end;
+	desc_cnt = first->req->sw_desc_cnt;
+	len = first->req->total_len;
 
-	/* 0 = write engine (to_dev=0) , 1 = read engine (to_dev=1) */
-	transfer->dir = engine->dir;
-	/* set number of descriptors */
-	transfer->desc_num = num_desc_in_a_loop;
+	if (!rq_merge || !first->mergeable)
+		goto out;
 
-	/* allocate descriptor list */
-	if (!engine->desc) {
-		engine->desc = dma_alloc_coherent(&xdev->pdev->dev,
-			num_desc_in_a_loop * sizeof(struct xdma_desc),
-			&engine->desc_bus, GFP_KERNEL);
-		BUG_ON(!engine->desc);
-		dbg_init("device %s, engine %s pre-alloc desc 0x%p,0x%llx.\n",
-			dev_name(&xdev->pdev->dev), engine->name,
-			engine->desc, engine->desc_bus);
-	}
-	transfer->desc_virt = engine->desc;
-	transfer->desc_bus = engine->desc_bus;
+	do {
+		merged = 0;
+		list_for_each_entry_safe(ent, tmp, &rq->queue, list) {
+			int where = rq_entry_mergeable(ent, ep_start, ep_end,
+							desc_cnt, len);
+
+			if (!where)
+				continue;
+			if (where > 0) {
+				list_move_tail(&ent->list, batch);
+				ep_end = ent->ep_end;
+			} else {
+				list_move(&ent->list, batch);
+				ep_start = ent->ep_start;
+			}
+			desc_cnt += ent->req->sw_desc_cnt;
+			len += ent->req->total_len;
+			rq->stats.depth--;
+			rq->stats.merged++;
+			merged = 1;
+		}
+	} while (merged);
 
-	transfer_desc_init(transfer, transfer->desc_num);
+out:
+	list_for_each_entry(ent, batch, list)
+		ent->state = RQ_ENTRY_ACTIVE;
+	rq->ep_pos = ep_end;
+	rq->stats.batches++;
+}
 
-	dbg_sg("transfer->desc_bus = 0x%llx.\n", (u64)transfer->desc_bus);
+/* concatenate the sw descriptors of a batch, coalescing where possible */
+static struct xdma_request_cb *engine_rq_batch_request(
+			struct xdma_engine *engine, struct list_head *batch)
+{
+	struct xdma_request_cb *req;
+	struct xdma_rq_entry *ent;
+	unsigned int desc_cnt = 0;
+	unsigned int coalesced = 0;
+	unsigned int j = 0;
+	unsigned int i;
 
-	for (i = 0; i < transfer->desc_num; i++) {
-		struct xdma_desc *desc = transfer->desc_virt + i;
-		dma_addr_t rc_bus_addr = buffer_bus + size_in_desc * i;
+	list_for_each_entry(ent, batch, list)
+		desc_cnt += ent->req->sw_desc_cnt;
 
-		/* fill in descriptor entry with transfer details */
-		xdma_desc_set(desc, rc_bus_addr, ep_addr, size_in_desc,
-			engine->dir);
+	req = xdma_request_alloc(desc_cnt);
+	if (!req)
+		return NULL;
+
+	ent = list_first_entry(batch, struct xdma_rq_entry, list);
+	req->sgt = ent->req->sgt;
+	req->ep_addr = ent->ep_start;
+
+	list_for_each_entry(ent, batch, list) {
+		req->total_len += ent->req->total_len;
+		for (i = 0; i < ent->req->sw_desc_cnt; i++) {
+			struct sw_desc *sdesc = &ent->req->sdesc[i];
+			struct sw_desc *prev = j ? &req->sdesc[j - 1] : NULL;
+
+			/* host and card side both continue the previous one */
+			if (prev && prev->addr + prev->len == sdesc->addr &&
+			    prev->ep_addr + prev->len == sdesc->ep_addr &&
+			    prev->len + sdesc->len <= desc_blen_max) {
+				prev->len += sdesc->len;
+				coalesced++;
+				continue;
+			}
+			req->sdesc[j++] = *sdesc;
+		}
 	}
+	req->sw_desc_cnt = j;
 
-	/* stop engine and request interrupt on last descriptor */
-	xdma_desc_control_set(transfer->desc_virt, 0);
-	/* create a linked loop */
-	xdma_desc_link(transfer->desc_virt + transfer->desc_num - 1,
-		transfer->desc_virt, transfer->desc_bus);
+	spin_lock(&engine->rq.lock);
+	engine->rq.stats.desc_merged += coalesced;
+	spin_unlock(&engine->rq.lock);
 
-	transfer->cyclic = 1;
+	return req;
+}
 
-	/* initialize wait queue */
-#if	LINUX_VERSION_CODE >= KERNEL_VERSION(4,6,0)
-	init_swait_queue_head(&transfer->wq);
-#else
-	init_waitqueue_head(&transfer->wq);
-#endif
+/*
+ * run a batch on behalf of its submitters. Only a request of the dispatcher
+ * alone, self, may be cut short by a signal to it: the other submitters have
+ * no signal pending and must not see -ERESTARTSYS.
+ */
+static void engine_rq_run(struct xdma_engine *engine, struct list_head *batch,
+			struct xdma_rq_entry *self)
+{
+	struct xdma_rq_entry *ent;
+	struct xdma_request_cb *req;
+	int timeout_ms = 0;
+	ssize_t done;
+	int rv;
 
-	//printk("=== Descriptor print for PERF \n");
-	//transfer_dump(transfer);
+	list_for_each_entry(ent, batch, list)
+		timeout_ms = max(timeout_ms, ent->timeout_ms);
 
-	dbg_perf("Queueing XDMA I/O %s request for performance measurement.\n",
-		engine->dir ? "write (to dev)" : "read (from dev)");
-	transfer_queue(engine, transfer);
-	return 0;
+	ent = list_first_entry(batch, struct xdma_rq_entry, list);
+	if (list_is_singular(batch)) {
+		rv = engine_request_run(engine, ent->req, timeout_ms,
+					ent == self, &ent->done);
+		ent->rv = rv;
+		return;
+	}
+
+	req = engine_rq_batch_request(engine, batch);
+	if (!req) {
+		/* no memory to merge, run them one by one */
+		list_for_each_entry(ent, batch, list)
+			ent->rv = engine_request_run(engine, ent->req,
+						timeout_ms, ent == self,
+						&ent->done);
+		return;
+	}
 
+	rv = engine_request_run(engine, req, timeout_ms, false, &done);
+	xdma_request_free(req);
+
+	/* bytes completed in order, split them back up */
+	list_for_each_entry(ent, batch, list) {
+		ent->done = min_t(ssize_t, done, ent->req->total_len);
+		done -= ent->done;
+		ent->rv = ent->done < ent->req->total_len ?
+			(rv < 0 ? rv : -EIO) : 0;
+	}
 }
-EXPORT_SYMBOL_GPL(xdma_performance_submit);
 
-static struct xdma_dev *alloc_dev_instance(struct pci_dev *pdev)
+static int rq_entry_wake(struct xdma_rq *rq, struct xdma_rq_entry *ent)
 {
-	int i;
-	struct xdma_dev *xdev;
+	return READ_ONCE(ent->state) == RQ_ENTRY_DONE ||
+		!READ_ONCE(rq->dispatching);
+}
+
+static int engine_rq_submit(struct xdma_engine *engine,
+			struct xdma_request_cb *req, bool mergeable,
+			int timeout_ms, ssize_t *done)
+{
+	struct xdma_rq *rq = &engine->rq;
+	struct xdma_rq_entry ent;
+
+	memset(&ent, 0, sizeof(ent));
+	ent.req = req;
+	ent.ep_start = req->ep_addr;
+	ent.ep_end = req->ep_addr + req->total_len;
+	ent.mergeable = mergeable;
+	ent.timeout_ms = timeout_ms;
+	ent.deadline = jiffies + msecs_to_jiffies(rq_expire_ms);
+	ent.state = RQ_ENTRY_QUEUED;
+
+	spin_lock(&rq->lock);
+	list_add_tail(&ent.list, &rq->queue);
+	rq->stats.depth++;
+	if (rq->stats.depth > rq->stats.depth_max)
+		rq->stats.depth_max = rq->stats.depth;
+
+	while (ent.state != RQ_ENTRY_DONE) {
+		if (!rq->dispatching) {
+			rq->dispatching = 1;
+
+			while (ent.state != RQ_ENTRY_DONE) {
+				struct xdma_rq_entry *e, *tmp;
+				LIST_HEAD(batch);
+
+				engine_rq_batch(engine, &batch);
+				spin_unlock(&rq->lock);
+
+				engine_rq_run(engine, &batch, &ent);
+
+				spin_lock(&rq->lock);
+				list_for_each_entry_safe(e, tmp, &batch, list) {
+					list_del(&e->list);
+					rq->stats.requests++;
+					WRITE_ONCE(e->state, RQ_ENTRY_DONE);
+				}
+				wake_up_all(&rq->wq);
+			}
+
+			/* hand over to the next submitter */
+			WRITE_ONCE(rq->dispatching, 0);
+			if (!list_empty(&rq->queue))
+				wake_up_all(&rq->wq);
+			break;
+		}
+
+		spin_unlock(&rq->lock);
+		if (wait_event_interruptible(rq->wq, rq_entry_wake(rq, &ent))) {
+			spin_lock(&rq->lock);
+			if (ent.state == RQ_ENTRY_QUEUED) {
+				list_del(&ent.list);
+				rq->stats.depth--;
+				spin_unlock(&rq->lock);
+				return -ERESTARTSYS;
+			}
+			spin_unlock(&rq->lock);
+			/* on the engine already, the transfer timeout applies */
+			wait_event(rq->wq, rq_entry_wake(rq, &ent));
+		}
+		spin_lock(&rq->lock);
+	}
+	spin_unlock(&rq->lock);
+
+	*done = ent.done;
+	return ent.rv;
+}
+
+void xdma_engine_rq_stats(struct xdma_engine *engine,
+			struct xdma_rq_stats *stats)
+{
+	spin_lock(&engine->rq.lock);
+	*stats = engine->rq.stats;
+	spin_unlock(&engine->rq.lock);
+}
+
+static ssize_t xdma_xfer_submit_internal(void *dev_hndl, int channel,
+			bool write, u64 ep_addr,
+			const struct xdma_ep_region *regions,
+			unsigned int nr_regions, struct sg_table *sgt,
+			bool dma_mapped, int timeout_ms)
+{
+	struct xdma_dev *xdev = (struct xdma_dev *)dev_hndl;
+	struct xdma_engine *engine;
+	int rv = 0;
+	ssize_t done = 0;
+	struct scatterlist *sg = sgt->sgl;
+	int nents;
+	enum dma_data_direction dir = write ? DMA_TO_DEVICE : DMA_FROM_DEVICE;
+	struct xdma_request_cb *req = NULL;
+
+	if (!dev_hndl)
+		return -EINVAL;
+
+	if (debug_check_dev_hndl(__func__, xdev->pdev, dev_hndl) < 0)
+		return -EINVAL;
+
+	if (write == 1) {
+		if (channel >= xdev->h2c_channel_max) {
+			pr_warn("H2C channel %d >= %d.\n",
+				channel, xdev->h2c_channel_max);
+			return -EINVAL;
+		}
+		engine = &xdev->engine_h2c[channel];
+	} else if (write == 0) {
+		if (channel >= xdev->c2h_channel_max) {
+			pr_warn("C2H channel %d >= %d.\n",
+				channel, xdev->c2h_channel_max);
+			return -EINVAL;
+		}
+		engine = &xdev->engine_c2h[channel];
+	} else {
+		pr_warn("write %d, exp. 0|1.\n", write);
+		return -EINVAL;
+	}
+
+        BUG_ON(!engine);
+        BUG_ON(engine->magic != MAGIC_ENGINE);
+
+	xdev = engine->xdev;
+	if (xdma_device_flag_check(xdev, XDEV_FLAG_OFFLINE)) {
+		pr_info("xdev 0x%p, offline.\n", xdev);
+		return -EBUSY;
+	}
+
+	/* check the direction */
+	if (engine->dir != dir) {
+		pr_info("0x%p, %s, %d, W %d, 0x%x/0x%x mismatch.\n",
+			engine, engine->name, channel, write, engine->dir, dir);
+		return -EINVAL;
+	}
+
+	if (!dma_mapped) {
+		nents = pci_map_sg(xdev->pdev, sg, sgt->orig_nents, dir);
+		if (!nents) {
+			pr_info("map sgl failed, sgt 0x%p.\n", sgt);
+			return -EIO;
+		}
+		sgt->nents = nents;
+	} else {
+		BUG_ON(!sgt->nents);
+	}
+
+	if (regions) {
+		rv = xdma_regions_check(engine, sgt, regions, nr_regions);
+		if (rv < 0)
+			goto unmap_sgl;
+	}
+
+	req = xdma_init_request_regions(sgt, ep_addr, regions, nr_regions);
+	if (!req) {
+		rv = -ENOMEM;
+		goto unmap_sgl;
+	}
+
+	rv = engine_rq_submit(engine, req, !regions && !engine->streaming &&
+				!engine->non_incr_addr, timeout_ms, &done);
+
+unmap_sgl:
+	if (!dma_mapped && sgt->nents) {
+		pci_unmap_sg(xdev->pdev, sgt->sgl, sgt->orig_nents, dir);
+		sgt->nents = 0;
+	}
+
+	if (req)
+		xdma_request_free(req);
+
+	if (rv < 0)
+		return rv;
+
+	return done;
+}
+
+ssize_t xdma_xfer_submit(void *dev_hndl, int channel, bool write, u64 ep_addr,
+			struct sg_table *sgt, bool dma_mapped, int timeout_ms)
+{
+	return xdma_xfer_submit_internal(dev_hndl, channel, write, ep_addr,
+				NULL, 0, sgt, dma_mapped, timeout_ms);
+}
+EXPORT_SYMBOL_GPL(xdma_xfer_submit);
+
+ssize_t xdma_xfer_submit_regions(void *dev_hndl, int channel, bool write,
+			const struct xdma_ep_region *regions,
+			unsigned int nr_regions, struct sg_table *sgt,
+			bool dma_mapped, int timeout_ms)
+{
+	if (!regions || !nr_regions)
+		return -EINVAL;
+
+	return xdma_xfer_submit_internal(dev_hndl, channel, write,
+				regions[0].ep_addr, regions, nr_regions, sgt,
+				dma_mapped, timeout_ms);
+}
+EXPORT_SYMBOL_GPL(xdma_xfer_submit_regions);
+
+int xdma_performance_submit(struct xdma_dev *xdev, struct xdma_engine *engine)
+{
+	u8 *buffer_virt;
+	u32 max_consistent_size = 128 * 32 * 1024; /* 1024 pages, 4MB */
+	dma_addr_t buffer_bus;	/* bus address */
+	struct xdma_transfer *transfer;
+	u64 ep_addr = 0;
+	int num_desc_in_a_loop = 128;
+	int size_in_desc = engine->xdma_perf->transfer_size;
+	int size = size_in_desc * num_desc_in_a_loop;
+	int i;
+
+	BUG_ON(size_in_desc > max_consistent_size);
+
+	if (size > max_consistent_size) {
+		size = max_consistent_size;
+		num_desc_in_a_loop = size / size_in_desc;
+	}
+
+	buffer_virt = dma_alloc_coherent(&xdev->pdev->dev, size,
+					&buffer_bus, GFP_KERNEL);
+
+	/* allocate transfer data structure */
+	transfer = kzalloc(sizeof(struct xdma_transfer), GFP_KERNEL);
+	BUG_ON(!transfer);
+
+	/* 0 = write engine (to_dev=0) , 1 = read engine (to_dev=1) */
+	transfer->dir = engine->dir;
+	/* set number of descriptors */
+	transfer->desc_num = num_desc_in_a_loop;
+
+	/* allocate descriptor list */
+	if (!engine->desc) {
+		engine->desc = dma_alloc_coherent(&xdev->pdev->dev,
+			num_desc_in_a_loop * sizeof(struct xdma_desc),
+			&engine->desc_bus, GFP_KERNEL);
+		BUG_ON(!engine->desc);
+		dbg_init("device %s, engine %s pre-alloc desc 0x%p,0x%llx.\n",
+			dev_name(&xdev->pdev->dev), engine->name,
+			engine->desc, engine->desc_bus);
+	}
+	transfer->desc_virt = engine->desc;
+	transfer->desc_bus = engine->desc_bus;
+
+	transfer_desc_init(transfer, transfer->desc_num);
+
+	dbg_sg("transfer->desc_bus = 0x%llx.\n", (u64)transfer->desc_bus);
+
+	for (i = 0; i < transfer->desc_num; i++) {
+		struct xdma_desc *desc = transfer->desc_virt + i;
+		dma_addr_t rc_bus_addr = buffer_bus + size_in_desc * i;
+
+		/* fill in descriptor entry with transfer details */
+		xdma_desc_set(desc, rc_bus_addr, ep_addr, size_in_desc,
+			engine->dir);
+	}
+
+	/* stop engine and request interrupt on last descriptor */
+	xdma_desc_control_set(transfer->desc_virt, 0);
+	/* create a linked loop */
+	xdma_desc_link(transfer->desc_virt + transfer->desc_num - 1,
+		transfer->desc_virt, transfer->desc_bus);
+
+	transfer->cyclic = 1;
+
+	/* initialize wait queue */
+#if	LINUX_VERSION_CODE >= KERNEL_VERSION(4,6,0)
+	init_swait_queue_head(&transfer->wq);
+#else
+	init_waitqueue_head(&transfer->wq);
+#endif
+
+	//printk("=== Descriptor print for PERF \n");
+	//transfer_dump(transfer);
+
+	dbg_perf("Queueing XDMA I/O %s request for performance measurement.\n",
+		engine->dir ? "write (to dev)" : "read (from dev)");
+	transfer_queue(engine, transfer);
+	return 0;
+
+}
+EXPORT_SYMBOL_GPL(xdma_performance_submit);
+
+static struct xdma_dev *alloc_dev_instance(struct pci_dev *pdev)
+{
+	int i;
+	struct xdma_dev *xdev;
 	struct xdma_engine *engine;
 
 	BUG_ON(!pdev);
@@ -3320,6 +3772,11 @@ static struct xdma_dev *alloc_dev_instance(struct pci_dev *pdev)
 		spin_lock_init(&engine->lock);
 		spin_lock_init(&engine->desc_lock);
 		INIT_LIST_HEAD(&engine->transfer_list);
+		spin_lock_init(&engine->rq.lock);
+		INIT_LIST_HEAD(&engine->rq.queue);
+		init_waitqueue_head(&engine->rq.wq);
+		mutex_init(&engine->frame_lock);
+		init_waitqueue_head(&engine->frame_wq);
 #if	LINUX_VERSION_CODE >= KERNEL_VERSION(4,6,0)
 		init_swait_queue_head(&engine->shutdown_wq);
 		init_swait_queue_head(&engine->xdma_perf_wq);
@@ -3334,6 +3791,11 @@ static struct xdma_dev *alloc_dev_instance(struct pci_dev *pdev)
 		spin_lock_init(&engine->lock);
 		spin_lock_init(&engine->desc_lock);
 		INIT_LIST_HEAD(&engine->transfer_list);
+		spin_lock_init(&engine->rq.lock);
+		INIT_LIST_HEAD(&engine->rq.queue);
+		init_waitqueue_head(&engine->rq.wq);
+		mutex_init(&engine->frame_lock);
+		init_waitqueue_head(&engine->frame_wq);
 #if	LINUX_VERSION_CODE >= KERNEL_VERSION(4,6,0)
 		init_swait_queue_head(&engine->shutdown_wq);
 		init_swait_queue_head(&engine->xdma_perf_wq);
@@ -3395,27 +3857,6 @@ static int set_dma_mask(struct pci_dev *pdev)
 	return 0;
 }
 
-static u32 get_engine_channel_id(struct engine_regs *regs)
-{
-	u32 value;
-
-	BUG_ON(!regs);
-
-	value = read_register(&regs->identifier);
-
-	return (value & 0x00000f00U) >> 8;
-}
-
-static u32 get_engine_id(struct engine_regs *regs)
-{
-	u32 value;
-
-	BUG_ON(!regs);
-
-	value = read_register(&regs->identifier);
-	return (value & 0xffff0000U) >> 16;
-}
-
 static void remove_engines(struct xdma_dev *xdev)
 {
 	struct xdma_engine *engine;
@@ -3448,11 +3889,11 @@ static int probe_for_engine(struct xdma_dev *xdev, enum dma_data_direction dir,
 {
 	struct engine_regs *regs;
 	int offset = channel * CHANNEL_SPACING;
+	u32 identifier;
 	u32 engine_id;
 	u32 engine_id_expected;
 	u32 channel_id;
 	struct xdma_engine *engine;
-	int rv;
 
 	/* register offset for the engine */
 	/* read channels at 0x0000, write channels at 0x1000,
@@ -3466,9 +3907,11 @@ static int probe_for_engine(struct xdma_dev *xdev, enum dma_data_direction dir,
 		engine = &xdev->engine_c2h[channel];
 	}
 
+	/* one read for engine id, channel id and the streaming flag */
 	regs = xdev->bar[xdev->config_bar_idx] + offset;
-	engine_id = get_engine_id(regs);
-	channel_id = get_engine_channel_id(regs);
+	identifier = read_register(&regs->identifier);
+	engine_id = (identifier & 0xffff0000U) >> 16;
+	channel_id = (identifier & 0x00000f00U) >> 8;
 
 	if ((engine_id != engine_id_expected) || (channel_id != channel)) {
 		dbg_init("%s %d engine, reg off 0x%x, id mismatch 0x%x,0x%x,"
@@ -3483,43 +3926,96 @@ static int probe_for_engine(struct xdma_dev *xdev, enum dma_data_direction dir,
 		 dir == DMA_TO_DEVICE ? "H2C" : "C2H", channel,
 		 offset, engine_id, channel_id);
 
-	/* allocate and initialize engine */
-	rv = engine_init(engine, xdev, offset, dir, channel);
-	if (rv != 0) {
-		pr_info("failed to create AXI %s %d engine.\n",
-			dir == DMA_TO_DEVICE ? "H2C" : "C2H",
-			channel);
-		return rv;
-	}
+	engine_init(engine, xdev, offset, dir, channel, identifier);
 
 	return 0;
 }
 
+struct engine_probe {
+	struct xdma_engine *engine;
+	int rv;
+};
+
+static void engine_probe_async(void *data, async_cookie_t cookie)
+{
+	struct engine_probe *probe = data;
+
+	probe->rv = engine_init_resource(probe->engine);
+}
+
+/* keep the engines up to the first one that failed to initialize */
+static int probe_engines_check(struct xdma_dev *xdev, struct engine_probe *probe,
+			int num)
+{
+	int i;
+
+	for (i = 0; i < num; i++)
+		if (probe[i].rv)
+			break;
+
+	if (i < num)
+		pr_info("failed to create AXI %s %d engine, %d.\n",
+			probe[i].engine->dir == DMA_TO_DEVICE ? "H2C" : "C2H",
+			i, probe[i].rv);
+
+	for (num--; num >= i; num--)
+		engine_destroy(xdev, probe[num].engine);
+
+	return i;
+}
+
 static int probe_engines(struct xdma_dev *xdev)
 {
+	ASYNC_DOMAIN_EXCLUSIVE(domain);
+	struct engine_probe probe[2 * XDMA_CHANNEL_NUM_MAX];
+	int h2c, c2h;
 	int i;
-	int rv = 0;
 
 	BUG_ON(!xdev);
 
-	/* iterate over channels */
-	for (i = 0; i < xdev->h2c_channel_max; i++) {
-		rv = probe_for_engine(xdev, DMA_TO_DEVICE, i);
-		if (rv)
+	/* identify the engines, the irq bits are assigned in this order */
+	for (h2c = 0; h2c < xdev->h2c_channel_max; h2c++) {
+		if (probe_for_engine(xdev, DMA_TO_DEVICE, h2c))
 			break;
+		probe[h2c].engine = &xdev->engine_h2c[h2c];
 	}
-	xdev->h2c_channel_max = i;
 
-	for (i = 0; i < xdev->c2h_channel_max; i++) {
-		rv = probe_for_engine(xdev, DMA_FROM_DEVICE, i);
-		if (rv)
+	for (c2h = 0; c2h < xdev->c2h_channel_max; c2h++) {
+		if (probe_for_engine(xdev, DMA_FROM_DEVICE, c2h))
 			break;
+		probe[h2c + c2h].engine = &xdev->engine_c2h[c2h];
+	}
+
+	/* descriptor memory and register set up, independent per engine */
+	for (i = 0; i < h2c + c2h; i++) {
+		probe[i].rv = 0;
+		if (engine_init_async)
+			async_schedule_domain(engine_probe_async, &probe[i],
+					&domain);
+		else
+			engine_probe_async(&probe[i], 0);
 	}
-	xdev->c2h_channel_max = i;
+	async_synchronize_full_domain(&domain);
+
+	xdev->h2c_channel_max = probe_engines_check(xdev, probe, h2c);
+	xdev->c2h_channel_max = probe_engines_check(xdev, probe + h2c, c2h);
 
 	return 0;
 }
 
+/* probe phase timing, reported through the xdma_probe_phase tracepoint */
+static ktime_t probe_phase_end(struct xdma_dev *xdev, const char *phase,
+			ktime_t start)
+{
+	ktime_t now = ktime_get();
+	s64 ns = ktime_to_ns(ktime_sub(now, start));
+
+	trace_xdma_probe_phase(dev_name(&xdev->pdev->dev), phase, ns);
+	dbg_init("%s, %s, %lld ns.\n", dev_name(&xdev->pdev->dev), phase, ns);
+
+	return now;
+}
+
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(3,5,0)
 static void pci_enable_capability(struct pci_dev *pdev, int cap)
 {
@@ -3544,6 +4040,8 @@ void *xdma_device_open(const char *mname, struct pci_dev *pdev, int *user_max,
 			int *h2c_channel_max, int *c2h_channel_max)
 {
 	struct xdma_dev *xdev = NULL;
+	ktime_t start = ktime_get();
+	ktime_t t;
 	int rv = 0;
 
 	pr_info("%s device %s, 0x%p.\n", mname, dev_name(&pdev->dev), pdev);
@@ -3553,6 +4051,7 @@ void *xdma_device_open(const char *mname, struct pci_dev *pdev, int *user_max,
 	if (!xdev)
 		return NULL;
 	xdev->mod_name = mname;
+	t = start;
 	xdev->user_max = *user_max;
 	xdev->h2c_channel_max = *h2c_channel_max;
 	xdev->c2h_channel_max = *c2h_channel_max;
@@ -3592,6 +4091,7 @@ void *xdma_device_open(const char *mname, struct pci_dev *pdev, int *user_max,
 
 	/* enable bus master capability */
 	pci_set_master(pdev);
+	t = probe_phase_end(xdev, "pci_enable", t);
 
 	rv = request_regions(xdev, pdev);
 	if (rv)
@@ -3600,6 +4100,7 @@ void *xdma_device_open(const char *mname, struct pci_dev *pdev, int *user_max,
 	rv = map_bars(xdev, pdev);
 	if (rv)
 		goto err_map;
+	t = probe_phase_end(xdev, "map_bars", t);
 
 	rv = set_dma_mask(pdev);
 	if (rv)
@@ -3610,10 +4111,12 @@ void *xdma_device_open(const char *mname, struct pci_dev *pdev, int *user_max,
 	channel_interrupts_disable(xdev, ~0);
 	user_interrupts_disable(xdev, ~0);
 	read_interrupts(xdev);
+	t = probe_phase_end(xdev, "irq_quiesce", t);
 
 	rv = probe_engines(xdev);
 	if (rv)
 		goto err_engines;
+	t = probe_phase_end(xdev, "probe_engines", t);
 
 	rv = enable_msi_msix(xdev, pdev);
 	if (rv < 0)
@@ -3622,6 +4125,7 @@ void *xdma_device_open(const char *mname, struct pci_dev *pdev, int *user_max,
 	rv = irq_setup(xdev, pdev);
 	if (rv < 0)
 		goto err_interrupts;
+	t = probe_phase_end(xdev, "irq_setup", t);
 
 	if (!poll_mode)
 		channel_interrupts_enable(xdev, ~0);
@@ -3633,6 +4137,8 @@ void *xdma_device_open(const char *mname, struct pci_dev *pdev, int *user_max,
 	*h2c_channel_max = xdev->h2c_channel_max;
 	*c2h_channel_max = xdev->c2h_channel_max;
 
+	probe_phase_end(xdev, "total", start);
+
 	xdma_device_flag_clear(xdev, XDEV_FLAG_OFFLINE);
 	return (void *)xdev;
 
@@ -4471,3 +4977,453 @@ int engine_addrmode_set(struct xdma_engine *engine, unsigned long arg)
 
 	return rv;
 }
+
+/*
+ * frame grabber mode
+ *
+ * The ring frames are built from high-order page chunks (split, so that they
+ * can be mapped to user space page by page), one descriptor per chunk. The
+ * last descriptor of every frame requests a completion interrupt and the last
+ * descriptor of the ring links back to the first one, so the engine keeps
+ * cycling until stopped. Completed frames are derived from the running
+ * completed descriptor count of the engine.
+ */
+#define XDMA_FRAME_CHUNK_ORDER	10
+
+size_t xdma_frame_ring_mmap_size(struct xdma_frame_ring *ring)
+{
+	return ring->status_size + ring->frames * ring->frame_stride;
+}
+
+static void frame_ring_free(struct xdma_dev *xdev,
+			struct xdma_frame_ring *ring)
+{
+	int i, j;
+
+	if (ring->chunk) {
+		for (i = 0; i < ring->frames * ring->chunks; i++) {
+			struct xdma_frame_chunk *chunk = ring->chunk + i;
+			unsigned int npages;
+
+			if (!chunk->page)
+				break;
+			npages = 1 << get_order(chunk->len);
+			if (chunk->bus)
+				pci_unmap_page(xdev->pdev, chunk->bus,
+					npages << PAGE_SHIFT,
+					DMA_FROM_DEVICE);
+			for (j = 0; j < npages; j++)
+				__free_page(chunk->page + j);
+		}
+		vfree(ring->chunk);
+	}
+	if (ring->status)
+		vfree(ring->status);
+	kfree(ring);
+}
+
+/* page aligned bytes per chunk (descriptor) of a frame */
+static unsigned int frame_ring_chunk_size(unsigned int frame_len)
+{
+	unsigned int chunk_max = min_t(unsigned int,
+				PAGE_SIZE << XDMA_FRAME_CHUNK_ORDER,
+				desc_blen_max & PAGE_MASK);
+
+	return min_t(unsigned int, PAGE_ALIGN(frame_len), chunk_max);
+}
+
+static struct xdma_frame_ring *frame_ring_alloc(struct xdma_engine *engine,
+			u64 ep_addr, unsigned int frame_len,
+			unsigned int frames)
+{
+	struct xdma_dev *xdev = engine->xdev;
+	struct xdma_frame_ring *ring;
+	int f, c;
+
+	ring = kzalloc(sizeof(struct xdma_frame_ring), GFP_KERNEL);
+	if (!ring)
+		return NULL;
+
+	ring->ep_addr = ep_addr;
+	ring->frame_len = frame_len;
+	ring->frames = frames;
+	ring->frame_stride = PAGE_ALIGN(frame_len);
+	ring->chunk_size = frame_ring_chunk_size(frame_len);
+	ring->chunks = DIV_ROUND_UP(frame_len, ring->chunk_size);
+
+	ring->status_size = PAGE_ALIGN(sizeof(struct xdma_frame_status) +
+				frames * sizeof(struct xdma_frame_info));
+	ring->status = vmalloc_user(ring->status_size);
+	ring->chunk = vzalloc(frames * ring->chunks *
+				sizeof(struct xdma_frame_chunk));
+	if (!ring->status || !ring->chunk)
+		goto err_out;
+
+	for (f = 0; f < frames; f++) {
+		unsigned int left = frame_len;
+
+		for (c = 0; c < ring->chunks; c++) {
+			struct xdma_frame_chunk *chunk =
+				ring->chunk + f * ring->chunks + c;
+			unsigned int order;
+
+			chunk->len = min(left, ring->chunk_size);
+			left -= chunk->len;
+			order = get_order(chunk->len);
+
+			chunk->page = alloc_pages(GFP_KERNEL | __GFP_ZERO |
+						__GFP_NOWARN, order);
+			if (!chunk->page) {
+				pr_info("%s frame %d/%u, chunk %d OOM.\n",
+					engine->name, f, frames, c);
+				goto err_out;
+			}
+			split_page(chunk->page, order);
+
+			chunk->bus = pci_map_page(xdev->pdev, chunk->page, 0,
+					PAGE_SIZE << order, DMA_FROM_DEVICE);
+			if (unlikely(pci_dma_mapping_error(xdev->pdev,
+							chunk->bus))) {
+				pr_info("%s frame %d, chunk %d map err.\n",
+					engine->name, f, c);
+				chunk->bus = 0;
+				goto err_out;
+			}
+		}
+	}
+
+	ring->status->frames = frames;
+	ring->status->frame_len = frame_len;
+	ring->status->frame_offset = ring->status_size;
+	ring->status->frame_stride = ring->frame_stride;
+
+	return ring;
+
+err_out:
+	frame_ring_free(xdev, ring);
+	return NULL;
+}
+
+/* engine->desc_lock must be held */
+static void frame_ring_transfer_init(struct xdma_engine *engine,
+			struct xdma_frame_ring *ring)
+{
+	struct xdma_transfer *xfer = &ring->xfer;
+	int desc_num = ring->frames * ring->chunks;
+	int i;
+
+	memset(xfer, 0, sizeof(*xfer));
+#if	LINUX_VERSION_CODE >= KERNEL_VERSION(4,6,0)
+	init_swait_queue_head(&xfer->wq);
+#else
+	init_waitqueue_head(&xfer->wq);
+#endif
+	xfer->dir = engine->dir;
+	xfer->desc_virt = engine->desc;
+	xfer->desc_bus = engine->desc_bus;
+
+	transfer_desc_init(xfer, desc_num);
+
+	for (i = 0; i < desc_num; i++) {
+		struct xdma_frame_chunk *chunk = ring->chunk + i;
+		u64 ep_addr = ring->ep_addr +
+				(u64)(i % ring->chunks) * ring->chunk_size;
+
+		xdma_desc_set(xfer->desc_virt + i, chunk->bus, ep_addr,
+				chunk->len, xfer->dir);
+		xfer->len += chunk->len;
+
+		/* completion interrupt at the end of every frame */
+		if ((i % ring->chunks) == ring->chunks - 1)
+			xdma_desc_control_set(xfer->desc_virt + i,
+					XDMA_DESC_COMPLETED);
+	}
+
+	xfer->desc_num = xfer->desc_adjacent = desc_num;
+	for (i = 0; i < desc_num; i++)
+		xdma_desc_adjacent(xfer->desc_virt + i, desc_num - i - 1);
+
+	xdma_transfer_cyclic(xfer);
+}
+
+/* must be called with engine->lock already acquired */
+static int engine_service_frame(struct xdma_engine *engine)
+{
+	struct xdma_frame_ring *ring = engine->frame_ring;
+	struct xdma_frame_status *status = ring->status;
+	u32 desc_count;
+	u64 ts;
+	int done = 0;
+
+	engine_status_read(engine, 1, 0);
+
+	desc_count = read_register(&engine->regs->completed_desc_count);
+	ring->desc_pending += desc_count - ring->desc_last;
+	ring->desc_last = desc_count;
+
+	ts = ktime_to_ns(ktime_get());
+	while (ring->desc_pending >= ring->chunks) {
+		u32 slot;
+		int c;
+
+		div_u64_rem(ring->seq, ring->frames, &slot);
+		for (c = 0; c < ring->chunks; c++) {
+			struct xdma_frame_chunk *chunk =
+				ring->chunk + slot * ring->chunks + c;
+
+			pci_dma_sync_single_for_cpu(engine->xdev->pdev,
+				chunk->bus, chunk->len, DMA_FROM_DEVICE);
+		}
+		status->info[slot].seq = ring->seq;
+		status->info[slot].timestamp_ns = ts;
+		ring->seq++;
+		ring->desc_pending -= ring->chunks;
+		done++;
+	}
+	if (done) {
+		/* frame info must be visible before the sequence number */
+		smp_wmb();
+		status->seq = ring->seq;
+	}
+
+	/* engine was running but is no longer busy? stopped or failed */
+	if (engine->running && !(engine->status & XDMA_STAT_BUSY)) {
+		if (engine->status & XDMA_STAT_C2H_ERR_MASK) {
+			pr_info("%s frame ring stopped, status 0x%x.\n",
+				engine->name, engine->status);
+			status->error = engine->status;
+		}
+		if (!list_empty(&engine->transfer_list))
+			list_del_init(engine->transfer_list.next);
+		ring->stopped = 1;
+		engine_service_shutdown(engine);
+		done++;
+	}
+
+	if (done)
+		wake_up_interruptible(&engine->frame_wq);
+
+	return 0;
+}
+
+/*
+ * The frame ring calls below are serialized by engine->frame_lock; the
+ * engine->frame_ring pointer itself is only changed with engine->lock held
+ * as well, so the interrupt service never sees a ring being freed. Poll
+ * waiters sleep on engine->frame_wq, which outlives any ring.
+ */
+int xdma_frame_ring_setup(struct xdma_engine *engine, u64 ep_addr,
+			unsigned int frame_len, unsigned int frames, void *owner,
+			size_t *mmap_size)
+{
+	struct xdma_frame_ring *ring;
+	unsigned int chunks;
+	unsigned long flags;
+	int rv = 0;
+
+	BUG_ON(!engine);
+
+	if (engine->streaming || engine->dir != DMA_FROM_DEVICE) {
+		pr_info("%s, frame ring needs an AXI-MM C2H engine.\n",
+			engine->name);
+		return -EINVAL;
+	}
+	if (poll_mode) {
+		pr_info("%s, frame ring not supported in poll mode.\n",
+			engine->name);
+		return -EOPNOTSUPP;
+	}
+	if (!frame_len || frame_len > (UINT_MAX & PAGE_MASK) ||
+	    frames < 2 || frames > XDMA_FRAME_RING_MAX)
+		return -EINVAL;
+	if (engine->non_incr_addr)
+		return -EINVAL;
+
+	/* reject before allocating the frame buffers */
+	chunks = DIV_ROUND_UP(frame_len, frame_ring_chunk_size(frame_len));
+	if ((u64)frames * chunks > XDMA_TRANSFER_MAX_DESC) {
+		pr_info("%s, %u frames x %u desc. > %u.\n", engine->name,
+			frames, chunks, XDMA_TRANSFER_MAX_DESC);
+		return -EINVAL;
+	}
+
+	mutex_lock(&engine->frame_lock);
+	if (engine->frame_ring) {
+		rv = -EBUSY;
+		goto unlock;
+	}
+
+	ring = frame_ring_alloc(engine, ep_addr, frame_len, frames);
+	if (!ring) {
+		rv = -ENOMEM;
+		goto unlock;
+	}
+	ring->owner = owner;
+
+	/* take over the engine descriptors from the transfer path */
+	spin_lock(&engine->desc_lock);
+	if (engine->running) {
+		spin_unlock(&engine->desc_lock);
+		rv = -EBUSY;
+		goto free_ring;
+	}
+
+	frame_ring_transfer_init(engine, ring);
+	spin_lock_irqsave(&engine->lock, flags);
+	engine->frame_ring = ring;
+	spin_unlock_irqrestore(&engine->lock, flags);
+	spin_unlock(&engine->desc_lock);
+
+	/* the completed descriptor count restarts with the engine */
+	rv = transfer_queue(engine, &ring->xfer);
+	if (rv < 0) {
+		spin_lock(&engine->desc_lock);
+		spin_lock_irqsave(&engine->lock, flags);
+		engine->frame_ring = NULL;
+		spin_unlock_irqrestore(&engine->lock, flags);
+		xdma_desc_done(engine->desc);
+		spin_unlock(&engine->desc_lock);
+		goto free_ring;
+	}
+
+	if (mmap_size)
+		*mmap_size = xdma_frame_ring_mmap_size(ring);
+	mutex_unlock(&engine->frame_lock);
+	return 0;
+
+free_ring:
+	frame_ring_free(engine->xdev, ring);
+unlock:
+	mutex_unlock(&engine->frame_lock);
+	return rv;
+}
+
+int xdma_frame_ring_teardown(struct xdma_engine *engine, void *owner)
+{
+	struct xdma_frame_ring *ring;
+	unsigned long timeout;
+	unsigned long flags;
+
+	mutex_lock(&engine->frame_lock);
+	ring = engine->frame_ring;
+	if (!ring || ring->owner != owner) {
+		mutex_unlock(&engine->frame_lock);
+		return -EINVAL;
+	}
+
+	spin_lock_irqsave(&engine->lock, flags);
+	xdma_engine_stop(engine);
+	spin_unlock_irqrestore(&engine->lock, flags);
+
+	/* the stopped engine finishes the descriptor it is working on */
+	timeout = jiffies + HZ;
+	do {
+		engine_status_read(engine, 0, 0);
+		if (!(engine->status & XDMA_STAT_BUSY))
+			break;
+		msleep(1);
+	} while (time_before(jiffies, timeout));
+
+	if (engine->status & XDMA_STAT_BUSY)
+		pr_info("%s still busy after frame ring stop.\n",
+			engine->name);
+
+	spin_lock_irqsave(&engine->lock, flags);
+	if (!list_empty(&engine->transfer_list))
+		list_del_init(engine->transfer_list.next);
+	engine->running = 0;
+	engine->frame_ring = NULL;
+	ring->stopped = 1;
+	spin_unlock_irqrestore(&engine->lock, flags);
+
+	wake_up_interruptible(&engine->frame_wq);
+	/* let a pending service run, it re-enables the engine interrupt */
+	flush_work(&engine->work);
+
+	spin_lock(&engine->desc_lock);
+	xdma_desc_done(engine->desc);
+	spin_unlock(&engine->desc_lock);
+
+	frame_ring_free(engine->xdev, ring);
+	mutex_unlock(&engine->frame_lock);
+
+	return 0;
+}
+
+int xdma_frame_ring_mmap(struct xdma_engine *engine,
+			struct vm_area_struct *vma)
+{
+	struct xdma_frame_ring *ring;
+	unsigned long status_pages;
+	unsigned long frame_pages;
+	unsigned long chunk_pages;
+	unsigned long pg = vma->vm_pgoff;
+	unsigned long addr;
+	int rv = 0;
+
+	mutex_lock(&engine->frame_lock);
+	ring = engine->frame_ring;
+	if (!ring) {
+		rv = -ENODEV;
+		goto unlock;
+	}
+
+	if (((vma->vm_pgoff << PAGE_SHIFT) + vma->vm_end - vma->vm_start) >
+	    xdma_frame_ring_mmap_size(ring)) {
+		rv = -EINVAL;
+		goto unlock;
+	}
+
+	status_pages = ring->status_size >> PAGE_SHIFT;
+	frame_pages = ring->frame_stride >> PAGE_SHIFT;
+	chunk_pages = ring->chunk_size >> PAGE_SHIFT;
+
+	for (addr = vma->vm_start; addr < vma->vm_end;
+	     addr += PAGE_SIZE, pg++) {
+		struct page *page;
+
+		if (pg < status_pages) {
+			page = vmalloc_to_page((char *)ring->status +
+						(pg << PAGE_SHIFT));
+		} else {
+			unsigned long k = pg - status_pages;
+			unsigned long f = k / frame_pages;
+			unsigned long in_frame = k % frame_pages;
+			struct xdma_frame_chunk *chunk = ring->chunk +
+				f * ring->chunks + in_frame / chunk_pages;
+
+			page = chunk->page + in_frame % chunk_pages;
+		}
+
+		rv = vm_insert_page(vma, addr, page);
+		if (rv < 0)
+			break;
+	}
+
+unlock:
+	mutex_unlock(&engine->frame_lock);
+	return rv;
+}
+
+unsigned int xdma_frame_ring_poll(struct xdma_engine *engine,
+			struct file *file, poll_table *wait)
+{
+	struct xdma_frame_ring *ring;
+	unsigned int mask = 0;
+
+	poll_wait(file, &engine->frame_wq, wait);
+
+	mutex_lock(&engine->frame_lock);
+	ring = engine->frame_ring;
+	if (!ring) {
+		mask = POLLERR;
+	} else {
+		if (ring->seq != READ_ONCE(ring->status->consumed))
+			mask |= POLLIN | POLLRDNORM;
+		if (ring->stopped)
+			mask |= POLLERR;
+	}
+	mutex_unlock(&engine->frame_lock);
+
+	return mask;
+}
@@ -31,6 +31,20 @@
 #include <linux/kernel.h>
 #include <linux/pci.h>
 #include <linux/workqueue.h>
+#include <linux/mutex.h>
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 18, 0)
+#include <linux/overflow.h>
+#else
+/* unsigned operands only */
+#define check_add_overflow(a, b, d) ({		\
+	typeof(a) __a = (a);			\
+	typeof(b) __b = (b);			\
+	typeof(d) __d = (d);			\
+	*__d = __a + __b;			\
+	*__d < __a;				\
+})
+#endif
+#include <linux/poll.h>
 #if	LINUX_VERSION_CODE >= KERNEL_VERSION(4,6,0)
 #include <linux/swait.h>
 #endif
@@ -386,6 +400,7 @@ struct xdma_result {
 struct sw_desc {
 	dma_addr_t addr;
 	unsigned int len;
+	u64 ep_addr;
 };
 
 /* Describes a (SG DMA) single transfer for the engine */
@@ -423,6 +438,77 @@ struct xdma_request_cb {
 	struct sw_desc sdesc[0];
 };
 
+/* a physically contiguous piece of a frame, one descriptor each */
+struct xdma_frame_chunk {
+	struct page *page;
+	dma_addr_t bus;
+	unsigned int len;
+};
+
+/* Ring of host frame buffers for the AXI-MM C2H frame grabber mode */
+struct xdma_frame_ring {
+	u64 ep_addr;			/* card window read into each frame */
+	unsigned int frame_len;
+	unsigned int frames;
+	unsigned int chunk_size;	/* bytes per chunk but the last */
+	unsigned int chunks;		/* chunks (descriptors) per frame */
+	size_t frame_stride;		/* page aligned frame size */
+	struct xdma_frame_chunk *chunk;	/* frames * chunks */
+
+	struct xdma_frame_status *status;	/* shared with user space */
+	size_t status_size;		/* page aligned */
+
+	u64 seq;			/* frames completed */
+	u32 desc_last;			/* last completed_desc_count seen */
+	u32 desc_pending;		/* completed desc. not yet in a frame */
+	int stopped;			/* engine no longer cycling */
+	void *owner;			/* opaque, set by the caller */
+
+	struct xdma_transfer xfer;	/* cyclic transfer over the ring */
+};
+
+/* per engine request queue */
+#define XDMA_RQ_SCHED_FIFO	0
+#define XDMA_RQ_SCHED_DEADLINE	1
+
+enum rq_entry_state {
+	RQ_ENTRY_QUEUED,
+	RQ_ENTRY_ACTIVE,	/* picked by the dispatcher */
+	RQ_ENTRY_DONE
+};
+
+struct xdma_rq_entry {
+	struct list_head list;
+	struct xdma_request_cb *req;
+	u64 ep_start;		/* card address range */
+	u64 ep_end;
+	unsigned long deadline;	/* jiffies */
+	int timeout_ms;
+	bool mergeable;		/* AXI-MM, one contiguous card range */
+	enum rq_entry_state state;
+	int rv;
+	ssize_t done;
+};
+
+struct xdma_rq_stats {
+	u32 depth;		/* requests queued, not yet dispatched */
+	u32 depth_max;
+	u64 requests;		/* requests completed */
+	u64 batches;		/* requests run on the engine after merging */
+	u64 merged;		/* requests merged into another one */
+	u64 desc_merged;	/* descriptors saved by coalescing */
+	u64 expired;		/* deadline, dispatched out of address order */
+};
+
+struct xdma_rq {
+	spinlock_t lock;
+	struct list_head queue;	/* entries waiting to be dispatched */
+	wait_queue_head_t wq;	/* submitters waiting for their entry */
+	int dispatching;	/* flag if a submitter is dispatching */
+	u64 ep_pos;		/* card address the last batch ended at */
+	struct xdma_rq_stats stats;
+};
+
 struct xdma_engine {
 	unsigned long magic;	/* structure ID for sanity checks */
 	struct xdma_dev *xdev;	/* parent device */
@@ -469,6 +555,14 @@ struct xdma_engine {
 	/* for copy from cyclic buffer to user buffer */
 	unsigned int user_buffer_index;
 
+	/* Request queue, serializes and merges xdma_xfer_submit() */
+	struct xdma_rq rq;
+
+	/* Members applicable to AXI-MM C2H frame grabber mode */
+	struct xdma_frame_ring *frame_ring;
+	struct mutex frame_lock;	/* serializes frame ring setup/teardown */
+	wait_queue_head_t frame_wq;	/* poll() waiters, outlives the ring */
+
 	/* Members associated with polled mode support */
 	u8 *poll_mode_addr_virt;	/* virt addr for descriptor writeback */
 	dma_addr_t poll_mode_bus;	/* bus addr for descriptor writeback */
@@ -625,4 +719,17 @@ ssize_t xdma_engine_read_cyclic(struct xdma_engine *, char __user *, size_t,
 			 int);
 int engine_addrmode_set(struct xdma_engine *engine, unsigned long arg);
 
+int xdma_frame_ring_setup(struct xdma_engine *engine, u64 ep_addr,
+			unsigned int frame_len, unsigned int frames, void *owner,
+			size_t *mmap_size);
+int xdma_frame_ring_teardown(struct xdma_engine *engine, void *owner);
+int xdma_frame_ring_mmap(struct xdma_engine *engine,
+			struct vm_area_struct *vma);
+unsigned int xdma_frame_ring_poll(struct xdma_engine *engine,
+			struct file *file, poll_table *wait);
+size_t xdma_frame_ring_mmap_size(struct xdma_frame_ring *ring);
+
+void xdma_engine_rq_stats(struct xdma_engine *engine,
+			struct xdma_rq_stats *stats);
+
 #endif /* XDMA_LIB_H */
@@ -0,0 +1,63 @@
+/*
+ * This file is part of the Xilinx DMA IP Core driver for Linux
+ *
+ * Copyright (c) 2016-present,  Xilinx, Inc.
+ * All rights reserved.
+ *
+ * This source code is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM xdma
+
+#if !defined(__XDMA_TRACE_H__) || defined(TRACE_HEADER_MULTI_READ)
+#define __XDMA_TRACE_H__
+
+#include <linux/tracepoint.h>
+#include <linux/version.h>
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,10,0)
+#define xdma_assign_str(dst, src)	__assign_str(dst)
+#else
+#define xdma_assign_str(dst, src)	__assign_str(dst, src)
+#endif
+
+/* duration of each phase of xdma_device_open() */
+TRACE_EVENT(xdma_probe_phase,
+	TP_PROTO(const char *dev, const char *phase, s64 ns),
+
+	TP_ARGS(dev, phase, ns),
+
+	TP_STRUCT__entry(
+		__string(dev, dev)
+		__string(phase, phase)
+		__field(s64, ns)
+	),
+
+	TP_fast_assign(
+		xdma_assign_str(dev, dev);
+		xdma_assign_str(phase, phase);
+		__entry->ns = ns;
+	),
+
+	TP_printk("%s %s %lld ns", __get_str(dev), __get_str(phase),
+		__entry->ns)
+);
+
+#endif /* __XDMA_TRACE_H__ */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE xdma_trace
+#include <trace/define_trace.h>
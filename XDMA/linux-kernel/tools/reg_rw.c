@@ -22,6 +22,9 @@
 
 #include <sys/types.h>
 #include <sys/mman.h>
+#include <sys/ioctl.h>
+
+#include "../xdma/cdev_ctrl.h"
 
 /* ltoh: little to host */
 /* htol: little to host */
@@ -42,6 +45,114 @@
 #define MAP_SIZE (32*1024UL)
 #define MAP_MASK (MAP_SIZE - 1)
 
+static struct xdma_ioc_reg regs[XDMA_IOC_REGV_MAX];
+
+static int regv_flush(int fd, unsigned int count)
+{
+	struct xdma_ioc_regv regv;
+	unsigned int i;
+	int rv;
+
+	if (!count)
+		return 0;
+
+	memset(&regv, 0, sizeof(regv));
+	regv.base.magic = XDMA_XCL_MAGIC;
+	regv.base.command = XDMA_IOC_REGV;
+	regv.count = count;
+	regv.regs = (unsigned long)regs;
+
+	rv = ioctl(fd, XDMA_IOCREGV, &regv);
+	if (rv < 0) {
+		fprintf(stderr, "regv failed at entry %u/%u, offset 0x%08x: %s\n",
+			regv.done, count, regs[regv.done].offset,
+			strerror(errno));
+		return rv;
+	}
+
+	for (i = 0; i < count; i++)
+		if (regs[i].op != XDMA_REG_OP_WRITE)
+			printf("0x%08x: 0x%08x\n", regs[i].offset,
+				regs[i].value);
+	return 0;
+}
+
+/*
+ * execute a register script in as few ioctls as possible, one op per line:
+ *	r <address>
+ *	w <address> <data>
+ *	m <address> <data> <mask>	(read-modify-write)
+ *	p <address> <data> <mask>	(poll until (reg & mask) == data & mask)
+ */
+static int run_script(const char *device, const char *fname)
+{
+	char line[256];
+	unsigned int count = 0;
+	unsigned int lineno = 0;
+	FILE *fp;
+	int fd;
+	int rv = 0;
+
+	fp = strcmp(fname, "-") ? fopen(fname, "r") : stdin;
+	if (!fp)
+		FATAL;
+	if ((fd = open(device, O_RDWR | O_SYNC)) == -1)
+		FATAL;
+
+	while (fgets(line, sizeof(line), fp)) {
+		struct xdma_ioc_reg *r = &regs[count];
+		char op;
+		unsigned int offset, value = 0, mask = 0xFFFFFFFF;
+		int n;
+
+		lineno++;
+		n = sscanf(line, " %c %i %i %i", &op, &offset, &value, &mask);
+		if (n < 1 || op == '#')
+			continue;
+
+		switch (tolower(op)) {
+		case 'r':
+			r->op = XDMA_REG_OP_READ;
+			break;
+		case 'w':
+			r->op = XDMA_REG_OP_WRITE;
+			break;
+		case 'm':
+			r->op = XDMA_REG_OP_RMW;
+			break;
+		case 'p':
+			r->op = XDMA_REG_OP_POLL;
+			break;
+		default:
+			n = 0;
+			break;
+		}
+		if (n < 2 || (n < 3 && r->op != XDMA_REG_OP_READ)) {
+			fprintf(stderr, "%s:%u: bad line: %s", fname, lineno,
+				line);
+			rv = -EINVAL;
+			break;
+		}
+		r->offset = offset;
+		r->value = value;
+		r->mask = mask;
+
+		if (++count == XDMA_IOC_REGV_MAX) {
+			rv = regv_flush(fd, count);
+			if (rv < 0)
+				break;
+			count = 0;
+		}
+	}
+	if (!rv)
+		rv = regv_flush(fd, count);
+
+	close(fd);
+	if (fp != stdin)
+		fclose(fp);
+	return rv < 0 ? 1 : 0;
+}
+
 int main(int argc, char **argv)
 {
 	int fd;
@@ -59,11 +170,20 @@ int main(int argc, char **argv)
 			"\tdevice  : character device to access\n"
 			"\taddress : memory address to access\n"
 			"\ttype    : access operation type : [b]yte, [h]alfword, [w]ord\n"
-			"\tdata    : data to be written for a write\n\n",
-			argv[0]);
+			"\tdata    : data to be written for a write\n\n"
+			"\t%s <device> -f <script>\n"
+			"\tscript  : file (or - for stdin) of register ops, "
+			"one per line:\n"
+			"\t\t  r <address> | w <address> <data> |\n"
+			"\t\t  m <address> <data> <mask> | "
+			"p <address> <data> <mask>\n\n",
+			argv[0], argv[0]);
 		exit(1);
 	}
 
+	if (argc >= 4 && !strcmp(argv[2], "-f"))
+		return run_script(argv[1], argv[3]);
+
 	printf("argc = %d\n", argc);
 
 	device = strdup(argv[1]);
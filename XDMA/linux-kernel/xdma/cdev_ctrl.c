@@ -20,6 +20,7 @@
 #define pr_fmt(fmt)     KBUILD_MODNAME ":%s: " fmt, __func__
 
 #include <linux/ioctl.h>
+#include <linux/iopoll.h>
 #include "version.h"
 #include "xdma_cdev.h"
 #include "cdev_ctrl.h"
@@ -119,6 +120,124 @@ static long version_ioctl(struct xdma_cdev *xcdev, void __user *arg)
 	return 0;
 }
 
+static int regv_exec_one(void __iomem *base, struct xdma_ioc_reg *r,
+			unsigned int poll_timeout_us)
+{
+	void __iomem *reg = base + r->offset;
+	int rv;
+	u32 w;
+
+	switch (r->op) {
+	case XDMA_REG_OP_READ:
+		r->value = ioread32(reg);
+		break;
+	case XDMA_REG_OP_WRITE:
+		iowrite32(r->value, reg);
+		break;
+	case XDMA_REG_OP_RMW:
+		w = ioread32(reg);
+		iowrite32((w & ~r->mask) | (r->value & r->mask), reg);
+		r->value = w;
+		break;
+	case XDMA_REG_OP_POLL:
+		rv = readl_poll_timeout(reg, w,
+				(w & r->mask) == (r->value & r->mask),
+				10, poll_timeout_us);
+		r->value = w;
+		return rv;
+	default:
+		pr_info("UNKNOWN reg op %u.\n", r->op);
+		return -EINVAL;
+	}
+	return 0;
+}
+
+static long regv_ioctl(struct xdma_cdev *xcdev, void __user *arg)
+{
+	struct xdma_ioc_regv obj;
+	struct xdma_dev *xdev = xcdev->xdev;
+	struct xdma_ioc_reg *regs;
+	void __iomem *base = xdev->bar[xcdev->bar];
+	resource_size_t bar_len = pci_resource_len(xdev->pdev, xcdev->bar);
+	unsigned int poll_timeout_us;
+	unsigned int i;
+	size_t size;
+	int rv = 0;
+
+	if (copy_from_user((void *)&obj, arg, sizeof(struct xdma_ioc_regv)))
+		return -EFAULT;
+
+	if (!obj.count)
+		return 0;
+	if (obj.count > XDMA_IOC_REGV_MAX) {
+		pr_info("regv count %u > %u.\n", obj.count,
+			XDMA_IOC_REGV_MAX);
+		return -EINVAL;
+	}
+
+	if (obj.poll_timeout_us > XDMA_IOC_REGV_POLL_TIMEOUT_MAX) {
+		pr_info("regv poll timeout %u > %u us.\n", obj.poll_timeout_us,
+			XDMA_IOC_REGV_POLL_TIMEOUT_MAX);
+		return -EINVAL;
+	}
+	if (bar_len > INT_MAX)
+		bar_len = INT_MAX;
+
+	size = obj.count * sizeof(struct xdma_ioc_reg);
+	regs = kvmalloc(size, GFP_KERNEL);
+	if (!regs)
+		return -ENOMEM;
+
+	if (copy_from_user(regs, (void __user *)(unsigned long)obj.regs,
+				size)) {
+		rv = -EFAULT;
+		goto free_regs;
+	}
+
+	/* validate the whole vector before touching any register */
+	for (i = 0; i < obj.count; i++) {
+		if ((regs[i].offset & 3) || regs[i].offset > bar_len - 4 ||
+		    regs[i].op > XDMA_REG_OP_POLL) {
+			pr_info("regv %u: bad op %u, offset 0x%x.\n",
+				i, regs[i].op, regs[i].offset);
+			obj.done = i;
+			rv = -EINVAL;
+			goto copy_back;
+		}
+	}
+
+	poll_timeout_us = obj.poll_timeout_us ? obj.poll_timeout_us :
+				XDMA_IOC_REGV_POLL_TIMEOUT_DFLT;
+
+	/* exclusive access for the whole sequence */
+	if (mutex_lock_interruptible(&xcdev->regv_lock)) {
+		rv = -ERESTARTSYS;
+		goto free_regs;
+	}
+	for (i = 0; i < obj.count; i++) {
+		if (fatal_signal_pending(current)) {
+			rv = -EINTR;
+			break;
+		}
+		rv = regv_exec_one(base, &regs[i], poll_timeout_us);
+		if (rv < 0)
+			break;
+	}
+	mmiowb();
+	mutex_unlock(&xcdev->regv_lock);
+	obj.done = i;
+
+	if (copy_to_user((void __user *)(unsigned long)obj.regs, regs, size))
+		rv = -EFAULT;
+
+copy_back:
+	if (copy_to_user(arg, &obj, sizeof(struct xdma_ioc_regv)))
+		rv = -EFAULT;
+free_regs:
+	kvfree(regs);
+	return rv;
+}
+
 long char_ctrl_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 {
 	struct xdma_cdev *xcdev = (struct xdma_cdev *)filp->private_data;
@@ -136,7 +255,7 @@ long char_ctrl_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 		pr_info("cmd %u, xdev NULL.\n", cmd);
 		return -EINVAL;
 	}
-	pr_info("cmd 0x%x, xdev 0x%p, pdev 0x%p.\n", cmd, xdev, xdev->pdev);
+	dbg_sg("cmd 0x%x, xdev 0x%p, pdev 0x%p.\n", cmd, xdev, xdev->pdev);
 
 	if (_IOC_TYPE(cmd) != XDMA_IOC_MAGIC) {
 		pr_err("cmd %u, bad magic 0x%x/0x%x.\n",
@@ -176,6 +295,19 @@ long char_ctrl_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 	case XDMA_IOCONLINE:
 		xdma_device_online(xdev->pdev, xdev);
 		break;
+	case XDMA_IOCREGV:
+		if (copy_from_user((void *)&ioctl_obj, (void *) arg,
+			 sizeof(struct xdma_ioc_base))) {
+			pr_err("copy_from_user failed.\n");
+			return -EFAULT;
+		}
+
+		if (ioctl_obj.magic != XDMA_XCL_MAGIC) {
+			pr_err("magic 0x%x !=  XDMA_XCL_MAGIC (0x%x).\n",
+				ioctl_obj.magic, XDMA_XCL_MAGIC);
+			return -ENOTTY;
+		}
+		return regv_ioctl(xcdev, (void __user *)arg);
 	default:
 		pr_err("UNKNOWN ioctl cmd 0x%x.\n", cmd);
 		return -ENOTTY;
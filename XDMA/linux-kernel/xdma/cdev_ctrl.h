@@ -51,6 +51,7 @@ enum XDMA_IOC_TYPES {
 	XDMA_IOC_INFO,
 	XDMA_IOC_OFFLINE,
 	XDMA_IOC_ONLINE,
+	XDMA_IOC_REGV,
 	XDMA_IOC_MAX
 };
 
@@ -74,11 +75,56 @@ struct xdma_ioc_info {
 	unsigned char		func;
 };
 
+/*
+ * vectored register access
+ *
+ * an array of register operations is executed in order in a single ioctl,
+ * with the character device locked for the whole sequence, the POLL
+ * entries sleep between the reads.
+ * - READ:  value <- reg
+ * - WRITE: reg <- value
+ * - RMW:   reg <- (reg & ~mask) | (value & mask), value <- old reg
+ * - POLL:  read reg until (reg & mask) == (value & mask) or poll_timeout_us
+ *	    expires, value <- last reg read
+ */
+enum xdma_ioc_reg_op {
+	XDMA_REG_OP_READ,
+	XDMA_REG_OP_WRITE,
+	XDMA_REG_OP_RMW,
+	XDMA_REG_OP_POLL,
+};
+
+/* max. number of entries per XDMA_IOCREGV call */
+#define XDMA_IOC_REGV_MAX		4096
+/* poll timeout used when poll_timeout_us is 0 */
+#define XDMA_IOC_REGV_POLL_TIMEOUT_DFLT	1000
+/* max. poll_timeout_us */
+#define XDMA_IOC_REGV_POLL_TIMEOUT_MAX	100000
+
+struct xdma_ioc_reg {
+	unsigned int		op;	/* enum xdma_ioc_reg_op */
+	unsigned int		offset;	/* BAR offset, 32-bit aligned */
+	unsigned int		value;
+	unsigned int		mask;
+};
+
+struct xdma_ioc_regv {
+	struct xdma_ioc_base	base;
+	unsigned int		count;		/* # of entries in regs */
+	unsigned int		poll_timeout_us;
+	/* out: # of entries executed, index of the failing one on error */
+	unsigned int		done;
+	unsigned int		rsvd;
+	unsigned long long	regs;		/* struct xdma_ioc_reg * */
+};
+
 /* IOCTL codes */
 #define XDMA_IOCINFO		_IOWR(XDMA_IOC_MAGIC, XDMA_IOC_INFO, \
 					struct xdma_ioc_info)
 #define XDMA_IOCOFFLINE		_IO(XDMA_IOC_MAGIC, XDMA_IOC_OFFLINE)
 #define XDMA_IOCONLINE		_IO(XDMA_IOC_MAGIC, XDMA_IOC_ONLINE)
+#define XDMA_IOCREGV		_IOWR(XDMA_IOC_MAGIC, XDMA_IOC_REGV, \
+					struct xdma_ioc_regv)
 
 #define IOCTL_XDMA_ADDRMODE_SET	_IOW('q', 4, int)
 #define IOCTL_XDMA_ADDRMODE_GET	_IOR('q', 5, int)
@@ -23,6 +23,7 @@
 #include "libxdma_api.h"
 #include "xdma_cdev.h"
 #include "cdev_sgdma.h"
+#include "xdma_dmabuf.h"
 
 /* Module Parameters */
 unsigned int sgdma_timeout = 10;
@@ -462,6 +463,227 @@ static int ioctl_do_align_get(struct xdma_engine *engine, unsigned long arg)
 	return put_user(engine->addr_align, (int __user *)arg);
 }
 
+static int ioctl_do_dmabuf_export(struct xdma_engine *engine,
+				unsigned long arg)
+{
+	struct xdma_dmabuf_export obj;
+	int fd;
+
+	if (copy_from_user(&obj, (void __user *)arg, sizeof(obj)))
+		return -EFAULT;
+	if (obj.flags || !obj.size)
+		return -EINVAL;
+
+	fd = xdma_dmabuf_export(obj.size);
+	if (fd < 0)
+		return fd;
+
+	/* the fd is already installed, user space owns it from here on */
+	obj.fd = fd;
+	if (copy_to_user((void __user *)arg, &obj, sizeof(obj)))
+		return -EFAULT;
+
+	return 0;
+}
+
+static int ioctl_do_dmabuf_xfer(struct xdma_engine *engine, unsigned long arg)
+{
+	struct xdma_dmabuf_xfer obj;
+	struct xdma_dmabuf_import imp;
+	bool write = engine->dir == DMA_TO_DEVICE;
+	ssize_t res;
+	int rv;
+
+	if (copy_from_user(&obj, (void __user *)arg, sizeof(obj)))
+		return -EFAULT;
+	if (obj.flags)
+		return -EINVAL;
+
+	if (engine->streaming && engine->dir == DMA_FROM_DEVICE) {
+		pr_info("%s, dma-buf xfer not supported on AXI-ST C2H.\n",
+			engine->name);
+		return -EINVAL;
+	}
+
+	/* the window starts at a page aligned dma-buf, so offset stands in
+	 * for the host address in the alignment check */
+	rv = check_transfer_align(engine, (const char __user *)
+				(uintptr_t)obj.offset, obj.len, obj.ep_addr, 1);
+	if (rv) {
+		pr_info("Invalid transfer alignment detected\n");
+		return rv;
+	}
+
+	rv = xdma_dmabuf_import(engine->xdev, obj.fd, obj.offset, obj.len,
+				write, &imp);
+	if (rv < 0)
+		return rv;
+
+	res = xdma_xfer_submit(engine->xdev, engine->channel, write,
+				obj.ep_addr, &imp.sgt, 1,
+				sgdma_timeout * 1000);
+
+	xdma_dmabuf_import_release(&imp);
+
+	if (res < 0)
+		return res;
+
+	obj.done = res;
+	if (copy_to_user((void __user *)arg, &obj, sizeof(obj)))
+		return -EFAULT;
+
+	return 0;
+}
+
+static int ioctl_do_xfer_regions(struct xdma_engine *engine, unsigned long arg)
+{
+	struct xdma_xfer_regions obj;
+	struct xdma_ep_region *regions;
+	struct xdma_io_cb cb;
+	bool write = engine->dir == DMA_TO_DEVICE;
+	unsigned int nr;
+	unsigned int i;
+	u64 total = 0;
+	ssize_t res;
+	int rv;
+
+	if (copy_from_user(&obj, (void __user *)arg, sizeof(obj)))
+		return -EFAULT;
+
+	if (engine->streaming || engine->non_incr_addr) {
+		pr_info("%s, regions need AXI-MM incremental addressing.\n",
+			engine->name);
+		return -EINVAL;
+	}
+
+	nr = obj.regions ? obj.nr_regions : obj.rows;
+	if (!nr || nr > XDMA_XFER_REGIONS_MAX || !obj.len ||
+	    obj.len > UINT_MAX)
+		return -EINVAL;
+
+	regions = kcalloc(nr, sizeof(*regions), GFP_KERNEL);
+	if (!regions)
+		return -ENOMEM;
+
+	if (obj.regions) {
+		/* struct xdma_region and struct xdma_ep_region match */
+		BUILD_BUG_ON(sizeof(struct xdma_region) != sizeof(*regions));
+		if (copy_from_user(regions, (void __user *)obj.regions,
+				nr * sizeof(*regions))) {
+			rv = -EFAULT;
+			goto free_regions;
+		}
+	} else {
+		if (!obj.row_len || obj.stride < obj.row_len) {
+			rv = -EINVAL;
+			goto free_regions;
+		}
+		for (i = 0; i < nr; i++) {
+			regions[i].ep_addr = obj.base + i * obj.stride;
+			regions[i].len = obj.row_len;
+		}
+	}
+
+	/* each region starts at its own host offset, check them all */
+	for (i = 0; i < nr; i++) {
+		rv = check_transfer_align(engine, (const char __user *)
+					(uintptr_t)(obj.buf + total),
+					regions[i].len, regions[i].ep_addr, 1);
+		if (rv) {
+			pr_info("Invalid transfer alignment, region %u.\n", i);
+			goto free_regions;
+		}
+		if (check_add_overflow(total, regions[i].len, &total) ||
+		    total > obj.len)
+			break;
+	}
+	if (i < nr || total != obj.len) {
+		pr_info("regions len %llu != buffer len %llu.\n",
+			total, obj.len);
+		rv = -EINVAL;
+		goto free_regions;
+	}
+
+	memset(&cb, 0, sizeof(struct xdma_io_cb));
+	cb.buf = (char __user *)(uintptr_t)obj.buf;
+	cb.len = obj.len;
+	rv = char_sgdma_map_user_buf_to_sgl(&cb, write);
+	if (rv < 0)
+		goto free_regions;
+
+	res = xdma_xfer_submit_regions(engine->xdev, engine->channel, write,
+				regions, nr, &cb.sgt, 0,
+				sgdma_timeout * 1000);
+
+	char_sgdma_unmap_user_buf(&cb, write);
+
+	if (res < 0) {
+		rv = res;
+		goto free_regions;
+	}
+
+	obj.done = res;
+	rv = 0;
+	if (copy_to_user((void __user *)arg, &obj, sizeof(obj)))
+		rv = -EFAULT;
+
+free_regions:
+	kfree(regions);
+	return rv;
+}
+
+static int ioctl_do_rq_stats_get(struct xdma_engine *engine,
+				unsigned long arg)
+{
+	struct xdma_rq_stats stats;
+	struct xdma_rq_stats_ioctl obj;
+
+	xdma_engine_rq_stats(engine, &stats);
+
+	memset(&obj, 0, sizeof(obj));
+	obj.depth = stats.depth;
+	obj.depth_max = stats.depth_max;
+	obj.requests = stats.requests;
+	obj.batches = stats.batches;
+	obj.merged = stats.merged;
+	obj.desc_merged = stats.desc_merged;
+	obj.expired = stats.expired;
+
+	if (copy_to_user((void __user *)arg, &obj, sizeof(obj)))
+		return -EFAULT;
+
+	return 0;
+}
+
+static int ioctl_do_frame_start(struct xdma_engine *engine, struct file *file,
+				unsigned long arg)
+{
+	struct xdma_frame_ring_ioctl obj;
+	size_t mmap_size;
+	int rv;
+
+	if (copy_from_user(&obj, (void __user *)arg, sizeof(obj)))
+		return -EFAULT;
+
+	rv = xdma_frame_ring_setup(engine, obj.ep_addr, obj.frame_len,
+				obj.frames, file, &mmap_size);
+	if (rv < 0)
+		return rv;
+
+	obj.mmap_size = mmap_size;
+	if (copy_to_user((void __user *)arg, &obj, sizeof(obj))) {
+		xdma_frame_ring_teardown(engine, file);
+		return -EFAULT;
+	}
+
+	return 0;
+}
+
+static int ioctl_do_frame_stop(struct xdma_engine *engine, struct file *file)
+{
+	return xdma_frame_ring_teardown(engine, file);
+}
+
 static long char_sgdma_ioctl(struct file *file, unsigned int cmd,
                 unsigned long arg)
 {
@@ -497,6 +719,24 @@ static long char_sgdma_ioctl(struct file *file, unsigned int cmd,
 	case IOCTL_XDMA_ALIGN_GET:
 		rv = ioctl_do_align_get(engine, arg);
 		break;
+	case IOCTL_XDMA_DMABUF_EXPORT:
+		rv = ioctl_do_dmabuf_export(engine, arg);
+		break;
+	case IOCTL_XDMA_DMABUF_XFER:
+		rv = ioctl_do_dmabuf_xfer(engine, arg);
+		break;
+	case IOCTL_XDMA_FRAME_START:
+		rv = ioctl_do_frame_start(engine, file, arg);
+		break;
+	case IOCTL_XDMA_FRAME_STOP:
+		rv = ioctl_do_frame_stop(engine, file);
+		break;
+	case IOCTL_XDMA_XFER_REGIONS:
+		rv = ioctl_do_xfer_regions(engine, arg);
+		break;
+	case IOCTL_XDMA_RQ_STATS_GET:
+		rv = ioctl_do_rq_stats_get(engine, arg);
+		break;
         default:
                 dbg_perf("Unsupported operation\n");
                 rv = -EINVAL;
@@ -506,6 +746,31 @@ static long char_sgdma_ioctl(struct file *file, unsigned int cmd,
         return rv;
 }
 
+static int char_sgdma_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct xdma_cdev *xcdev = (struct xdma_cdev *)file->private_data;
+	int rv;
+
+	rv = xcdev_check(__func__, xcdev, 1);
+	if (rv < 0)
+		return rv;
+
+	/* only the frame grabber ring can be mapped */
+	return xdma_frame_ring_mmap(xcdev->engine, vma);
+}
+
+static unsigned int char_sgdma_poll(struct file *file, poll_table *wait)
+{
+	struct xdma_cdev *xcdev = (struct xdma_cdev *)file->private_data;
+	int rv;
+
+	rv = xcdev_check(__func__, xcdev, 1);
+	if (rv < 0)
+		return POLLERR;
+
+	return xdma_frame_ring_poll(xcdev->engine, file, wait);
+}
+
 static int char_sgdma_open(struct inode *inode, struct file *file)
 {
 	struct xdma_cdev *xcdev;
@@ -538,6 +803,9 @@ static int char_sgdma_close(struct inode *inode, struct file *file)
 
 	engine = xcdev->engine;
 
+	/* no-op unless this file owns the frame ring */
+	xdma_frame_ring_teardown(engine, file);
+
 	if (engine->streaming && engine->dir == DMA_FROM_DEVICE) {
 		engine->device_open = 0;
 		if (engine->cyclic_req)
@@ -554,6 +822,8 @@ static const struct file_operations sgdma_fops = {
 	.read = char_sgdma_read,
 	.unlocked_ioctl = char_sgdma_ioctl,
 	.llseek = char_sgdma_llseek,
+	.mmap = char_sgdma_mmap,
+	.poll = char_sgdma_poll,
 };
 
 void cdev_sgdma_init(struct xdma_cdev *xcdev)
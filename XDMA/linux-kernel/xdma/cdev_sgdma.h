@@ -60,6 +60,119 @@ struct xdma_performance_ioctl
 };
 
 
+/*
+ * dma-buf support
+ *
+ * IOCTL_XDMA_DMABUF_EXPORT allocates a host buffer of at least size bytes and
+ * returns it as a dma-buf fd, usable for mmap() and by any dma-buf importer.
+ * size is limited to XDMA_DMABUF_SIZE_MAX and to half of the system memory.
+ *
+ * IOCTL_XDMA_DMABUF_XFER runs a transfer between [offset, offset + len) of
+ * the dma-buf fd (exported by this driver or by e.g. udmabuf) and the card
+ * address ep_addr, in the direction of the engine the ioctl is issued on.
+ * The number of bytes transferred is returned in done.
+ */
+#define XDMA_DMABUF_SIZE_MAX	(1ULL << 32)
+
+struct xdma_dmabuf_export {
+	uint64_t size;
+	uint32_t flags;		/* reserved, must be 0 */
+	int32_t fd;		/* out */
+};
+
+struct xdma_dmabuf_xfer {
+	int32_t fd;
+	uint32_t flags;		/* reserved, must be 0 */
+	uint64_t offset;	/* into the dma-buf */
+	uint64_t len;
+	uint64_t ep_addr;	/* card address */
+	uint64_t done;		/* out */
+};
+
+/*
+ * frame grabber mode (AXI-MM C2H)
+ *
+ * IOCTL_XDMA_FRAME_START sets up a ring of frames host buffers of frame_len
+ * bytes each and keeps the engine cycling through it, reading the card window
+ * [ep_addr, ep_addr + frame_len) into one frame after the other without
+ * stopping. IOCTL_XDMA_FRAME_STOP stops the engine and frees the ring; closing
+ * the file that started the ring does the same.
+ *
+ * The status area and the frames are mmap()ed from the cdev at offset 0,
+ * see struct xdma_frame_status for the layout. Frame number n is placed in
+ * slot n % frames. poll() reports POLLIN as long as seq != consumed, user space
+ * advances consumed once it is done with a frame. Frames are overwritten
+ * regardless of consumed; seq - consumed >= frames means frames were lost.
+ */
+#define XDMA_FRAME_RING_MAX	256
+
+struct xdma_frame_info {
+	uint64_t seq;		/* frame number held by the slot */
+	uint64_t timestamp_ns;	/* CLOCK_MONOTONIC at completion service */
+};
+
+struct xdma_frame_status {
+	uint64_t seq;		/* # of frames completed, set by the driver */
+	uint64_t consumed;	/* # of frames consumed, set by user space */
+	uint32_t frames;
+	uint32_t frame_len;
+	uint32_t error;		/* engine status when it stopped on an error */
+	uint32_t rsvd;
+	uint64_t frame_offset;	/* mmap offset of slot 0 */
+	uint64_t frame_stride;	/* mmap distance between slots */
+	struct xdma_frame_info info[0];
+};
+
+struct xdma_frame_ring_ioctl {
+	uint64_t ep_addr;
+	uint32_t frame_len;
+	uint32_t frames;
+	uint64_t mmap_size;	/* out: status area + all frames */
+};
+
+/*
+ * multi-region transfers (AXI-MM, incremental addressing)
+ *
+ * IOCTL_XDMA_XFER_REGIONS moves the host buffer [buf, buf + len) to/from a
+ * list of card address ranges in a single request: the host buffer is
+ * consumed in order, regions[0].len bytes at regions[0].ep_addr, then
+ * regions[1], etc. The region lengths must add up to len.
+ *
+ * With regions == 0 the card side is a 2D window instead: rows of row_len
+ * bytes, starting at base, stride bytes apart.
+ * The number of bytes transferred is returned in done.
+ */
+#define XDMA_XFER_REGIONS_MAX	4096
+
+struct xdma_region {
+	uint64_t ep_addr;
+	uint64_t len;
+};
+
+struct xdma_xfer_regions {
+	uint64_t buf;		/* host buffer */
+	uint64_t len;
+	uint64_t regions;	/* struct xdma_region array, or 0 for 2D */
+	uint32_t nr_regions;
+	uint32_t rows;		/* 2D only */
+	uint64_t base;		/* 2D only */
+	uint64_t row_len;	/* 2D only */
+	uint64_t stride;	/* 2D only */
+	uint64_t done;		/* out */
+};
+
+/*
+ * engine request queue statistics, see the rq_* module parameters
+ */
+struct xdma_rq_stats_ioctl {
+	uint32_t depth;		/* requests queued, not yet dispatched */
+	uint32_t depth_max;
+	uint64_t requests;	/* requests completed */
+	uint64_t batches;	/* requests run on the engine after merging */
+	uint64_t merged;	/* requests merged into another one */
+	uint64_t desc_merged;	/* descriptors saved by coalescing */
+	uint64_t expired;	/* deadline, dispatched out of address order */
+};
 
 /* IOCTL codes */
 
@@ -69,5 +182,11 @@ struct xdma_performance_ioctl
 #define IOCTL_XDMA_ADDRMODE_SET _IOW('q', 4, int)
 #define IOCTL_XDMA_ADDRMODE_GET _IOR('q', 5, int)
 #define IOCTL_XDMA_ALIGN_GET    _IOR('q', 6, int)
+#define IOCTL_XDMA_DMABUF_EXPORT _IOWR('q', 7, struct xdma_dmabuf_export)
+#define IOCTL_XDMA_DMABUF_XFER  _IOWR('q', 8, struct xdma_dmabuf_xfer)
+#define IOCTL_XDMA_FRAME_START  _IOWR('q', 9, struct xdma_frame_ring_ioctl)
+#define IOCTL_XDMA_FRAME_STOP   _IO('q', 10)
+#define IOCTL_XDMA_XFER_REGIONS _IOWR('q', 11, struct xdma_xfer_regions)
+#define IOCTL_XDMA_RQ_STATS_GET _IOR('q', 12, struct xdma_rq_stats_ioctl)
 
 #endif /* _XDMA_IOCALLS_POSIX_H_ */
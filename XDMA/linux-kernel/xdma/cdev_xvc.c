@@ -55,6 +55,14 @@ inline u32 __read_register(const char *fn, void *base, unsigned int off)
 #endif /* #ifdef __REG_DEBUG__ */
 
 
+/* per open file state */
+struct xvc_file {
+	struct xdma_cdev *xcdev;
+	struct mutex lock;	/* protects buffer */
+	unsigned char *buffer;	/* tms, tdi, tdo and the batch lengths */
+	size_t buffer_len;
+};
+
 static int xvc_shift_bits(void *base, u32 tms_bits, u32 tdi_bits,
 			u32 *tdo_bits)
 {
@@ -90,38 +98,92 @@ static int xvc_shift_bits(void *base, u32 tms_bits, u32 tdi_bits,
 	return 0;
 }
 
-static long xvc_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
+/*
+ * shift total_bits bits, 32 at a time. *length caches the value of the
+ * length register, so that it is only written when it changes.
+ */
+static int xvc_shift(void __iomem *iobase, unsigned int total_bits,
+		unsigned char *tms_buf, unsigned char *tdi_buf,
+		unsigned char *tdo_buf, unsigned int *length)
 {
-        struct xdma_cdev *xcdev = (struct xdma_cdev *)filp->private_data;
-	struct xdma_dev *xdev;
-	struct xvc_ioc xvc_obj;
-	unsigned int opcode;
-	unsigned int total_bits;
-	unsigned int total_bytes;
-	unsigned char *buffer = NULL;
-	unsigned char *tms_buf = NULL;
-	unsigned char *tdi_buf = NULL;
-	unsigned char *tdo_buf = NULL;
 	unsigned int bits, bits_left;
-	void __iomem *iobase;
 	int rv;
 
-	rv = xcdev_check(__func__, xcdev, 0);
-	if (rv < 0)
-		return rv;
-	xdev = xcdev->xdev;
+	for (bits = 0, bits_left = total_bits; bits < total_bits; bits += 32,
+		bits_left -= 32) {
+		unsigned int bytes = bits >> 3;
+		unsigned int shift_bits = bits_left < 32 ? bits_left : 32;
+		unsigned int shift_bytes = (shift_bits + 7) >> 3;
+		u32 tms_store = 0;
+		u32 tdi_store = 0;
+		u32 tdo_store = 0;
 
-	if (cmd != XDMA_IOCXVC) {
-		pr_info("ioctl 0x%x, UNKNOWN cmd.\n", cmd);
-		return -ENOIOCTLCMD;
+		/* set number of bits to shift out */
+		if (*length != shift_bits) {
+			write_register(shift_bits, iobase, XVC_BAR_LENGTH_REG);
+			*length = shift_bits;
+		}
+
+		memcpy(&tms_store, tms_buf + bytes, shift_bytes);
+		memcpy(&tdi_store, tdi_buf + bytes, shift_bytes);
+
+		/* Shift data out and copy to output buffer */
+		rv = xvc_shift_bits(iobase, tms_store, tdi_store, &tdo_store);
+		if (rv < 0)
+			return rv;
+
+		memcpy(tdo_buf + bytes, &tdo_store, shift_bytes);
 	}
 
+	return 0;
+}
+
+/*
+ * grow the per open buffer, called with xf->lock held. Like krealloc() the
+ * current content is kept, and on failure the old buffer stays in place.
+ */
+static unsigned char *xvc_buffer_get(struct xvc_file *xf, size_t len)
+{
+	unsigned char *buffer;
+
+	if (len <= xf->buffer_len)
+		return xf->buffer;
+
+	buffer = kvmalloc(len, GFP_KERNEL);
+	if (!buffer) {
+		pr_info("OOM %lu.\n", (unsigned long)len);
+		return NULL;
+	}
+	if (xf->buffer_len)
+		memcpy(buffer, xf->buffer, xf->buffer_len);
+	kvfree(xf->buffer);
+	xf->buffer = buffer;
+	xf->buffer_len = len;
+
+	return xf->buffer;
+}
+
+static int xvc_ioctl_shift(struct xvc_file *xf, unsigned long arg)
+{
+	struct xdma_cdev *xcdev = xf->xcdev;
+	struct xdma_dev *xdev = xcdev->xdev;
+	struct xvc_ioc xvc_obj;
+	unsigned int opcode;
+	unsigned int total_bits;
+	unsigned int total_bytes;
+	unsigned char *buffer;
+	unsigned char *tms_buf;
+	unsigned char *tdi_buf;
+	unsigned char *tdo_buf;
+	unsigned int length = 0;
+	int rv;
+
 	rv = copy_from_user((void *)&xvc_obj, (void __user *)arg,
 				sizeof(struct xvc_ioc));
 	/* anything not copied ? */
 	if (rv) {
 		pr_info("copy_from_user xvc_obj failed: %d.\n", rv);
-		goto cleanup;
+		return -EFAULT;
 	}
 
 	opcode = xvc_obj.opcode;
@@ -134,14 +196,12 @@ static long xvc_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 
 	total_bits = xvc_obj.length;
 	total_bytes = (total_bits + 7) >> 3;
+	if (total_bytes > XVC_BATCH_BYTES_MAX)
+		return -EINVAL;
 
-	buffer = (char *)kmalloc(total_bytes * 3, GFP_KERNEL);
-	if (!buffer) {
-		pr_info("OOM %u, op 0x%x, len %u bits, %u bytes.\n",
-			3 * total_bytes, opcode, total_bits, total_bytes);
-		rv = -ENOMEM;
-		goto cleanup;
-	}
+	buffer = xvc_buffer_get(xf, total_bytes * 3);
+	if (!buffer)
+		return -ENOMEM;
 	tms_buf = buffer;
 	tdi_buf = tms_buf + total_bytes;
 	tdo_buf = tdi_buf + total_bytes;
@@ -149,51 +209,26 @@ static long xvc_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 	rv = copy_from_user((void *)tms_buf, xvc_obj.tms_buf, total_bytes);
 	if (rv) {
 		pr_info("copy tmfs_buf failed: %d/%u.\n", rv, total_bytes);
-		goto cleanup;
+		return -EFAULT;
 	}
 	rv = copy_from_user((void *)tdi_buf, xvc_obj.tdi_buf, total_bytes);
 	if (rv) {
 		pr_info("copy tdi_buf failed: %d/%u.\n", rv, total_bytes);
-		goto cleanup;
+		return -EFAULT;
 	}
 
 	/* exclusive access */
 	spin_lock(&xcdev->lock);
-
-	iobase = xdev->bar[xcdev->bar] + xcdev->base;
-	/* set length register to 32 initially if more than one
-	 * word-transaction is to be done */
-	if (total_bits >= 32)
-		write_register(0x20, iobase, XVC_BAR_LENGTH_REG);
-
-	for (bits = 0, bits_left = total_bits; bits < total_bits; bits += 32,
-		bits_left -= 32) {
-		unsigned int bytes = bits >> 3;
-		unsigned int shift_bytes = 4;
-		u32 tms_store = 0;
-		u32 tdi_store = 0;
-		u32 tdo_store = 0;
-		
-		if (bits_left < 32) {
-			/* set number of bits to shift out */
-			write_register(bits_left, iobase, XVC_BAR_LENGTH_REG);
-			shift_bytes = (bits_left + 7) >> 3;
-		}
-
-		memcpy(&tms_store, tms_buf + bytes, shift_bytes);
-		memcpy(&tdi_store, tdi_buf + bytes, shift_bytes);
-
-		/* Shift data out and copy to output buffer */
-		rv = xvc_shift_bits(iobase, tms_store, tdi_store, &tdo_store);
-		if (rv < 0)
-			goto cleanup;
-
-		memcpy(tdo_buf + bytes, &tdo_store, shift_bytes);
-	}
+	rv = xvc_shift(xdev->bar[xcdev->bar] + xcdev->base, total_bits,
+			tms_buf, tdi_buf, tdo_buf, &length);
+	mmiowb();
+	spin_unlock(&xcdev->lock);
+	if (rv < 0)
+		return rv;
 
 	/* if testing bar access swap tdi and tdo bufferes to "loopback" */
 	if (opcode == 0x2) {
-		char *tmp = tdo_buf;
+		unsigned char *tmp = tdo_buf;
 
 		tdo_buf = tdi_buf;
 		tdi_buf = tmp;
@@ -202,16 +237,154 @@ static long xvc_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 	rv = copy_to_user((void *)xvc_obj.tdo_buf, tdo_buf, total_bytes);
 	if (rv) {
 		pr_info("copy back tdo_buf failed: %d/%u.\n", rv, total_bytes);
-		rv = -EFAULT;
-		goto cleanup;
+		return -EFAULT;
+	}
+
+	return 0;
+}
+
+static int xvc_ioctl_batch(struct xvc_file *xf, unsigned long arg)
+{
+	struct xdma_cdev *xcdev = xf->xcdev;
+	struct xdma_dev *xdev = xcdev->xdev;
+	struct xvc_ioc_batch batch;
+	unsigned int *lengths;
+	unsigned int total_bytes = 0;
+	unsigned int length = 0;
+	unsigned char *buffer;
+	unsigned char *tms_buf;
+	unsigned char *tdi_buf;
+	unsigned char *tdo_buf;
+	unsigned int offset;
+	unsigned int i;
+	size_t len_bytes;
+	int rv = 0;
+
+	if (copy_from_user(&batch, (void __user *)arg, sizeof(batch)))
+		return -EFAULT;
+
+	if (batch.opcode != 0x01 && batch.opcode != 0x02) {
+		pr_info("UNKNOWN opcode 0x%x.\n", batch.opcode);
+		return -EINVAL;
 	}
+	if (!batch.count || batch.count > XVC_BATCH_SHIFTS_MAX)
+		return -EINVAL;
+
+	/* the lengths go first, then tms, tdi and tdo */
+	len_bytes = ALIGN(batch.count * sizeof(unsigned int), 8);
+	buffer = xvc_buffer_get(xf, len_bytes);
+	if (!buffer)
+		return -ENOMEM;
+	if (copy_from_user(buffer, batch.lengths,
+			batch.count * sizeof(unsigned int)))
+		return -EFAULT;
+
+	lengths = (unsigned int *)buffer;
+	for (i = 0; i < batch.count; i++) {
+		if (!lengths[i])
+			return -EINVAL;
+		total_bytes += (lengths[i] + 7) >> 3;
+		if (total_bytes > XVC_BATCH_BYTES_MAX)
+			return -EINVAL;
+	}
+
+	/* grows with the lengths kept in place, already validated */
+	buffer = xvc_buffer_get(xf, len_bytes + total_bytes * 3);
+	if (!buffer)
+		return -ENOMEM;
+	lengths = (unsigned int *)buffer;
+	tms_buf = buffer + len_bytes;
+	tdi_buf = tms_buf + total_bytes;
+	tdo_buf = tdi_buf + total_bytes;
 
-cleanup:
-	if (buffer)
-		kfree(buffer);
+	if (copy_from_user(tms_buf, batch.tms_buf, total_bytes) ||
+	    copy_from_user(tdi_buf, batch.tdi_buf, total_bytes))
+		return -EFAULT;
 
+	/* exclusive access, for all of the shifts */
+	spin_lock(&xcdev->lock);
+	for (i = 0, offset = 0; i < batch.count; i++) {
+		rv = xvc_shift(xdev->bar[xcdev->bar] + xcdev->base, lengths[i],
+				tms_buf + offset, tdi_buf + offset,
+				tdo_buf + offset, &length);
+		if (rv < 0)
+			break;
+		offset += (lengths[i] + 7) >> 3;
+	}
 	mmiowb();
 	spin_unlock(&xcdev->lock);
+	if (rv < 0)
+		return rv;
+
+	/* if testing bar access return tdi to "loopback" */
+	if (batch.opcode == 0x2)
+		tdo_buf = tdi_buf;
+
+	if (copy_to_user(batch.tdo_buf, tdo_buf, total_bytes)) {
+		pr_info("copy back tdo_buf failed, %u.\n", total_bytes);
+		return -EFAULT;
+	}
+
+	return 0;
+}
+
+static long xvc_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
+{
+	struct xvc_file *xf = (struct xvc_file *)filp->private_data;
+	int rv;
+
+	rv = xcdev_check(__func__, xf->xcdev, 0);
+	if (rv < 0)
+		return rv;
+
+	mutex_lock(&xf->lock);
+	switch (cmd) {
+	case XDMA_IOCXVC:
+		rv = xvc_ioctl_shift(xf, arg);
+		break;
+	case XDMA_IOCXVC_BATCH:
+		rv = xvc_ioctl_batch(xf, arg);
+		break;
+	default:
+		pr_info("ioctl 0x%x, UNKNOWN cmd.\n", cmd);
+		rv = -ENOIOCTLCMD;
+		break;
+	}
+	mutex_unlock(&xf->lock);
+
+	return rv;
+}
+
+static int xvc_open(struct inode *inode, struct file *file)
+{
+	struct xvc_file *xf;
+	int rv;
+
+	rv = char_open(inode, file);
+	if (rv < 0)
+		return rv;
+
+	xf = kzalloc(sizeof(*xf), GFP_KERNEL);
+	if (!xf)
+		return -ENOMEM;
+	xf->xcdev = (struct xdma_cdev *)file->private_data;
+	mutex_init(&xf->lock);
+
+	file->private_data = xf;
+
+	return 0;
+}
+
+static int xvc_close(struct inode *inode, struct file *file)
+{
+	struct xvc_file *xf = (struct xvc_file *)file->private_data;
+	int rv;
+
+	file->private_data = xf->xcdev;
+	rv = char_close(inode, file);
+
+	kvfree(xf->buffer);
+	kfree(xf);
 
 	return rv;
 }
@@ -221,8 +394,8 @@ cleanup:
  */
 static const struct file_operations xvc_fops = {
         .owner = THIS_MODULE,
-        .open = char_open,
-        .release = char_close,
+        .open = xvc_open,
+        .release = xvc_close,
         .unlocked_ioctl = xvc_ioctl,
 };
 
@@ -38,6 +38,25 @@ struct xvc_ioc {
 	unsigned char *tdo_buf;
 };
 
+/*
+ * batched shifts: count shifts of lengths[i] bits each, run back to back
+ * under one ioctl. The tms/tdi/tdo bytes of the shifts are packed one after
+ * the other, each shift starting on a byte boundary, i.e. shift i uses
+ * (lengths[i] + 7) / 8 bytes of each buffer.
+ */
+#define XVC_BATCH_SHIFTS_MAX	4096
+#define XVC_BATCH_BYTES_MAX	(1 << 20)
+
+struct xvc_ioc_batch {
+	unsigned int opcode;
+	unsigned int count;
+	unsigned int *lengths;
+	unsigned char *tms_buf;
+	unsigned char *tdi_buf;
+	unsigned char *tdo_buf;
+};
+
 #define XDMA_IOCXVC	_IOWR(XVC_MAGIC, 1, struct xvc_ioc)
+#define XDMA_IOCXVC_BATCH _IOWR(XVC_MAGIC, 2, struct xvc_ioc_batch)
 
 #endif /* __XVC_IOCTL_H__ */
@@ -0,0 +1,335 @@
+/*
+ * This file is part of the Xilinx DMA IP Core driver for Linux
+ *
+ * Copyright (c) 2016-present,  Xilinx, Inc.
+ * All rights reserved.
+ *
+ * This source code is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ */
+
+#define pr_fmt(fmt)     KBUILD_MODNAME ":%s: " fmt, __func__
+
+#include <linux/blkdev.h>
+#include <linux/blk-mq.h>
+#include "libxdma_api.h"
+#include "xdma_blk.h"
+
+static unsigned int blkdev_size_mb;
+module_param(blkdev_size_mb, uint, 0444);
+MODULE_PARM_DESC(blkdev_size_mb, "size in MB of the card memory exposed as block device, default is 0 (no block device)");
+
+static unsigned long blkdev_ep_addr;
+module_param(blkdev_ep_addr, ulong, 0444);
+MODULE_PARM_DESC(blkdev_ep_addr, "card address of the block device sector 0, default is 0");
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,15,0)
+
+#define XDMA_BLK_MAX_SEGS	128
+#define XDMA_BLK_MAX_SECTORS	2048	/* 1MB */
+#define XDMA_BLK_QUEUE_DEPTH	64
+
+struct xdma_blk_dev {
+	struct xdma_pci_dev *xpdev;
+	struct xdma_dev *xdev;
+	u64 ep_addr;
+	struct blk_mq_tag_set tag_set;
+	struct gendisk *disk;
+	/* xdma_xfer_submit() sleeps, requests run from here */
+	struct workqueue_struct *wq;
+};
+
+/* blk-mq request pdu */
+struct xdma_blk_cmd {
+	struct work_struct work;
+	int channel;
+	struct sg_table sgt;
+	struct scatterlist sgl[XDMA_BLK_MAX_SEGS];
+};
+
+static int xdma_blk_major;
+
+static void xdma_blk_work(struct work_struct *work)
+{
+	struct xdma_blk_cmd *cmd = container_of(work, struct xdma_blk_cmd,
+						work);
+	struct request *rq = blk_mq_rq_from_pdu(cmd);
+	struct xdma_blk_dev *bdev = rq->q->queuedata;
+	bool write = rq_data_dir(rq) == WRITE;
+	u64 ep_addr = bdev->ep_addr + ((u64)blk_rq_pos(rq) << SECTOR_SHIFT);
+	blk_status_t status = BLK_STS_OK;
+	ssize_t res;
+	int nents;
+
+	switch (req_op(rq)) {
+	case REQ_OP_FLUSH:
+		/* no volatile cache in front of the card memory */
+		goto out;
+	case REQ_OP_READ:
+	case REQ_OP_WRITE:
+		break;
+	default:
+		status = BLK_STS_NOTSUPP;
+		goto out;
+	}
+
+	sg_init_table(cmd->sgl, XDMA_BLK_MAX_SEGS);
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,15,0)
+	nents = blk_rq_map_sg(rq, cmd->sgl);
+#else
+	nents = blk_rq_map_sg(rq->q, rq, cmd->sgl);
+#endif
+	if (!nents) {
+		status = BLK_STS_IOERR;
+		goto out;
+	}
+	cmd->sgt.sgl = cmd->sgl;
+	cmd->sgt.orig_nents = nents;
+	cmd->sgt.nents = 0;
+
+	res = xdma_xfer_submit(bdev->xdev, cmd->channel, write, ep_addr,
+				&cmd->sgt, 0, sgdma_timeout * 1000);
+	if (res != blk_rq_bytes(rq)) {
+		pr_info("%s, sector %llu, %u bytes, W %d, rv %ld.\n",
+			bdev->disk->disk_name, (u64)blk_rq_pos(rq),
+			blk_rq_bytes(rq), write, (long)res);
+		status = BLK_STS_IOERR;
+	}
+
+out:
+	blk_mq_end_request(rq, status);
+}
+
+static blk_status_t xdma_blk_queue_rq(struct blk_mq_hw_ctx *hctx,
+				const struct blk_mq_queue_data *bd)
+{
+	struct xdma_blk_dev *bdev = hctx->queue->queuedata;
+	struct request *rq = bd->rq;
+	struct xdma_blk_cmd *cmd = blk_mq_rq_to_pdu(rq);
+
+	/* hardware queue n runs on channel pair n */
+	cmd->channel = hctx->queue_num;
+
+	blk_mq_start_request(rq);
+	queue_work(bdev->wq, &cmd->work);
+
+	return BLK_STS_OK;
+}
+
+static int xdma_blk_init_request(struct blk_mq_tag_set *set,
+				struct request *rq, unsigned int hctx_idx,
+				unsigned int numa_node)
+{
+	struct xdma_blk_cmd *cmd = blk_mq_rq_to_pdu(rq);
+
+	INIT_WORK(&cmd->work, xdma_blk_work);
+	return 0;
+}
+
+static const struct blk_mq_ops xdma_blk_mq_ops = {
+	.queue_rq	= xdma_blk_queue_rq,
+	.init_request	= xdma_blk_init_request,
+};
+
+static const struct block_device_operations xdma_blk_fops = {
+	.owner		= THIS_MODULE,
+};
+
+/* channel pairs with an AXI-MM engine on both sides */
+static int xdma_blk_channels(struct xdma_pci_dev *xpdev)
+{
+	struct xdma_dev *xdev = xpdev->xdev;
+	int nr = min(xpdev->h2c_channel_max, xpdev->c2h_channel_max);
+	int i;
+
+	for (i = 0; i < nr; i++)
+		if (xdev->engine_h2c[i].streaming ||
+		    xdev->engine_c2h[i].streaming)
+			break;
+	return i;
+}
+
+int xdma_blk_create(struct xdma_pci_dev *xpdev)
+{
+	struct xdma_dev *xdev = xpdev->xdev;
+	struct xdma_blk_dev *bdev;
+	struct gendisk *disk;
+	unsigned int align;
+	int channels;
+	int rv;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,9,0)
+	struct queue_limits lim = { };
+#endif
+
+	if (!blkdev_size_mb)
+		return 0;
+
+	channels = xdma_blk_channels(xpdev);
+	if (!channels) {
+		pr_info("xdma%d, no AXI-MM channel pair, no block device.\n",
+			xdev->idx);
+		return 0;
+	}
+
+	bdev = kzalloc(sizeof(*bdev), GFP_KERNEL);
+	if (!bdev)
+		return -ENOMEM;
+	bdev->xpdev = xpdev;
+	bdev->xdev = xdev;
+	bdev->ep_addr = blkdev_ep_addr;
+
+	bdev->wq = alloc_workqueue("xdma%d_blk", WQ_UNBOUND | WQ_MEM_RECLAIM |
+				WQ_HIGHPRI, 0, xdev->idx);
+	if (!bdev->wq) {
+		rv = -ENOMEM;
+		goto free_bdev;
+	}
+
+	bdev->tag_set.ops = &xdma_blk_mq_ops;
+	bdev->tag_set.nr_hw_queues = channels;
+	bdev->tag_set.queue_depth = XDMA_BLK_QUEUE_DEPTH;
+	bdev->tag_set.numa_node = dev_to_node(&xpdev->pdev->dev);
+	bdev->tag_set.cmd_size = sizeof(struct xdma_blk_cmd);
+	bdev->tag_set.driver_data = bdev;
+#if LINUX_VERSION_CODE < KERNEL_VERSION(6,14,0)
+	bdev->tag_set.flags = BLK_MQ_F_SHOULD_MERGE;
+#endif
+
+	rv = blk_mq_alloc_tag_set(&bdev->tag_set);
+	if (rv < 0)
+		goto free_wq;
+
+	/* host and card side of a descriptor share the address lsbs */
+	align = xdev->engine_h2c[0].addr_align;
+	if (xdev->engine_c2h[0].addr_align > align)
+		align = xdev->engine_c2h[0].addr_align;
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,9,0)
+	lim.logical_block_size = SECTOR_SIZE;
+	lim.max_hw_sectors = XDMA_BLK_MAX_SECTORS;
+	lim.max_segments = XDMA_BLK_MAX_SEGS;
+	if (align > 1)
+		lim.dma_alignment = align - 1;
+	disk = blk_mq_alloc_disk(&bdev->tag_set, &lim, bdev);
+#else
+	disk = blk_mq_alloc_disk(&bdev->tag_set, bdev);
+#endif
+	if (IS_ERR(disk)) {
+		rv = PTR_ERR(disk);
+		goto free_tag_set;
+	}
+#if LINUX_VERSION_CODE < KERNEL_VERSION(6,9,0)
+	blk_queue_logical_block_size(disk->queue, SECTOR_SIZE);
+	blk_queue_max_hw_sectors(disk->queue, XDMA_BLK_MAX_SECTORS);
+	blk_queue_max_segments(disk->queue, XDMA_BLK_MAX_SEGS);
+	if (align > 1)
+		blk_queue_dma_alignment(disk->queue, align - 1);
+#endif
+	bdev->disk = disk;
+
+	disk->major = xdma_blk_major;
+	disk->first_minor = xdev->idx;
+	disk->minors = 1;
+	disk->fops = &xdma_blk_fops;
+	disk->private_data = bdev;
+	snprintf(disk->disk_name, DISK_NAME_LEN, "xdma%d_blk", xdev->idx);
+	set_capacity(disk, ((sector_t)blkdev_size_mb << 20) >> SECTOR_SHIFT);
+
+	rv = add_disk(disk);
+	if (rv < 0)
+		goto put_disk;
+
+	xpdev->blk = bdev;
+	pr_info("%s, %u MB at card 0x%lx, %d hw queues.\n", disk->disk_name,
+		blkdev_size_mb, blkdev_ep_addr, channels);
+	return 0;
+
+put_disk:
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,0,0)
+	put_disk(disk);
+#else
+	blk_cleanup_disk(disk);
+#endif
+free_tag_set:
+	blk_mq_free_tag_set(&bdev->tag_set);
+free_wq:
+	destroy_workqueue(bdev->wq);
+free_bdev:
+	kfree(bdev);
+	return rv;
+}
+
+void xdma_blk_destroy(struct xdma_pci_dev *xpdev)
+{
+	struct xdma_blk_dev *bdev = xpdev->blk;
+
+	if (!bdev)
+		return;
+
+	del_gendisk(bdev->disk);
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,0,0)
+	put_disk(bdev->disk);
+#else
+	blk_cleanup_disk(bdev->disk);
+#endif
+	blk_mq_free_tag_set(&bdev->tag_set);
+	destroy_workqueue(bdev->wq);
+	kfree(bdev);
+	xpdev->blk = NULL;
+}
+
+int xdma_blk_init(void)
+{
+	int rv;
+
+	if (!blkdev_size_mb)
+		return 0;
+
+	rv = register_blkdev(0, "xdma");
+	if (rv < 0) {
+		pr_err("unable to register blkdev, %d.\n", rv);
+		return rv;
+	}
+	xdma_blk_major = rv;
+	return 0;
+}
+
+void xdma_blk_cleanup(void)
+{
+	if (xdma_blk_major)
+		unregister_blkdev(xdma_blk_major, "xdma");
+	xdma_blk_major = 0;
+}
+
+#else /* < 5.15 */
+
+int xdma_blk_create(struct xdma_pci_dev *xpdev)
+{
+	if (blkdev_size_mb)
+		pr_info("block device front-end needs kernel 5.15 or later.\n");
+	return 0;
+}
+
+void xdma_blk_destroy(struct xdma_pci_dev *xpdev)
+{
+}
+
+int xdma_blk_init(void)
+{
+	return 0;
+}
+
+void xdma_blk_cleanup(void)
+{
+}
+
+#endif
@@ -0,0 +1,35 @@
+/*
+ * This file is part of the Xilinx DMA IP Core driver for Linux
+ *
+ * Copyright (c) 2016-present,  Xilinx, Inc.
+ * All rights reserved.
+ *
+ * This source code is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ */
+
+#ifndef __XDMA_BLK_H__
+#define __XDMA_BLK_H__
+
+#include "xdma_mod.h"
+
+/*
+ * block device front-end: card memory behind the AXI-MM engines exposed as
+ * /dev/xdma<N>_blk, one blk-mq hardware queue per H2C/C2H channel pair.
+ * Disabled unless the blkdev_size_mb module parameter is set.
+ */
+int xdma_blk_init(void);
+void xdma_blk_cleanup(void);
+int xdma_blk_create(struct xdma_pci_dev *xpdev);
+void xdma_blk_destroy(struct xdma_pci_dev *xpdev);
+
+#endif /* __XDMA_BLK_H__ */
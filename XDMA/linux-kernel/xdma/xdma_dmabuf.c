@@ -0,0 +1,394 @@
+/*
+ * This file is part of the Xilinx DMA IP Core driver for Linux
+ *
+ * Copyright (c) 2016-present,  Xilinx, Inc.
+ * All rights reserved.
+ *
+ * This source code is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ */
+
+#define pr_fmt(fmt)     KBUILD_MODNAME ":%s: " fmt, __func__
+
+#include <linux/highmem.h>
+#include "xdma_dmabuf.h"
+#include "cdev_sgdma.h"
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,13,0)
+MODULE_IMPORT_NS("DMA_BUF");
+#elif LINUX_VERSION_CODE >= KERNEL_VERSION(5,16,0)
+MODULE_IMPORT_NS(DMA_BUF);
+#endif
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,1,0)
+
+/*
+ * exporter: page backed buffers handed out as dma-buf fds, so that a
+ * downstream driver (or the xdma engines themselves) can attach to them.
+ */
+struct xdma_dmabuf {
+	size_t size;
+	unsigned int pages_nr;
+	struct page **pages;
+};
+
+static void xdma_dmabuf_free(struct xdma_dmabuf *buf)
+{
+	int i;
+
+	for (i = 0; i < buf->pages_nr; i++)
+		if (buf->pages[i])
+			__free_page(buf->pages[i]);
+	kvfree(buf->pages);
+	kfree(buf);
+}
+
+static struct sg_table *xdma_dmabuf_map(struct dma_buf_attachment *attach,
+					enum dma_data_direction dir)
+{
+	struct xdma_dmabuf *buf = attach->dmabuf->priv;
+	struct sg_table *sgt;
+	int nents;
+	int rv;
+
+	sgt = kzalloc(sizeof(struct sg_table), GFP_KERNEL);
+	if (!sgt)
+		return ERR_PTR(-ENOMEM);
+
+	rv = sg_alloc_table_from_pages(sgt, buf->pages, buf->pages_nr, 0,
+					buf->size, GFP_KERNEL);
+	if (rv < 0)
+		goto free_sgt;
+
+	nents = dma_map_sg(attach->dev, sgt->sgl, sgt->orig_nents, dir);
+	if (!nents) {
+		rv = -EIO;
+		goto free_table;
+	}
+	sgt->nents = nents;
+
+	return sgt;
+
+free_table:
+	sg_free_table(sgt);
+free_sgt:
+	kfree(sgt);
+	return ERR_PTR(rv);
+}
+
+static void xdma_dmabuf_unmap(struct dma_buf_attachment *attach,
+			struct sg_table *sgt, enum dma_data_direction dir)
+{
+	dma_unmap_sg(attach->dev, sgt->sgl, sgt->orig_nents, dir);
+	sg_free_table(sgt);
+	kfree(sgt);
+}
+
+static void xdma_dmabuf_release(struct dma_buf *dmabuf)
+{
+	xdma_dmabuf_free(dmabuf->priv);
+}
+
+static int xdma_dmabuf_mmap(struct dma_buf *dmabuf, struct vm_area_struct *vma)
+{
+	struct xdma_dmabuf *buf = dmabuf->priv;
+	unsigned long addr = vma->vm_start;
+	unsigned long pgoff = vma->vm_pgoff;
+	int rv;
+
+	if (pgoff + vma_pages(vma) > buf->pages_nr)
+		return -EINVAL;
+
+	for (; addr < vma->vm_end; addr += PAGE_SIZE, pgoff++) {
+		rv = vm_insert_page(vma, addr, buf->pages[pgoff]);
+		if (rv < 0)
+			return rv;
+	}
+
+	return 0;
+}
+
+#if LINUX_VERSION_CODE < KERNEL_VERSION(5,6,0)
+static void *xdma_dmabuf_kmap(struct dma_buf *dmabuf, unsigned long pgnum)
+{
+	struct xdma_dmabuf *buf = dmabuf->priv;
+
+	return pgnum < buf->pages_nr ? kmap(buf->pages[pgnum]) : NULL;
+}
+
+static void xdma_dmabuf_kunmap(struct dma_buf *dmabuf, unsigned long pgnum,
+				void *vaddr)
+{
+	struct xdma_dmabuf *buf = dmabuf->priv;
+
+	kunmap(buf->pages[pgnum]);
+}
+#endif
+
+#if LINUX_VERSION_CODE < KERNEL_VERSION(4,19,0)
+static void *xdma_dmabuf_kmap_atomic(struct dma_buf *dmabuf,
+				unsigned long pgnum)
+{
+	struct xdma_dmabuf *buf = dmabuf->priv;
+
+	return pgnum < buf->pages_nr ? kmap_atomic(buf->pages[pgnum]) : NULL;
+}
+
+static void xdma_dmabuf_kunmap_atomic(struct dma_buf *dmabuf,
+				unsigned long pgnum, void *vaddr)
+{
+	kunmap_atomic(vaddr);
+}
+#endif
+
+static const struct dma_buf_ops xdma_dmabuf_ops = {
+	.map_dma_buf = xdma_dmabuf_map,
+	.unmap_dma_buf = xdma_dmabuf_unmap,
+	.release = xdma_dmabuf_release,
+	.mmap = xdma_dmabuf_mmap,
+#if LINUX_VERSION_CODE < KERNEL_VERSION(4,12,0)
+	.kmap = xdma_dmabuf_kmap,
+	.kunmap = xdma_dmabuf_kunmap,
+	.kmap_atomic = xdma_dmabuf_kmap_atomic,
+	.kunmap_atomic = xdma_dmabuf_kunmap_atomic,
+#elif LINUX_VERSION_CODE < KERNEL_VERSION(4,19,0)
+	.map = xdma_dmabuf_kmap,
+	.unmap = xdma_dmabuf_kunmap,
+	.map_atomic = xdma_dmabuf_kmap_atomic,
+	.unmap_atomic = xdma_dmabuf_kunmap_atomic,
+#elif LINUX_VERSION_CODE < KERNEL_VERSION(5,6,0)
+	.map = xdma_dmabuf_kmap,
+	.unmap = xdma_dmabuf_kunmap,
+#endif
+};
+
+static unsigned long xdma_dmabuf_totalram(void)
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,0,0)
+	return totalram_pages();
+#else
+	return totalram_pages;
+#endif
+}
+
+/*
+ * xdma_dmabuf_export - allocate a page backed buffer of @size bytes and
+ * return a new dma-buf fd referring to it
+ */
+int xdma_dmabuf_export(u64 size)
+{
+	DEFINE_DMA_BUF_EXPORT_INFO(exp_info);
+	struct xdma_dmabuf *buf;
+	struct dma_buf *dmabuf;
+	unsigned long pages_nr;
+	int i;
+	int fd;
+
+	if (!size)
+		return -EINVAL;
+	/* bounded before any rounding, so neither can wrap */
+	if (size > XDMA_DMABUF_SIZE_MAX || size > SIZE_MAX - PAGE_SIZE) {
+		pr_info("size 0x%llx > 0x%llx.\n", size, XDMA_DMABUF_SIZE_MAX);
+		return -EINVAL;
+	}
+	pages_nr = DIV_ROUND_UP_ULL(size, PAGE_SIZE);
+	if (pages_nr > xdma_dmabuf_totalram() / 2 || pages_nr > UINT_MAX) {
+		pr_info("size 0x%llx, %lu pages > half of the memory.\n",
+			size, pages_nr);
+		return -ENOMEM;
+	}
+
+	buf = kzalloc(sizeof(struct xdma_dmabuf), GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	buf->pages_nr = pages_nr;
+	buf->size = (size_t)pages_nr << PAGE_SHIFT;
+	buf->pages = kcalloc(buf->pages_nr, sizeof(struct page *),
+				GFP_KERNEL | __GFP_NOWARN);
+	if (!buf->pages)
+		buf->pages = vzalloc(buf->pages_nr * sizeof(struct page *));
+	if (!buf->pages) {
+		kfree(buf);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < buf->pages_nr; i++) {
+		buf->pages[i] = alloc_page(GFP_KERNEL | __GFP_ZERO);
+		if (!buf->pages[i]) {
+			pr_info("OOM, page %d/%u.\n", i, buf->pages_nr);
+			xdma_dmabuf_free(buf);
+			return -ENOMEM;
+		}
+	}
+
+	exp_info.ops = &xdma_dmabuf_ops;
+	exp_info.size = buf->size;
+	exp_info.flags = O_RDWR;
+	exp_info.priv = buf;
+
+	dmabuf = dma_buf_export(&exp_info);
+	if (IS_ERR(dmabuf)) {
+		xdma_dmabuf_free(buf);
+		return PTR_ERR(dmabuf);
+	}
+
+	fd = dma_buf_fd(dmabuf, O_CLOEXEC);
+	/* on failure the release op frees buf */
+	if (fd < 0)
+		dma_buf_put(dmabuf);
+
+	return fd;
+}
+
+/*
+ * xdma_dmabuf_import - attach the dma-buf @fd to the xdma device and build
+ * the dma mapped sg_table covering [offset, offset + len) of it
+ */
+int xdma_dmabuf_import(struct xdma_dev *xdev, int fd, u64 offset, u64 len,
+			bool write, struct xdma_dmabuf_import *imp)
+{
+	struct scatterlist *sg, *dst;
+	u64 skip = offset;
+	u64 left = len;
+	unsigned int nents = 0;
+	int i;
+	int rv;
+
+	memset(imp, 0, sizeof(*imp));
+	if (!len)
+		return -EINVAL;
+
+	imp->dir = write ? DMA_TO_DEVICE : DMA_FROM_DEVICE;
+	imp->dmabuf = dma_buf_get(fd);
+	if (IS_ERR(imp->dmabuf)) {
+		rv = PTR_ERR(imp->dmabuf);
+		imp->dmabuf = NULL;
+		return rv;
+	}
+
+	if (offset > imp->dmabuf->size || len > imp->dmabuf->size - offset) {
+		pr_info("fd %d, 0x%llx+0x%llx > size 0x%zx.\n",
+			fd, offset, len, imp->dmabuf->size);
+		rv = -EINVAL;
+		goto put_buf;
+	}
+
+	imp->attach = dma_buf_attach(imp->dmabuf, &xdev->pdev->dev);
+	if (IS_ERR(imp->attach)) {
+		rv = PTR_ERR(imp->attach);
+		imp->attach = NULL;
+		goto put_buf;
+	}
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,2,0)
+	imp->map_sgt = dma_buf_map_attachment_unlocked(imp->attach, imp->dir);
+#else
+	imp->map_sgt = dma_buf_map_attachment(imp->attach, imp->dir);
+#endif
+	if (IS_ERR(imp->map_sgt)) {
+		rv = PTR_ERR(imp->map_sgt);
+		imp->map_sgt = NULL;
+		goto detach;
+	}
+
+	/* count the dma segments the window spans */
+	for_each_sg(imp->map_sgt->sgl, sg, imp->map_sgt->nents, i) {
+		u64 seg = sg_dma_len(sg);
+
+		if (skip >= seg) {
+			skip -= seg;
+			continue;
+		}
+		nents++;
+		seg -= skip;
+		skip = 0;
+		if (left <= seg)
+			break;
+		left -= seg;
+	}
+
+	rv = sg_alloc_table(&imp->sgt, nents, GFP_KERNEL);
+	if (rv < 0)
+		goto unmap;
+
+	skip = offset;
+	left = len;
+	dst = imp->sgt.sgl;
+	for_each_sg(imp->map_sgt->sgl, sg, imp->map_sgt->nents, i) {
+		u64 seg = sg_dma_len(sg);
+
+		if (skip >= seg) {
+			skip -= seg;
+			continue;
+		}
+		seg = min_t(u64, seg - skip, left);
+		sg_dma_address(dst) = sg_dma_address(sg) + skip;
+		sg_dma_len(dst) = seg;
+		skip = 0;
+		left -= seg;
+		if (!left)
+			break;
+		dst = sg_next(dst);
+	}
+
+	return 0;
+
+unmap:
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,2,0)
+	dma_buf_unmap_attachment_unlocked(imp->attach, imp->map_sgt, imp->dir);
+#else
+	dma_buf_unmap_attachment(imp->attach, imp->map_sgt, imp->dir);
+#endif
+detach:
+	dma_buf_detach(imp->dmabuf, imp->attach);
+put_buf:
+	dma_buf_put(imp->dmabuf);
+	memset(imp, 0, sizeof(*imp));
+	return rv;
+}
+
+void xdma_dmabuf_import_release(struct xdma_dmabuf_import *imp)
+{
+	if (!imp->dmabuf)
+		return;
+
+	sg_free_table(&imp->sgt);
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,2,0)
+	dma_buf_unmap_attachment_unlocked(imp->attach, imp->map_sgt, imp->dir);
+#else
+	dma_buf_unmap_attachment(imp->attach, imp->map_sgt, imp->dir);
+#endif
+	dma_buf_detach(imp->dmabuf, imp->attach);
+	dma_buf_put(imp->dmabuf);
+	memset(imp, 0, sizeof(*imp));
+}
+
+#else /* LINUX_VERSION_CODE < KERNEL_VERSION(4,1,0) */
+
+int xdma_dmabuf_export(u64 size)
+{
+	return -EOPNOTSUPP;
+}
+
+int xdma_dmabuf_import(struct xdma_dev *xdev, int fd, u64 offset, u64 len,
+			bool write, struct xdma_dmabuf_import *imp)
+{
+	memset(imp, 0, sizeof(*imp));
+	return -EOPNOTSUPP;
+}
+
+void xdma_dmabuf_import_release(struct xdma_dmabuf_import *imp)
+{
+}
+
+#endif
@@ -0,0 +1,45 @@
+/*
+ * This file is part of the Xilinx DMA IP Core driver for Linux
+ *
+ * Copyright (c) 2016-present,  Xilinx, Inc.
+ * All rights reserved.
+ *
+ * This source code is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ */
+
+#ifndef __XDMA_DMABUF_H__
+#define __XDMA_DMABUF_H__
+
+#include <linux/dma-buf.h>
+#include <linux/scatterlist.h>
+#include "xdma_mod.h"
+
+/*
+ * dma-buf used as the host side of a sgdma transfer: the attachment to the
+ * xdma pci device, its mapping, and the [offset, offset + len) window of that
+ * mapping handed to xdma_xfer_submit() as an already dma mapped sg_table.
+ */
+struct xdma_dmabuf_import {
+	struct dma_buf *dmabuf;
+	struct dma_buf_attachment *attach;
+	struct sg_table *map_sgt;
+	enum dma_data_direction dir;
+	struct sg_table sgt;
+};
+
+int xdma_dmabuf_export(u64 size);
+int xdma_dmabuf_import(struct xdma_dev *xdev, int fd, u64 offset, u64 len,
+			bool write, struct xdma_dmabuf_import *imp);
+void xdma_dmabuf_import_release(struct xdma_dmabuf_import *imp);
+
+#endif /* __XDMA_DMABUF_H__ */
@@ -28,6 +28,7 @@
 #include "libxdma.h"
 #include "xdma_mod.h"
 #include "xdma_cdev.h"
+#include "xdma_blk.h"
 #include "version.h"
 
 #define DRV_MODULE_NAME		"xdma"
@@ -113,6 +114,7 @@ static void xpdev_free(struct xdma_pci_dev *xpdev)
 {
 	struct xdma_dev *xdev = xpdev->xdev;
 
+	xdma_blk_destroy(xpdev);
 	pr_info("xpdev 0x%p, destroy_interfaces, xdev 0x%p.\n", xpdev, xdev);
 	xpdev_destroy_interfaces(xpdev);
 	xpdev->xdev = NULL;
@@ -194,6 +196,10 @@ static int probe_one(struct pci_dev *pdev, const struct pci_device_id *id)
 	if (rv)
 		goto err_out;
 
+	rv = xdma_blk_create(xpdev);
+	if (rv)
+		goto err_out;
+
 	dev_set_drvdata(&pdev->dev, xpdev);
 
 	return 0;
@@ -313,6 +319,12 @@ static const struct pci_error_handlers xdma_err_handler = {
 #endif
 };
 
+/*
+ * probed synchronously: xdev_list_add() numbers the cards (and so the
+ * /dev/xdma<N> nodes) in probe order, which must stay the PCI enumeration
+ * order. The engines of each card still come up in parallel, see
+ * engine_init_async.
+ */
 static struct pci_driver pci_driver = {
 	.name = DRV_MODULE_NAME,
 	.id_table = pci_ids,
@@ -325,7 +337,6 @@ static int __init xdma_mod_init(void)
 {
 	int rv;
 	extern unsigned int desc_blen_max;
-	extern unsigned int sgdma_timeout;
 
 	pr_info("%s", version);
 
@@ -338,7 +349,21 @@ static int __init xdma_mod_init(void)
 	if (rv < 0)
 		return rv;
 
-	return pci_register_driver(&pci_driver);
+	rv = xdma_blk_init();
+	if (rv < 0)
+		goto cdev_cleanup;
+
+	rv = pci_register_driver(&pci_driver);
+	if (rv < 0)
+		goto blk_cleanup;
+
+	return 0;
+
+blk_cleanup:
+	xdma_blk_cleanup();
+cdev_cleanup:
+	xdma_cdev_cleanup();
+	return rv;
 }
 
 static void __exit xdma_mod_exit(void)
@@ -346,6 +371,7 @@ static void __exit xdma_mod_exit(void)
 	/* unregister this driver from the PCI bus driver */
 	dbg_init("pci_unregister_driver.\n");
 	pci_unregister_driver(&pci_driver);
+	xdma_blk_cleanup();
 	xdma_cdev_cleanup();
 }
 
@@ -47,11 +47,23 @@
 
 #include "libxdma.h"
 
+#if LINUX_VERSION_CODE < KERNEL_VERSION(4, 12, 0)
+static inline void *kvmalloc(size_t size, gfp_t flags)
+{
+	void *p = kmalloc(size, flags | __GFP_NOWARN);
+
+	return p ? p : __vmalloc(size, flags, PAGE_KERNEL);
+}
+#endif
+
 #define MAGIC_ENGINE	0xEEEEEEEEUL
 #define MAGIC_DEVICE	0xDDDDDDDDUL
 #define MAGIC_CHAR	0xCCCCCCCCUL
 #define MAGIC_BITSTREAM 0xBBBBBBBBUL
 
+/* cdev_sgdma.c module parameter, seconds */
+extern unsigned int sgdma_timeout;
+
 struct xdma_cdev {
 	unsigned long magic;		/* structure ID for sanity checks */
 	struct xdma_pci_dev *xpdev;
@@ -64,8 +76,11 @@ struct xdma_cdev {
 	struct xdma_user_irq *user_irq;	/* IRQ value, if needed */
 	struct device *sys_device;	/* sysfs device */
 	spinlock_t lock;
+	struct mutex regv_lock;		/* serializes XDMA_IOCREGV sequences */
 };
 
+struct xdma_blk_dev;
+
 /* XDMA PCIe device specific book-keeping */
 struct xdma_pci_dev {
 	unsigned long magic;		/* structure ID for sanity checks */
@@ -91,6 +106,9 @@ struct xdma_pci_dev {
 
 	struct xdma_cdev xvc_cdev;
 
+	/* block device front-end, if enabled */
+	struct xdma_blk_dev *blk;
+
 	void *data;
 };
 
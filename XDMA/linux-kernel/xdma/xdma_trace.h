@@ -0,0 +1 @@
+../libxdma/xdma_trace.h
\ No newline at end of file